@@ -0,0 +1,22 @@
+/*==================================================
+ * fluxcache.cc
+ *
+ * Description:
+ * Load a SN model file in Nakazato format once, to check the cache
+ * of SN model files shared between jobs (see fluxcache_test.sh)
+ *
+ * ==============================================*/
+
+#include <iostream>
+#include <cstdlib>
+#include <SKSNSimFlux.hh>
+
+int main(int argc, char **argv){
+  if( argc != 2 ){
+    std::cout << "Usage: " << argv[0] << " {SN model file}" << std::endl;
+    return EXIT_FAILURE;
+  }
+  SKSNSimSNFluxCustom flux( argv[1] );
+  std::cout << "Loaded: " << flux.GetNBinsTime() << " time steps x " << flux.GetNBinsEne() << " energy bins" << std::endl;
+  return EXIT_SUCCESS;
+}
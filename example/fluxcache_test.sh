@@ -0,0 +1,46 @@
+#!/bin/bash
+#
+# Launch N jobs loading the same SN model at once with an empty cache directory,
+# and check that only one of them parses the model and writes the cache,
+# and that all of them map the cache.
+#
+# usage: ./fluxcache_test.sh {SN model file} [N (default 8)]
+#
+
+if [ $# -lt 1 ]; then
+  echo "usage: $0 {SN model file} [N (default 8)]"
+  exit 1
+fi
+MODEL=$1
+NJOBS=${2:-8}
+
+export SKSNSIMFLUXCACHEDIR=$(mktemp -d)
+LOGDIR=$(mktemp -d)
+trap 'rm -rf $SKSNSIMFLUXCACHEDIR $LOGDIR' EXIT
+
+for i in $(seq 1 $NJOBS); do
+  ./fluxcache $MODEL > $LOGDIR/job$i.log 2>&1 &
+done
+wait
+
+NWRITE=$(cat $LOGDIR/job*.log | grep -c "SN model data is cached in")
+NMAP=$(cat $LOGDIR/job*.log | grep -c "SN model data is mapped from cache")
+echo "$NJOBS jobs: cache written by $NWRITE, mapped by $NMAP"
+if [ $NWRITE -ne 1 ] || [ $NMAP -ne $NJOBS ]; then
+  echo "FAILED"
+  exit 1
+fi
+
+# the second round finds the cache without writing it again
+for i in $(seq 1 $NJOBS); do
+  ./fluxcache $MODEL > $LOGDIR/job$i.log 2>&1 &
+done
+wait
+NWRITE=$(cat $LOGDIR/job*.log | grep -c "SN model data is cached in")
+NMAP=$(cat $LOGDIR/job*.log | grep -c "SN model data is mapped from cache")
+echo "$NJOBS jobs with the cache: cache written by $NWRITE, mapped by $NMAP"
+if [ $NWRITE -ne 0 ] || [ $NMAP -ne $NJOBS ]; then
+  echo "FAILED"
+  exit 1
+fi
+echo "OK"
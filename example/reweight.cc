@@ -23,6 +23,7 @@
 #include <mcinfo.h>
 #include <SKSNSimCrosssection.hh>
 #include <SKSNSimFlux.hh>
+#include <SKSNSimIntegration.hh>
 
 using namespace boost::filesystem;
 using std::cout;
@@ -159,6 +160,13 @@ int main( int argc, char **argv){
   for( auto it : flux_models)
     flux_container.push_back( std::make_unique<FLUXGENERATOR>( it.first, it.second, *tr));
 
+  // Integral of (flux) x (xsec) for each model, e.g. to normalize weights to expected number of events
+  SKSNSimFluxXSecIntegrator integrator;
+  for( auto &it : flux_container){
+    const auto res = integrator.Integrate( *it->generator, *xsec_rvv, it->generator->GetEnergyLimitMin(), it->generator->GetEnergyLimitMax());
+    cout << "Integral of (flux x xsec) " << it->name << ": " << res.first << " +- " << res.second << std::endl;
+  }
+
   std::vector<std::unique_ptr<FLUXGENERATOR>> flux_container_positron;
   for( auto it : flux_models_positron)
     flux_container_positron.push_back( std::make_unique<FLUXGENERATOR>( it.first, it.second, *tr));
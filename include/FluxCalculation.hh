@@ -8,6 +8,7 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include "SKSNSimGridIndex.hh"
 
 // #define RETURNEXCEPATIONS 
 // This enables throwing exceptions to notify some errror (e.g. the specified energy is out of range)
@@ -20,13 +21,19 @@ class FluxCalculation {
     std::vector<std::pair<double,double> > *ene_flux_v = NULL; /* size_t -> <energy, flux> */
     double lower_energy_bin_width;
     double upper_energy_bin_width;
+    std::vector<double> binEne; // energies of ene_flux_v, searched by eneIndex
+    std::vector<double> binSlope; // slope of flux to the next bin
+    SKSNSimGridIndex eneIndex;
     void sortByEnergy();
+    void buildIndex();
 
   public:
     const static size_t NBIN = 500;
     FluxCalculation();
     FluxCalculation(const std::string /*fname*/);
     ~FluxCalculation();
+    FluxCalculation(const FluxCalculation &) = delete; // ene_flux_v is owned and eneIndex points into binEne
+    FluxCalculation &operator=(const FluxCalculation &) = delete;
     void loadFile(const std::string /*fname*/);
     double getFlux(const double /* nu energy in MeV */) const;
     inline double getFluxLimit(const bool lower_limit = true /* if false -> return upper limit*/) const{
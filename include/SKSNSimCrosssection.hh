@@ -7,13 +7,17 @@
 #ifndef SKSNSIMCROSSSECTION_H_INCLUDED
 #define SKSNSIMCROSSSECTION_H_INCLUDED
 
+#include <string>
 #include <utility>
 #include <memory>
 #include <set>
+#include <vector>
+#include <functional>
 #include <pdg_codes.h>
 #include <TFile.h>
 #include <TTree.h>
 #include "SKSNSimConstant.hh"
+#include "SKSNSimTableFile.hh"
 
 
 extern "C" {
@@ -40,10 +44,61 @@ class SKSNSimCrosssectionModel {
     virtual ~SKSNSimCrosssectionModel() {}
     virtual double /* cm^2 */                          GetCrosssection(double /* MeV */) const = 0; // energy -> xsec
     virtual std::pair<double,double> /* <cm^2, MeV> */ GetDiffCrosssection(double /* MeV */, double /* a.u. */) const = 0; // energy -> angle -> (xsec, scattered energy)
+    virtual void GetDiffCrosssectionBatch(const size_t n, const double *e /* MeV */, const double *r /* a.u. */, double *xsec /* cm^2 */, double *escat /* MeV */) const { // n pairs of (energy, angle) -> n pairs of (xsec, scattered energy)
+      for(size_t i = 0; i < n; i++){
+        const std::pair<double,double> p = GetDiffCrosssection(e[i], r[i]);
+        xsec[i] = p.first;
+        escat[i] = p.second;
+      }
+    }
     //virtual const std::set<XSECNUTYPE> &GetSupportedNuType () const = 0;
 
 };
 
+class SKSNSimXSecTable {
+  // Total cross section tabulated on uniform grid of log(Enu - Ethr), interpolated by monotone cubic spline (Fritsch-Carlson).
+  // The table is built at the first query: the grid is refined until the relative error at the midpoints of the grid,
+  // checked against the exact calculation, becomes smaller than the error target.
+  // Out of the table range, the exact calculation is used. Non-positive error target disables the table.
+  // If the table of the same definition is found in SKSNSimTableFile (baked into the library or precompiled file),
+  // it is used after a spot check against the exact calculation, instead of building.
+  private:
+    std::string m_name; // name in SKSNSimTableFile
+    double m_ethr; // MeV, threshold energy of the model
+    double m_emax; // MeV, maximum energy of the table
+    double m_error_target; // relative
+    double m_max_error; // relative error found in the self-test of the last build
+    double m_xmin, m_dx; // log(MeV)
+    std::vector<double> m_xsec; // cm^2, at nodes
+    std::vector<double> m_slope; // cm^2, dxsec/dx at nodes
+    bool m_built;
+    void calcSlope();
+    double interpolate(const double /* x */) const;
+    std::vector<double> getDefinition() const { return std::vector<double>{ m_ethr, m_emax, m_error_target }; }
+    bool load(const std::function<double(double)> &); // from SKSNSimTableFile, false if not found or not valid
+  public:
+    constexpr static double OFFSETMIN = 1.e-3; // MeV, minimum of (Enu - Ethr) in the table
+    constexpr static size_t NINTERVALINIT = 256;
+    constexpr static size_t NINTERVALMAX = 65536;
+    constexpr static size_t NVALIDATION = 4; // number of points of the spot check of loaded table
+    SKSNSimXSecTable(const std::string &name, const double ethr, const double emax = 500. /* MeV */, const double err = 1.e-4):
+      m_name(name), m_ethr(ethr), m_emax(emax), m_error_target(err), m_max_error(-1.), m_xmin(0.), m_dx(0.), m_built(false) {}
+    void Build(const std::function<double(double)> &);
+    template <class F> double Get(const double e, const F &exact) {
+      if( m_error_target <= 0. ) return exact(e);
+      if( !m_built && !load(exact) ) Build(exact);
+      return ( InRange(e) ? Eval(e) : exact(e) );
+    }
+    void Export(SKSNSimTableFileWriter &, const std::function<double(double)> &); // built if not yet
+    bool InRange(const double e) const { return ( e >= m_ethr + OFFSETMIN && e <= m_emax ); }
+    double Eval(const double /* MeV */) const; // valid only in the table range
+    bool IsBuilt() const { return m_built; }
+    size_t GetNNodes() const { return m_xsec.size(); }
+    double GetMaxError() const { return m_max_error; }
+    double GetErrorTarget() const { return m_error_target; }
+    double SetErrorTarget(const double err) { m_built = false; m_error_target = err; return m_error_target; } // table is rebuilt at the next query
+};
+
 class SKSNSimXSecFlat : public SKSNSimCrosssectionModel {
   // Flat cross section: always return 1.0
   private:
@@ -55,23 +110,64 @@ class SKSNSimXSecFlat : public SKSNSimCrosssectionModel {
 };
 
 
+class SKSNSimIBDAngularIntegrator {
+  // Total cross section of IBD as the integral of dsigma/dcos(theta), by Gauss-Legendre rule of fixed order (shared by IBD models).
+  // cos(theta) is integrated over the kinematically allowed range: just above the threshold, the positron is emitted only forward.
+  // Energies below the threshold of the model return zero without calling the differential cross section.
+  // All nodes for many energies are passed to GetDiffCrosssectionBatch at once.
+  public:
+    constexpr static double nuEneThr = ((SKSNSimPhysConst::Mn + SKSNSimPhysConst::Me)*(SKSNSimPhysConst::Mn + SKSNSimPhysConst::Me) - SKSNSimPhysConst::Mp*SKSNSimPhysConst::Mp)*0.5/SKSNSimPhysConst::Mp; // MeV, kinematic threshold of neutrino energy
+    constexpr static size_t ORDERDEFAULT = 16;
+  private:
+    constexpr static size_t NENERGYCHUNK = 256; // energies per call of GetDiffCrosssectionBatch
+    size_t m_order;
+  public:
+    SKSNSimIBDAngularIntegrator(const size_t order = ORDERDEFAULT): m_order(order) {}
+    ~SKSNSimIBDAngularIntegrator() {}
+    size_t GetOrder() const { return m_order; }
+    void SetOrder(const size_t order) { m_order = order; }
+    static double GetCosThetaMin(const double /* MeV */); // lower limit of cos(theta), larger than 1 below the kinematic threshold
+    double Integrate(const SKSNSimCrosssectionModel &, const double /* MeV, threshold of the model */, const double /* MeV */) const;
+    void IntegrateBatch(const SKSNSimCrosssectionModel &, const double /* MeV, threshold of the model */, const size_t n, const double *e /* MeV */, double *xsec /* cm^2 */) const;
+};
+
 class SKSNSimXSecIBDVB : public SKSNSimCrosssectionModel {
   // Cross section model of IBD by Vogel and Beacom
   private:
+    constexpr static double nuEneThr = SKSNSimPhysConst::DeltaM + 3.0; // MeV, Ee >= 3 MeV (validity of the model)
+    mutable SKSNSimXSecTable table;
+    SKSNSimIBDAngularIntegrator angint;
   public:
-    SKSNSimXSecIBDVB(){}
+    SKSNSimXSecIBDVB();
     ~SKSNSimXSecIBDVB(){}
-    double GetCrosssection(double e) const;
+    double GetCrosssection(double e) const { return table.Get(e, [this](double x){ return GetCrosssectionExact(x); }); } // tabulated
+    double GetCrosssectionExact(double e) const { return angint.Integrate(*this, nuEneThr, e); } // integral of differential cross section
+    void GetCrosssectionExactBatch(const size_t n, const double *e, double *xsec) const { angint.IntegrateBatch(*this, nuEneThr, n, e, xsec); }
+    const SKSNSimXSecTable &GetTable() const { return table; }
+    double SetTableErrorTarget(const double err) { return table.SetErrorTarget(err); }
+    void SetAngularIntegrationOrder(const size_t order) { angint.SetOrder(order); table.SetErrorTarget(table.GetErrorTarget()); } // table is rebuilt at the next query
+    size_t GetAngularIntegrationOrder() const { return angint.GetOrder(); }
+    void ExportTable(SKSNSimTableFileWriter &writer) const { table.Export(writer, [this](double x){ return GetCrosssectionExact(x); }); } // for precompiled table file
     std::pair<double,double> GetDiffCrosssection(double e, double r) const;
 };
 
 class SKSNSimXSecIBDSV : public SKSNSimCrosssectionModel {
   // Cross section model of IBD by Strumia-Vissani
   private:
+    constexpr static double nuEneThr = SKSNSimIBDAngularIntegrator::nuEneThr; // MeV, threshold of neutrino energy
+    mutable SKSNSimXSecTable table;
+    SKSNSimIBDAngularIntegrator angint;
   public:
-    SKSNSimXSecIBDSV(){}
+    SKSNSimXSecIBDSV();
     ~SKSNSimXSecIBDSV(){}
-    double GetCrosssection(double) const;
+    double GetCrosssection(double e) const { return table.Get(e, [this](double x){ return GetCrosssectionExact(x); }); } // tabulated
+    double GetCrosssectionExact(double e) const { return angint.Integrate(*this, nuEneThr, e); } // integral of differential cross section
+    void GetCrosssectionExactBatch(const size_t n, const double *e, double *xsec) const { angint.IntegrateBatch(*this, nuEneThr, n, e, xsec); }
+    const SKSNSimXSecTable &GetTable() const { return table; }
+    double SetTableErrorTarget(const double err) { return table.SetErrorTarget(err); }
+    void SetAngularIntegrationOrder(const size_t order) { angint.SetOrder(order); table.SetErrorTarget(table.GetErrorTarget()); } // table is rebuilt at the next query
+    size_t GetAngularIntegrationOrder() const { return angint.GetOrder(); }
+    void ExportTable(SKSNSimTableFileWriter &writer) const { table.Export(writer, [this](double x){ return GetCrosssectionExact(x); }); } // for precompiled table file
     std::pair<double,double> GetDiffCrosssection(double, double) const;
 };
 
@@ -80,12 +176,26 @@ class SKSNSimXSecIBDRVV : public SKSNSimCrosssectionModel {
   // Reference [2] IBD calculatoin of Strumia-Vissani (Phys.Lett.B564:42-54,2003, DOI: https://doi.org/10.1016/S0370-2693(03)00616-6)
   // Error is systematic uncertainty cased by (Vud, axial coupling) and axial_radii. This is implemented as simple approximation with constant and power-law, respectively.
   private:
+    constexpr static double nuEneThr = SKSNSimIBDAngularIntegrator::nuEneThr; // MeV, threshold of neutrino energy
+    mutable SKSNSimXSecTable table;
+    SKSNSimIBDAngularIntegrator angint;
+    static double calcDiffCrosssection(const double /* MeV */, const double /* a.u. */, double & /* MeV, positron energy */); // above threshold only
   public:
-    SKSNSimXSecIBDRVV(){}
+    SKSNSimXSecIBDRVV();
     virtual ~SKSNSimXSecIBDRVV(){}
-    double GetCrosssection(double) const;
-    double GetCrosssectionError(double) const; /* arbitary unit. If we want to convert to unit of %, multiply 100.0. */
+    double GetCrosssection(double e) const { return table.Get(e, [this](double x){ return GetCrosssectionExact(x); }); } // tabulated
+    double GetCrosssectionExact(double e) const { return angint.Integrate(*this, nuEneThr, e); } // integral of differential cross section
+    void GetCrosssectionExactBatch(const size_t n, const double *e, double *xsec) const { angint.IntegrateBatch(*this, nuEneThr, n, e, xsec); }
+    const SKSNSimXSecTable &GetTable() const { return table; }
+    double SetTableErrorTarget(const double err) { return table.SetErrorTarget(err); }
+    void SetAngularIntegrationOrder(const size_t order) { angint.SetOrder(order); table.SetErrorTarget(table.GetErrorTarget()); } // table is rebuilt at the next query
+    size_t GetAngularIntegrationOrder() const { return angint.GetOrder(); }
+    void ExportTable(SKSNSimTableFileWriter &writer) const { table.Export(writer, [this](double x){ return GetCrosssectionExact(x); }); } // for precompiled table file
+    enum ERRORSOURCE { kERRVUDLAMBDA = 0, kERRAXIALRADII, kNERRORSOURCE };
+    static double GetCrosssectionError(double); /* arbitary unit. If we want to convert to unit of %, multiply 100.0. */
+    static double GetCrosssectionError(double, ERRORSOURCE); /* each source of the error, kNERRORSOURCE for the total */
     std::pair<double,double> GetDiffCrosssection(double, double) const;
+    void GetDiffCrosssectionBatch(const size_t, const double *, const double *, double *, double *) const; // branch-free loop for auto-vectorization, zero below threshold without message
 };
 
 class SKSNSimXSecNuElastic : public SKSNSimCrosssectionModel {
@@ -96,19 +206,58 @@ class SKSNSimXSecNuElastic : public SKSNSimCrosssectionModel {
     constexpr static int nuElaEneNBins = 15000; // number of bins for nu energy
     constexpr static double nuElaEneBinSize = ( nuElaEneMax - nuElaEneMin ) / ( double )nuElaEneNBins;
 
-    constexpr static double eEneThr = 5.0;// MeV, electron total energy threshold
-
-    std::unique_ptr<TFile> fCsElaFile;
-    TTree *fCsElaTree;
-    double NuElaEnergy, CsElaNue, CsElaNux, CsElaNeb, CsElaNxb;
-
-    void OpenCsElaFile();
-    void CloseCsElaFile();
+    constexpr static double eEneThrDefault = 5.0;// MeV, electron total energy threshold
+    double eEneThr; // MeV, electron total energy threshold applied with ETHRON
+
+    // Cross section without threshold, loaded from nuela tree in table/sn_elastic.root
+    enum ELAFLAVOR { kELANUE = 0, kELANEB, kELANUX, kELANXB, kNELAFLAVOR };
+    SKSNSimTableView csElaEne; // MeV
+    SKSNSimTableView csEla[kNELAFLAVOR]; // cm^2
+
+    static int GetFlavorIndex(const int ipart) {
+      switch(ipart){
+        case  PDG_ELECTRON_NEUTRINO: return kELANUE;
+        case -PDG_ELECTRON_NEUTRINO: return kELANEB;
+        case  PDG_MUON_NEUTRINO:     return kELANUX;
+        case -PDG_MUON_NEUTRINO:     return kELANXB;
+        default: return -1;
+      }
+    }
+    void LoadCsElaFile();
+
+    // Cross section with threshold: sigma(Enu; Tthr) is tabulated on 2D grid of neutrino energy and threshold of electron kinetic energy,
+    // by integrating sl_*_dif_rad_ downward from the kinematic maximum. The table is cached in table/sn_elastic_thr.bin.
+    // For the current threshold, 1D slice on the energy grid is prepared and interpolated linearly.
+    constexpr static int thrEneNBins = 600; // number of bins for nu energy
+    constexpr static double thrEneBinSize = ( nuElaEneMax - nuElaEneMin ) / ( double )thrEneNBins;
+    constexpr static double thrKinMax = 20.0; // MeV, maximum threshold of electron kinetic energy in the table
+    constexpr static int thrKinNBins = 200; // number of bins for threshold
+    constexpr static double thrKinBinSize = thrKinMax / ( double )thrKinNBins;
+    constexpr static int thrNSteps = 20; // integration steps in each threshold bin
+    constexpr static int tailNSteps = 1000; // integration steps above thrKinMax
+    SKSNSimTableView csThr[kNELAFLAVOR]; // cm^2, [iene * (thrKinNBins + 1) + ithr]
+    std::shared_ptr<const SKSNSimTableFile> thrfile; // keeps the mapping of table/sn_elastic_thr.bin
+    std::vector<double> csThrSlice[kNELAFLAVOR]; // cm^2, [iene] at eEneThr
+    double nuEneThr; // MeV, kinematic threshold of nu energy for eEneThr
+
+    static double CalcDiffCrosssectionKin(const int /* flavor */, double /* MeV, nu energy */, double /* MeV, electron total energy */);
+    static double IntegrateDiffCrosssection(const int /* flavor */, const double /* MeV, nu energy */, const double /* MeV, kinetic min */, const double /* MeV, kinetic max */, const int /* nsteps */);
+    void LoadThrTable();
+    std::vector<double> GetThrTableDefinition() const;
+    bool ReadThrTable(const std::string &);
+    void WriteThrTable(const std::string &) const;
+    void BuildThrTable();
+    void UpdateThrSlice();
 
   public:
     enum FLAGETHR { ETHRON, ETHROFF };
-    SKSNSimXSecNuElastic(){ OpenCsElaFile();}
-    ~SKSNSimXSecNuElastic(){CloseCsElaFile();}
+    SKSNSimXSecNuElastic(const double ethr = eEneThrDefault /* MeV, total energy */): eEneThr(ethr), nuEneThr(0.) { LoadCsElaFile(); LoadThrTable(); UpdateThrSlice(); }
+    ~SKSNSimXSecNuElastic(){}
+    void ExportTable(SKSNSimTableFileWriter &) const; // for precompiled table file
+    double SetElectronEnergyThreshold(const double e) { eEneThr = e; UpdateThrSlice(); return eEneThr; } // MeV, total energy
+    double GetElectronEnergyThreshold() const { return eEneThr; }
+    static double GetDefaultElectronEnergyThreshold() { return eEneThrDefault; }
+    double CalcCrosssectionWithThreshold(double e, int pid, double ethr) const; // direct integration of 1000 steps without table
     double GetCrosssection(double e, int pid = -PDG_ELECTRON_NEUTRINO, FLAGETHR flag = ETHRON) const;
     double GetCrosssection(double e) const { return GetCrosssection(e, -PDG_ELECTRON_NEUTRINO, ETHRON);} ;
     std::pair<double,double> GetDiffCrosssection(double e, double r) const;
@@ -119,6 +268,32 @@ class SKSNSimXSecNuElastic : public SKSNSimCrosssectionModel {
     static double CalcCosThr( const double , const double );
 };
 
+class SKSNSimXSecEnergyGrid {
+  // Energy grid of tabulated cross section, possibly non-uniform.
+  // FindBin is O(1): uniform look-up cells, not wider than the narrowest bin, give the bin at the lower edge of the cell,
+  // then the bin is shifted by at most one.
+  private:
+    std::vector<double> m_ene; // MeV, strictly increasing
+    std::vector<int> m_lut; // bin index at the lower edge of each cell
+    double m_cellwidth; // MeV
+  public:
+    SKSNSimXSecEnergyGrid(): m_cellwidth(0.) {}
+    void Set(const std::vector<double> & /* MeV */);
+    int FindBin(const double e) const { // i with ene[i] <= e < ene[i+1], -1 if out of the grid
+      if( m_ene.size() < 2 || !( e >= m_ene.front() ) || e >= m_ene.back() ) return -1;
+      size_t cell = (size_t)( ( e - m_ene.front() ) / m_cellwidth );
+      if( cell >= m_lut.size() ) cell = m_lut.size() - 1;
+      int i = m_lut[cell];
+      while( e >= m_ene[i + 1] ) i++;
+      while( e < m_ene[i] ) i--;
+      return i;
+    }
+    size_t GetSize() const { return m_ene.size(); }
+    double GetEnergy(const size_t i) const { return m_ene[i]; }
+    const std::vector<double> &GetEnergies() const { return m_ene; }
+    void CalcSlope(const double * /* values at GetSize() nodes */, double * /* slope to the next node, GetSize() */) const;
+};
+
 class SKSNSimXSecNuOxygen : public SKSNSimCrosssectionModel {
   // Cross section model of neutrino-oxygen -> single lepton
   private:
@@ -129,27 +304,30 @@ class SKSNSimXSecNuOxygen : public SKSNSimCrosssectionModel {
     constexpr static int NEXSTATE = 16; // maximum, depending to IXSTATE
     constexpr static int NCHANNEL = 7;
     constexpr static double eEneThr = 5.0;// MeV, electron total energy threshold
-    std::map<INISTATE,bool> isOpened;
-    std::map<INISTATE, std::vector<double>> rec;
-    std::map<INISTATE, std::vector<double>> pro_energy;
-    std::map<INISTATE,int> fileSize;
-    std::map<INISTATE,int> exNum;
-    std::map<INISTATE,std::vector<double>> exEne;
-    std::map<INISTATE,std::vector<double>> nuene;
-    std::map<INIFINSTATE, std::vector<double>> crs;
 
+    // Tables are stored in flat arrays. Block of each INISTATE (file) starts at crsOffset[iblock],
+    // and the value for (ex, ch, energy bin) is at crsOffset[iblock] + (ex * NCHANNEL + ch) * (grid size) + ibin.
+    // Slope of linear interpolation to the next bin is precomputed in the same layout.
+    bool isOpened[NTYPE * NIXSTATE];
+    SKSNSimXSecEnergyGrid nuEneGrid[NTYPE * NIXSTATE];
+    size_t crsOffset[NTYPE * NIXSTATE];
+    double exEne[NTYPE * NIXSTATE * NEXSTATE]; // MeV, [iblock * NEXSTATE + ex]
+    SKSNSimTableView crs; // 10^-26 cm^2
+    SKSNSimTableView crsSlope; // 10^-26 cm^2 / MeV
 
     static int GetNumEx(int ix){
       const static int num_ex[NIXSTATE] = {3, 15, 8, 1, 16};
       return num_ex[ix];
     }
+    static int GetBlockIndex(int type, int ix) { return type * NIXSTATE + ix; }
     static INISTATE    convToINISTATE(int type, int ix) {return std::make_tuple(type,ix);}
     static INIFINSTATE convToINIFINSTATE(int type, int ix, int ex, int ch) {return std::make_tuple(type,ix,ex,ch);}
     static INISTATE GetINISTATE(INIFINSTATE f){ return convToINISTATE(std::get<0>(f), std::get<1>(f));}
     static INIFINSTATE convToINIFINSTATE(INISTATE ini, int ex, int ch) {return std::make_tuple(std::get<0>(ini),std::get<1>(ini),ex,ch);}
 
     void LoadFile();
-    void LoadFile(INISTATE ini);
+    void LoadFile(INISTATE ini, std::vector<double> & /* crs */, std::vector<double> & /* slope */);
+    bool LoadCompiledTable();
     void InitializeTable();
   public:
     SKSNSimXSecNuOxygen(){
@@ -160,6 +338,8 @@ class SKSNSimXSecNuOxygen : public SKSNSimCrosssectionModel {
     double GetCrosssection(double e, INIFINSTATE inifin = {0,0,0,0}) const;
     double GetCrosssection(double e) const { return GetCrosssection(e, {0,0,0,0});};
     std::pair<double,double> GetDiffCrosssection(double, double) const;
+    double GetExcitationEnergy(int num, int ix, int ex) const { return exEne[GetBlockIndex(num, ix) * NEXSTATE + ex]; } // MeV
+    void ExportTable(SKSNSimTableFileWriter &) const; // for precompiled table file
 
     double OxigFuncAngleRecCC(int num, int ix, int ex, int ch, double enu, double cos);
     double OxigFuncRecEneCC(int num, int ix, int ex, int ch, double enu);
@@ -173,11 +353,14 @@ class SKSNSimXSecNuOxygenNC : public SKSNSimCrosssectionModel {
     constexpr static int NTYPE = 2;
     constexpr static int NEXSTATE = 8; // maximum, depending to IXSTATE, TYPE
     // constexpr static double eEneThr = 5.0;// MeV, electron total energy threshold
-    std::map<INISTATE,bool> isOpened;
-    std::map<INISTATE,int> fileSize;
-    std::map<INISTATE,std::vector<double>> exEne;
-    std::map<INISTATE,std::vector<double>> nuene;
-    std::map<INIFINSTATE, std::vector<double>> crs;
+
+    // Flat arrays: value for (type, ex, energy bin) is at crsOffset[type] + ex * (grid size) + ibin
+    bool isOpened[NTYPE];
+    SKSNSimXSecEnergyGrid nuEneGrid[NTYPE];
+    size_t crsOffset[NTYPE];
+    double exEne[NTYPE * NEXSTATE]; // MeV, [type * NEXSTATE + ex]
+    SKSNSimTableView crs; // 10^-42 cm^2
+    SKSNSimTableView crsSlope; // 10^-42 cm^2 / MeV
 
 
     static INISTATE    convToINISTATE(int type) {return std::make_tuple(type);}
@@ -186,7 +369,8 @@ class SKSNSimXSecNuOxygenNC : public SKSNSimCrosssectionModel {
     static INIFINSTATE convToINIFINSTATE(INISTATE ini, int ex) {return std::make_tuple(std::get<0>(ini),ex);}
 
     void LoadFile();
-    void LoadFile(INISTATE ini);
+    void LoadFile(INISTATE ini, std::vector<double> & /* crs */, std::vector<double> & /* slope */);
+    bool LoadCompiledTable();
     void InitializeTable();
   public:
     SKSNSimXSecNuOxygenNC(){
@@ -197,6 +381,7 @@ class SKSNSimXSecNuOxygenNC : public SKSNSimCrosssectionModel {
     double GetCrosssection(double e, INIFINSTATE inifin = {0,0}) const;
     double GetCrosssection(double e) const { return GetCrosssection(e, {0,0});};
     std::pair<double,double> GetDiffCrosssection(double, double) const;
+    void ExportTable(SKSNSimTableFileWriter &) const; // for precompiled table file
     static int GetNumEx(int type){
       const static int num_ex[NTYPE] = {8, 4};
       return num_ex[type];
@@ -213,18 +398,23 @@ class SKSNSimXSecNuOxygenSub : public SKSNSimCrosssectionModel {
     constexpr static int NIXSTATE = 5;
     constexpr static int NCHANNEL = 32;
     constexpr static double eEneThr = 5.0;// MeV, electron total energy threshold
-    std::map<INISTATE,bool> isOpened;
-    std::map<INISTATE,int> fileSize;
-    std::map<INISTATE,std::vector<double>> Enu;
-    std::map<INIFINSTATE, std::vector<double>> crs;
 
+    // Flat arrays: value for (type, ix, ch, energy bin) is at crsOffset[iblock] + ch * (grid size) + ibin
+    bool isOpened[NTYPE * NIXSTATE];
+    SKSNSimXSecEnergyGrid nuEneGrid[NTYPE * NIXSTATE];
+    size_t crsOffset[NTYPE * NIXSTATE];
+    SKSNSimTableView crs;
+    SKSNSimTableView crsSlope; // per MeV
+
+    static int GetBlockIndex(int type, int ix) { return type * NIXSTATE + ix; }
     static INISTATE    convToINISTATE(int type, int ix) {return std::make_tuple(type,ix);}
     static INIFINSTATE convToINIFINSTATE(int type, int ix, int ch) {return std::make_tuple(type,ix,ch);}
     static INISTATE GetINISTATE(INIFINSTATE f){ return convToINISTATE(std::get<0>(f), std::get<1>(f));}
     static INIFINSTATE convToINIFINSTATE(INISTATE ini, int ch) {return std::make_tuple(std::get<0>(ini),std::get<1>(ini),ch);}
 
     void LoadFile();
-    void LoadFile(INISTATE);
+    void LoadFile(INISTATE, std::vector<double> & /* crs */, std::vector<double> & /* slope */);
+    bool LoadCompiledTable();
     void InitializeTable();
 
 
@@ -237,7 +427,50 @@ class SKSNSimXSecNuOxygenSub : public SKSNSimCrosssectionModel {
     double GetCrosssection(double e, INIFINSTATE inifin = {0,0,0}) const;
     double GetCrosssection(double e) const { return GetCrosssection(e, {0,0,0});};
     std::pair<double,double> GetDiffCrosssection(double, double) const;
+    void ExportTable(SKSNSimTableFileWriter &) const; // for precompiled table file
+
+};
 
+class SKSNSimXSecVariation {
+  // Systematic variation of cross section, applied as event weight: xsec -> factor(Enu) x xsec for the reaction type.
+  // Generators store the factor of each variation as extra weight of events, and expected number of events for each variation.
+  public:
+    typedef std::function<double(double /* MeV */)> FACTORFUNC;
+  private:
+    std::string m_name;
+    XSECTYPE m_type; // mNXSECTYPE: applied to all reactions
+    FACTORFUNC m_factor;
+  public:
+    SKSNSimXSecVariation(const std::string &name, const XSECTYPE type, FACTORFUNC f): m_name(name), m_type(type), m_factor(f) {}
+    ~SKSNSimXSecVariation() {}
+    const std::string &GetName() const { return m_name; }
+    XSECTYPE GetXSecType() const { return m_type; }
+    bool IsApplied(const XSECTYPE t) const { return ( m_type == XSECTYPE::mNXSECTYPE || m_type == t ); }
+    double GetFactor(const double e, const XSECTYPE t) const { return ( IsApplied(t) ? m_factor(e) : 1.0 ); }
+
+    static SKSNSimXSecVariation MakeScale(const std::string &, const XSECTYPE, const double /* factor */);
+    static SKSNSimXSecVariation MakeIBDError(const std::string &, const double /* nsigma */, const SKSNSimXSecIBDRVV::ERRORSOURCE = SKSNSimXSecIBDRVV::kNERRORSOURCE); // uncertainty of RVV model
+    static std::vector<double> GetFactors(const std::vector<SKSNSimXSecVariation> &, const double /* MeV */, const XSECTYPE); // factor of each variation
+    static std::vector<std::string> GetNames(const std::vector<SKSNSimXSecVariation> &);
+};
+
+class SKSNSimXSecVaried : public SKSNSimCrosssectionModel {
+  // Cross section scaled by a variation, to integrate expected number of events for the variation.
+  // The base model should be alive while this is used.
+  private:
+    const SKSNSimCrosssectionModel &m_base;
+    const SKSNSimXSecVariation m_variation;
+    const XSECTYPE m_type;
+  public:
+    SKSNSimXSecVaried(const SKSNSimCrosssectionModel &base, const SKSNSimXSecVariation &v, const XSECTYPE t): m_base(base), m_variation(v), m_type(t) {}
+    ~SKSNSimXSecVaried() {}
+    const SKSNSimCrosssectionModel &GetBase() const { return m_base; }
+    double GetCrosssection(double e) const { return m_variation.GetFactor(e, m_type) * m_base.GetCrosssection(e); }
+    std::pair<double,double> GetDiffCrosssection(double e, double r) const {
+      std::pair<double,double> p = m_base.GetDiffCrosssection(e, r);
+      p.first *= m_variation.GetFactor(e, m_type);
+      return p;
+    }
 };
 
 #endif
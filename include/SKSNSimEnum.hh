@@ -11,6 +11,7 @@
 namespace SKSNSIMENUM {
   enum struct NEUTRINOOSCILLATION { kNONE = 0, kNORMAL, kINVERTED, kNNEUTRINOOSCILLATION};
   enum struct TANKVOLUME { kIDFV = 0, kIDFULL, kTANKFULL, kNTANKVOLUME};
+  enum struct SNTIMEMODE { kBINNED = 0, kINTEGRATED, kNSNTIMEMODE}; // SN burst: flux at the center of each time bin, or fluence over each time window
   enum struct SKPERIODRUN { // PERIOD >= __BEGIN && PERIOD < __END (END means it is excluded)
     SKIBEGIN, SKIEND,
     SKIIBEGIN, SKIIEND,
@@ -49,6 +49,9 @@ class SKSNSimFileOutTFile : public SKSNSimFileOutput {
     TTree *m_OutTree;
 
     Double_t weight;
+    Int_t fluxcomponent;
+    std::vector<std::string> m_xsecweight_names;
+    std::vector<Double_t> m_xsecweights; // branch "weight_<name>" for each cross-section variation
     TTree *m_OutWeightTree;
 
   public:
@@ -59,6 +62,7 @@ class SKSNSimFileOutTFile : public SKSNSimFileOutput {
     void Open(const std::string fname, const bool including_snevtinfo);
     void Open(const std::string fname) { Open(fname, false);};
     void Close();
+    void SetXSecWeightNames(const std::vector<std::string> &n) { m_xsecweight_names = n; } // should be called before Open()
 
     void Write(const SKSNSimSNEventVector &);
     void Write(const std::vector<SKSNSimSNEventVector> &vecs)
@@ -12,12 +12,46 @@
 #include <utility>
 #include <memory>
 #include <iostream>
+#include <fstream>
+#include <deque>
 #include <string>
 #include <set>
+#include <algorithm>
 #include <cstdlib>
 #include "SKSNSimTools.hh"
+#include "SKSNSimTableFile.hh"
+#include "SKSNSimGridIndex.hh"
 
 constexpr char DATADIRVARIABLENAME[] = "SKSNSIMDATADIR";
+constexpr char FLUXCACHEDIRVARIABLENAME[] = "SKSNSIMFLUXCACHEDIR";
+
+class SKSNSimFluxEnvelope {
+  // Maximum of flux over time in each energy slice, with the time of the maximum: bound for rejection sampling.
+  // Energy range is divided into equal slices. Energies out of the range belong to the first or last slice.
+  private:
+    double m_emin, m_emax;
+    std::vector<double> m_maxflux; // [slice]
+    std::vector<double> m_maxtime; // [slice]
+  public:
+    SKSNSimFluxEnvelope(const double emin, const double emax, const size_t nslice, const double t0): m_emin(emin), m_emax(emax), m_maxflux(nslice, 0.), m_maxtime(nslice, t0) {}
+    size_t GetNSlices() const { return m_maxflux.size(); }
+    double GetSliceEdge(const size_t s) const { return m_emin + ( m_emax - m_emin ) * double(s) / double(GetNSlices()); } // s = 0 ... GetNSlices()
+    size_t FindSlice(const double e) const {
+      if( !( m_emax > m_emin ) || !( e > m_emin ) ) return 0;
+      return std::min( (size_t)( ( e - m_emin ) / ( m_emax - m_emin ) * double(GetNSlices()) ), GetNSlices() - 1 );
+    }
+    void FillSlice(const size_t s, const double t, const double flux) { if( flux > m_maxflux[s] ){ m_maxflux[s] = flux; m_maxtime[s] = t; } }
+    void Fill(const double e, const double t, const double flux) { FillSlice(FindSlice(e), t, flux); }
+    double GetSliceMaxFlux(const size_t s) const { return m_maxflux[s]; }
+    double GetSliceMaxFluxTime(const size_t s) const { return m_maxtime[s]; }
+    double GetMaxFlux(const double e) const { return m_maxflux[FindSlice(e)]; } // over time, in the slice of e
+    double GetMaxFlux(const double e1, const double e2) const { // over time, in the slices of [e1, e2]
+      const size_t s1 = FindSlice(e1), s2 = FindSlice(e2);
+      return *std::max_element(m_maxflux.begin() + s1, m_maxflux.begin() + s2 + 1);
+    }
+    double GetMaxFlux() const { return *std::max_element(m_maxflux.begin(), m_maxflux.end()); }
+    double GetMaxFluxTime() const { return m_maxtime[std::max_element(m_maxflux.begin(), m_maxflux.end()) - m_maxflux.begin()]; } // time of the peak
+};
 
 class SKSNSimFluxModel {
   public:
@@ -26,6 +60,26 @@ class SKSNSimFluxModel {
       SKSNSimTools::DumpDebugMessage (" dtor SKSNSimFluxModel");
     }
     virtual double /* /cm^2/s */ GetFlux(const double /* MeV */, const double /* sec */, const FLUXNUTYPE) const = 0; // energy -> flux
+    virtual void GetFluxSpectrum(const double t /* sec */, const FLUXNUTYPE type, const size_t n, const double *e /* MeV */, double *flux /* /cm^2/s */) const { // n energies at a time -> n fluxes
+      for(size_t i = 0; i < n; i++) flux[i] = GetFlux(e[i], t, type);
+    }
+    virtual void GetFluxGrid(const size_t nt, const double *t /* sec */, const FLUXNUTYPE type, const size_t ne, const double *e /* MeV */, double *flux /* /cm^2/s, [it * ne + ie] */) const { // (time x energy) grid -> fluxes
+      for(size_t it = 0; it < nt; it++) GetFluxSpectrum(t[it], type, ne, e, flux + it * ne);
+    }
+    constexpr static size_t NFLUENCESTEP = 1000; // time steps of GetFluenceSpectrum() by default
+    virtual void GetFluenceSpectrum(const double t1 /* sec */, const double t2 /* sec */, const FLUXNUTYPE type, const size_t n, const double *e /* MeV */, double *fluence /* /cm^2 */) const { // flux integrated over [t1, t2]
+      // midpoint rule with NFLUENCESTEP steps; binned models override this with their native time grid
+      std::fill(fluence, fluence + n, 0.);
+      if( !( t2 > t1 ) ) return;
+      const double dt = ( t2 - t1 ) / double(NFLUENCESTEP);
+      std::vector<double> flux(n);
+      for(size_t it = 0; it < NFLUENCESTEP; it++){
+        GetFluxSpectrum(t1 + ( double(it) + 0.5 ) * dt, type, n, e, flux.data());
+        for(size_t i = 0; i < n; i++) fluence[i] += flux[i] * dt;
+      }
+    }
+
+    virtual void GetEnergyNodes(const double /* sec */, const FLUXNUTYPE, std::vector<double> &nodes /* MeV */) const { nodes.clear(); } // ascending energies where the flux is not smooth (nodes of the interpolation); none for smooth models
 
     virtual double /* MeV */ GetEnergyLimitMax() const = 0;
     virtual double /* MeV */ GetEnergyLimitMin() const = 0;
@@ -34,7 +88,22 @@ class SKSNSimFluxModel {
     virtual double /* MeV */ GetEnergyLimit(const bool b) const {return ( b? GetEnergyLimitMax(): GetEnergyLimitMin());};
     virtual double /* sec */ GetTimeLimit(const bool b) const {return ( b? GetTimeLimitMax(): GetTimeLimitMin());};
     virtual const std::set<FLUXNUTYPE> &GetSupportedNuTypes () const = 0;
-    virtual double FindMaxFluxTime() const = 0;
+
+    // Envelope of the flux over time, made at the first call and kept until the model is modified
+    constexpr static size_t NENVELOPESLICE = 100; // energy slices in GetEnergyLimitMin() ... GetEnergyLimitMax()
+    const SKSNSimFluxEnvelope &GetFluxEnvelope(const FLUXNUTYPE type = FLUXNUEB) const {
+      if( envelope[type] == nullptr ){
+        envelope[type] = std::make_shared<SKSNSimFluxEnvelope>(GetEnergyLimitMin(), GetEnergyLimitMax(), NENVELOPESLICE, GetTimeLimitMin());
+        FillEnvelope(type, *envelope[type]);
+      }
+      return *envelope[type];
+    }
+    virtual void FillEnvelope(const FLUXNUTYPE, SKSNSimFluxEnvelope &) const; // by default sampled on (energy x time) grid; tabulated models fill exact maxima of interpolation
+    virtual double FindMaxFluxTime() const { return GetFluxEnvelope(FLUXNUEB).GetMaxFluxTime(); } // time of the peak flux
+  protected:
+    void invalidateEnvelope() { for(int k = 0; k < NFLUXNUTYPE; k++) envelope[k].reset(); }
+  private:
+    mutable std::shared_ptr<SKSNSimFluxEnvelope> envelope[NFLUXNUTYPE];
 };
 
 class SKSNSimBinnedFluxModel : public SKSNSimFluxModel {
@@ -51,7 +120,15 @@ class SKSNSimDSNBFluxCustom : public SKSNSimBinnedFluxModel {
     std::unique_ptr<std::vector<std::pair<double,double>>> ene_flux_v; /* size_t -> <energy, flux> */
     double lower_energy_bin_width;
     double upper_energy_bin_width;
+    // lookup data made by buildIndex() after sorting: energy bin is found by SKSNSimGridIndex,
+    // and flux is interpolated with the slope precomputed for each bin
+    std::vector<double> binEne;
+    std::vector<double> binSlope; // (flux[i+1] - flux[i]) / (ene[i+1] - ene[i])
+    SKSNSimGridIndex eneIndex;
+    double integratedFlux;
     void sortByEnergy();
+    void buildIndex();
+    double interpolate(const int b, const double e) const { return binSlope[b] * (e - binEne[b]) + (*ene_flux_v)[b].second; }
 
     void loadFile(const std::string /*fname*/, const std::string /* delimeter */ = "\t");
     inline double getFluxLimit(const bool lower_limit = true /* if false -> return upper limit*/) const{
@@ -74,6 +151,8 @@ class SKSNSimDSNBFluxCustom : public SKSNSimBinnedFluxModel {
     ~SKSNSimDSNBFluxCustom(){}
     void DumpFlux(std::ostream &out = std::cout) const;
     double GetFlux(const double, const double t = 0.0, const FLUXNUTYPE nutype = FLUXNUEB) const;
+    void GetFluxSpectrum(const double, const FLUXNUTYPE, const size_t, const double *, double *) const;
+    void GetEnergyNodes(const double, const FLUXNUTYPE, std::vector<double> &nodes) const { nodes = binEne; }
     double GetEnergyLimitMax() const { return getFluxLimit(false); }
     double GetEnergyLimitMin() const { return getFluxLimit(true); }
     double GetEnergyLimit(const bool b) const { return getFluxLimit(!b); }
@@ -85,27 +164,65 @@ class SKSNSimDSNBFluxCustom : public SKSNSimBinnedFluxModel {
     int GetNBinsTime() const { return 1; }
     double GetBinWidthEne(int b) const { return getBinWidth(); }
     double GetBinWidthTime(int b) const { return 0.0; }
-    double CalcIntegratedFlux() const;
-    double FindMaxFluxTime() const {return 0.0;}
+    double CalcIntegratedFlux() const { return integratedFlux; } // computed at load
+    void FillEnvelope(const FLUXNUTYPE /* type */, SKSNSimFluxEnvelope &env) const { FillEnvelopeAt(0.0, env); }
+    void FillEnvelopeAt(const double /* time of this flux */, SKSNSimFluxEnvelope &) const; // exact maxima of the interpolation
 };
 
 class SKSNSimSNFluxCustom : public SKSNSimBinnedFluxModel {
+  // Flux table in Nakazato format: (mean energy, number flux, luminosity) of each energy bin at each time step.
+  // Table of each flavor is a contiguous array indexed by [time step * GetNBinsEne() + energy bin].
+  // The parsed table is cached in a binary file (SKSNSimTableFile format) next to the model file,
+  // or in $SKSNSIMFLUXCACHEDIR if defined, and memory-mapped at the next load.
+  // The cache is identified by the size and modification time of the model file.
+  // Time-integrated number and luminosity of each energy bin (trapezoidal over the time steps) are accumulated at load,
+  // so that fluence over any time window is given in O(GetNBinsEne()).
+  // The accumulation is stored in the cache too, and the job which parsed the model maps the cache it has written:
+  // all jobs on a node share one read-only copy in the page cache. Jobs loading the same model at once are serialized
+  // by a lock file next to the cache, so that the model is parsed only by the first one.
+  public:
+    constexpr static uint32_t CACHEVERSION = 2;
   private:
-    std::vector<double> tmesh;
-    std::vector<std::vector<double> > enue, eneb, enux, nnue, nneb, nnux, lnue, lneb, lnux;
+    SKSNSimTableView tmesh;
+    size_t nbinsEne;
+    SKSNSimTableView meanEne[NFLUXNUTYPE]; // MeV, mean energy of each bin
+    SKSNSimTableView numFlux[NFLUXNUTYPE];
+    SKSNSimTableView lumFlux[NFLUXNUTYPE];
+    std::shared_ptr<const SKSNSimTableFile> cachefile; // keeps the mapping of the cache
+    bool tmeshUniform; // time steps are equally spaced: time bin is found by index arithmetic
+    SKSNSimTableView cumNumFlux[NFLUXNUTYPE]; // integral of numFlux from tmesh[0] to tmesh[i], same indexing as numFlux
+    SKSNSimTableView cumLumFlux[NFLUXNUTYPE]; // integral of lumFlux, ditto
     const static std::set<FLUXNUTYPE> supportedType;
-    int getNBinsEne() const { return enue.front().size(); }
+    static bool &cacheEnabled() { static bool e = true; return e; }
+    void loadTextFile(const std::string &);
+    bool readCache(const std::string &, const std::vector<double> &);
+    void writeCache(const std::string &, const std::vector<double> &) const;
+    void checkTimeMesh();
+    void buildFluence();
+    void integrateBins(const double, const FLUXNUTYPE, double *, double *) const; // from tmesh[0] to t (clamped into the time range)
+    size_t findTimeBin(const double) const; // i with tmesh[i] < t <= tmesh[i+1] (i = 0 at t = tmesh[0])
+    int getNBinsEne() const { return nbinsEne; }
     int getNBinsTime() const { return tmesh.size(); }
-    double getBinWidthEne(int b) const { return enue.front().at(1) - enue.front().at(0); }
-    double getBinWidthTime(int b) const { return tmesh.at(1) - tmesh.at(0); }
+    double getBinWidthEne(int b) const { return meanEne[FLUXNUE][1] - meanEne[FLUXNUE][0]; }
+    double getBinWidthTime(int b) const { return tmesh[1] - tmesh[0]; }
   public:
-    SKSNSimSNFluxCustom(){}
+    SKSNSimSNFluxCustom(): nbinsEne(0), tmeshUniform(false) {}
     ~SKSNSimSNFluxCustom(){}
     void LoadFluxFile(std::string);
-    SKSNSimSNFluxCustom(std::string fname){ LoadFluxFile(fname); }
+    SKSNSimSNFluxCustom(std::string fname): nbinsEne(0), tmeshUniform(false) { LoadFluxFile(fname); }
+    static std::string GetCacheFileName(const std::string &); // model file -> cache file
+    static void SetCacheEnabled(const bool e) { cacheEnabled() = e; } // false: cache is neither read nor written
+    // Flux in a time step from the tables of its both ends (nbins energy bins each), shared with SKSNSimSNFluxStream:
+    // the energy bin is searched at t0 and used at both ends, and the flux is linear in time from t0 to t1.
+    static void InterpolateTimeStep(const double t, const double t0, const double t1, const size_t nbins,
+        const double *ebins0, const double *nbins0, const double *ebins1, const double *nbins1, const size_t n, const double *e, double *flux);
     double GetFlux(const double e, const double t, const FLUXNUTYPE type) const;
-    double GetEnergyLimitMax() const { return enue.front().back(); }
-    double GetEnergyLimitMin() const { return enue.front().front(); }
+    void GetFluxSpectrum(const double, const FLUXNUTYPE, const size_t, const double *, double *) const; // time bin is searched once
+    void GetBinnedFluence(const double t1, const double t2, const FLUXNUTYPE, double *num /* GetNBinsEne() values */, double *meanene /* MeV, GetNBinsEne() values */) const; // native energy bins
+    void GetFluenceSpectrum(const double, const double, const FLUXNUTYPE, const size_t, const double *, double *) const; // interpolated at the mean energies of GetBinnedFluence()
+    void GetEnergyNodes(const double, const FLUXNUTYPE, std::vector<double> &) const; // mean energies at the top of the time step
+    double GetEnergyLimitMax() const { return meanEne[FLUXNUE][nbinsEne - 1]; }
+    double GetEnergyLimitMin() const { return meanEne[FLUXNUE][0]; }
     double GetTimeLimitMax() const { return tmesh.back(); }
     double GetTimeLimitMin() const { return tmesh.front(); }
     const std::set<FLUXNUTYPE> &GetSupportedNuTypes() const { return supportedType; }
@@ -113,7 +230,7 @@ class SKSNSimSNFluxCustom : public SKSNSimBinnedFluxModel {
     int GetNBinsTime() const { return getNBinsTime(); }
     double GetBinWidthEne(int b) const { return getBinWidthEne(b); }
     double GetBinWidthTime(int b) const { return getBinWidthTime(b); } 
-    double FindMaxFluxTime() const {return 0.0;} // TODO at this momenent, this function does NOT work
+    void FillEnvelope(const FLUXNUTYPE, SKSNSimFluxEnvelope &) const; // maxima of the interpolation at the ends of each time step
 };
 const std::set<SKSNSimFluxModel::FLUXNUTYPE> SKSNSimSNFluxCustom::supportedType = {};
 
@@ -140,6 +257,7 @@ class SKSNSimSNFluxNakazatoFormat : public SKSNSimBinnedFluxModel {
     }
     ~SKSNSimSNFluxNakazatoFormat(){}
     void SetModel(std::string mname) {
+      invalidateEnvelope();
       if( const char * env_p = std::getenv(DATADIRVARIABLENAME) )
         flux.reset(new SKSNSimSNFluxCustom( std::string(env_p) + "/snburst/" + mname));
       else {
@@ -148,6 +266,10 @@ class SKSNSimSNFluxNakazatoFormat : public SKSNSimBinnedFluxModel {
       }
     }
     double GetFlux(const double e, const double t, const FLUXNUTYPE type) const { return flux->GetFlux(e,t,type); }
+    void GetFluxSpectrum(const double t, const FLUXNUTYPE type, const size_t n, const double *e, double *f) const { flux->GetFluxSpectrum(t, type, n, e, f); }
+    void GetFluxGrid(const size_t nt, const double *t, const FLUXNUTYPE type, const size_t ne, const double *e, double *f) const { flux->GetFluxGrid(nt, t, type, ne, e, f); }
+    void GetFluenceSpectrum(const double t1, const double t2, const FLUXNUTYPE type, const size_t n, const double *e, double *f) const { flux->GetFluenceSpectrum(t1, t2, type, n, e, f); }
+    void GetEnergyNodes(const double t, const FLUXNUTYPE type, std::vector<double> &nodes) const { flux->GetEnergyNodes(t, type, nodes); }
     double GetEnergyLimitMax() const { return flux->GetEnergyLimitMax(); }
     double GetEnergyLimitMin() const { return flux->GetEnergyLimitMin(); }
     double GetTimeLimitMax() const { return flux->GetTimeLimitMax(); }
@@ -157,7 +279,57 @@ class SKSNSimSNFluxNakazatoFormat : public SKSNSimBinnedFluxModel {
     int GetNBinsTime()       const { return flux->GetNBinsTime(); }
     double GetBinWidthEne(int b)  const { return flux->GetBinWidthEne(b); }
     double GetBinWidthTime(int b) const { return flux->GetBinWidthTime(b); }
-    double FindMaxFluxTime() const {return flux->FindMaxFluxTime();}
+    void FillEnvelope(const FLUXNUTYPE type, SKSNSimFluxEnvelope &env) const { flux->FillEnvelope(type, env); }
+};
+
+class SKSNSimSNFluxStream : public SKSNSimFluxModel {
+  // Flux table in Nakazato format read from the text file on demand, for models too large to be loaded at once.
+  // Only the times and file offsets of the time steps are kept; the data of at most GetWindowSize() consecutive time steps
+  // are kept in a sliding window, which is refilled forward from the requested step when the time goes out of it.
+  // Flux is the same as SKSNSimSNFluxCustom. Evaluation in ascending time (as in the generator) reads the file only once;
+  // going back in time re-reads the window. The window is modified in const methods: not thread-safe.
+  // The fluence of all flavors is calculated at once and kept for the same time range and energies, so that the calls for
+  // each flavor (as in the generator) do not re-read the file.
+  public:
+    constexpr static size_t DEFAULTWINDOWSIZE = 1000; // time steps
+  private:
+    struct TIMESTEP {
+      size_t step;
+      std::vector<double> meanEne[NFLUXNUTYPE], numFlux[NFLUXNUTYPE];
+    };
+    std::string m_fname;
+    std::vector<double> tmesh;
+    std::vector<std::streamoff> offsets; // top of the data of each time step in the file
+    size_t nbinsEne;
+    size_t m_windowsize;
+    double m_emin, m_emax; // mean energies of the first and the last bins of nue at the first time step
+    mutable std::ifstream m_ifs;
+    mutable std::deque<TIMESTEP> m_window;
+    mutable size_t m_nread; // time steps read from the file
+    mutable double m_fluence_t1, m_fluence_t2; // last call of GetFluenceSpectrum(), kept for all flavors
+    mutable std::vector<double> m_fluence_e, m_fluence[NFLUXNUTYPE];
+    const std::set<FLUXNUTYPE> supportedType = {FLUXNUE, FLUXNUEB, FLUXNUX};
+    void scanFile();
+    void readTimeStep(const size_t, TIMESTEP &) const;
+    const TIMESTEP *findTimeSteps(const size_t) const; // steps i and i+1, read if needed; pointer to step i (step i+1 follows in m_window)
+    size_t findTimeBin(const double) const; // i with tmesh[i] < t <= tmesh[i+1] (i = 0 at t = tmesh[0])
+    void fluxSpectrumInBin(const size_t, const double, const FLUXNUTYPE, const size_t, const double *, double *) const; // flux interpolated in time step i
+  public:
+    SKSNSimSNFluxStream(const std::string &fname, const size_t windowsize = DEFAULTWINDOWSIZE);
+    ~SKSNSimSNFluxStream(){}
+    size_t GetWindowSize() const { return m_windowsize; }
+    size_t GetNTimeStepsRead() const { return m_nread; }
+    int GetNBinsEne() const { return nbinsEne; }
+    int GetNBinsTime() const { return tmesh.size(); }
+    double GetFlux(const double e, const double t, const FLUXNUTYPE type) const { double f = 0.; GetFluxSpectrum(t, type, 1, &e, &f); return f; }
+    void GetFluxSpectrum(const double, const FLUXNUTYPE, const size_t, const double *, double *) const; // time steps are found once
+    void GetFluenceSpectrum(const double, const double, const FLUXNUTYPE, const size_t, const double *, double *) const; // trapezoid over the time steps, all flavors in one pass
+    void GetEnergyNodes(const double, const FLUXNUTYPE, std::vector<double> &) const; // mean energies at the top of the time step
+    double GetEnergyLimitMax() const { return m_emax; }
+    double GetEnergyLimitMin() const { return m_emin; }
+    double GetTimeLimitMax() const { return tmesh.back(); }
+    double GetTimeLimitMin() const { return tmesh.front(); }
+    const std::set<FLUXNUTYPE> &GetSupportedNuTypes() const { return supportedType; }
 };
 
 class SKSNSimSNFluxNakazato : public SKSNSimBinnedFluxModel {
@@ -174,6 +346,10 @@ class SKSNSimSNFluxNakazato : public SKSNSimBinnedFluxModel {
     }
     ~SKSNSimSNFluxNakazato(){}
     double GetFlux(const double e, const double t, const FLUXNUTYPE type) const { return flux->GetFlux(e,t,type); }
+    void GetFluxSpectrum(const double t, const FLUXNUTYPE type, const size_t n, const double *e, double *f) const { flux->GetFluxSpectrum(t, type, n, e, f); }
+    void GetFluxGrid(const size_t nt, const double *t, const FLUXNUTYPE type, const size_t ne, const double *e, double *f) const { flux->GetFluxGrid(nt, t, type, ne, e, f); }
+    void GetFluenceSpectrum(const double t1, const double t2, const FLUXNUTYPE type, const size_t n, const double *e, double *f) const { flux->GetFluenceSpectrum(t1, t2, type, n, e, f); }
+    void GetEnergyNodes(const double t, const FLUXNUTYPE type, std::vector<double> &nodes) const { flux->GetEnergyNodes(t, type, nodes); }
     double GetEnergyLimitMax() const { return flux->GetEnergyLimitMax(); }
     double GetEnergyLimitMin() const { return flux->GetEnergyLimitMin(); }
     double GetTimeLimitMax() const { return flux->GetTimeLimitMax(); }
@@ -183,7 +359,94 @@ class SKSNSimSNFluxNakazato : public SKSNSimBinnedFluxModel {
     int GetNBinsTime()       const { return flux->GetNBinsTime(); }
     double GetBinWidthEne(int b)  const { return flux->GetBinWidthEne(b); }
     double GetBinWidthTime(int b) const { return flux->GetBinWidthTime(b); }
-    double FindMaxFluxTime() const {return flux->FindMaxFluxTime();}
+    void FillEnvelope(const FLUXNUTYPE type, SKSNSimFluxEnvelope &env) const { flux->FillEnvelope(type, env); }
+};
+
+class SKSNSimPiecewiseLinear {
+  // Function of time given by a small table of (time, value): linear between the knots and constant outside
+  private:
+    std::vector<double> m_t, m_v;
+  public:
+    SKSNSimPiecewiseLinear(const double v = 0.): m_t(1, 0.), m_v(1, v) {}
+    SKSNSimPiecewiseLinear(const std::vector<double> &t, const std::vector<double> &v); // t should be in ascending order
+    static bool Parse(const std::string &, SKSNSimPiecewiseLinear &); // "{value}" or "{value}@{time}/{value}@{time}/..."
+    double operator()(const double t) const {
+      if( !( t > m_t.front() ) ) return m_v.front();
+      if( !( t < m_t.back() ) ) return m_v.back();
+      const size_t i = std::upper_bound(m_t.begin(), m_t.end(), t) - m_t.begin() - 1;
+      return m_v[i] + ( m_v[i+1] - m_v[i] ) * ( t - m_t[i] ) / ( m_t[i+1] - m_t[i] );
+    }
+    size_t GetNKnots() const { return m_t.size(); }
+    double GetKnotTime(const size_t i) const { return m_t[i]; }
+    double GetKnotValue(const size_t i) const { return m_v[i]; }
+};
+
+class SKSNSimSNFluxParametric : public SKSNSimFluxModel {
+  // Pinched Fermi-Dirac (Keil-Raffelt-Janka) spectrum emitted from the SN, in the same unit as SKSNSimSNFluxCustom (/MeV/s):
+  //   dN/dEdt = L(t)/<E>(t) x (a+1)^(a+1)/Gamma(a+1) x E^a/<E>^(a+1) x exp(-(a+1)E/<E>)
+  // with mean energy <E>(t), pinching a(t) and luminosity L(t) of each flavor given as SKSNSimPiecewiseLinear.
+  // No file is read: parameter scans are done in memory.
+  public:
+    enum PARAMETER { kMEANENERGY = 0 /* MeV */, kALPHA, kLUMINOSITY /* erg/s */, kNPARAMETER };
+  private:
+    SKSNSimPiecewiseLinear m_param[NFLUXNUTYPE][kNPARAMETER];
+    double m_emin, m_emax, m_tmin, m_tmax;
+    const std::set<FLUXNUTYPE> supportedType = {FLUXNUE, FLUXNUEB, FLUXNUX};
+    void getShape(const double t, const FLUXNUTYPE type, double *lognorm, double *alpha, double *slope) const; // dN/dEdt = exp(lognorm + alpha log(E) - slope E)
+  public:
+    SKSNSimSNFluxParametric(); // typical values of the cooling phase (see SetDefaultParameters)
+    ~SKSNSimSNFluxParametric(){}
+    void SetDefaultParameters();
+    void SetParameter(const FLUXNUTYPE type, const PARAMETER p, const SKSNSimPiecewiseLinear &f) { m_param[type][p] = f; invalidateEnvelope(); }
+    const SKSNSimPiecewiseLinear &GetParameter(const FLUXNUTYPE type, const PARAMETER p) const { return m_param[type][p]; }
+    bool SetParameters(const std::string &); // "{nue|nueb|nux|all}:{E|alpha|L}={function}[,{E|alpha|L}={function}...]", see SKSNSimPiecewiseLinear::Parse
+    void SetEnergyRange(const double emin, const double emax) { m_emin = emin; m_emax = emax; invalidateEnvelope(); }
+    void SetTimeRange(const double tmin, const double tmax) { m_tmin = tmin; m_tmax = tmax; invalidateEnvelope(); }
+    void DumpParameters(std::ostream &out = std::cout) const;
+    double GetFlux(const double e, const double t, const FLUXNUTYPE type) const;
+    void GetFluxSpectrum(const double, const FLUXNUTYPE, const size_t, const double *, double *) const; // parameters are evaluated once
+    double GetEnergyLimitMax() const { return m_emax; }
+    double GetEnergyLimitMin() const { return m_emin; }
+    double GetTimeLimitMax() const { return m_tmax; }
+    double GetTimeLimitMin() const { return m_tmin; }
+    const std::set<FLUXNUTYPE> &GetSupportedNuTypes() const { return supportedType; }
+};
+
+class SKSNSimFluxTransform : public SKSNSimFluxModel {
+  // View of another flux model, without copying it:
+  //   flux(E, t) = norm / (escale x dilation) x base(E / escale, (t - shift) / dilation)
+  // i.e. energies scaled by escale and times by dilation around t = 0 then shifted, keeping the number of neutrinos (Jacobian).
+  // Each operation is applied on top of the current transform. A transform of a transform is folded at construction into one
+  // on the same base model (later changes of the inner transform are not seen), so that the base is evaluated once per call.
+  private:
+    std::shared_ptr<const SKSNSimFluxModel> m_base;
+    double m_norm, m_escale, m_shift, m_dilation;
+    double factor() const { return m_norm / ( m_escale * m_dilation ); }
+    double baseTime(const double t) const { return ( t - m_shift ) / m_dilation; }
+  public:
+    SKSNSimFluxTransform(std::shared_ptr<const SKSNSimFluxModel>);
+    ~SKSNSimFluxTransform(){}
+    SKSNSimFluxTransform &ScaleFlux(const double f); // flux x f
+    SKSNSimFluxTransform &SetDistance(const double kpc, const double ref_kpc = 10.); // flux x (ref_kpc / kpc)^2
+    SKSNSimFluxTransform &ShiftTime(const double dt /* sec */); // t -> t + dt
+    SKSNSimFluxTransform &DilateTime(const double f); // t -> f x t, flux / f
+    SKSNSimFluxTransform &ScaleEnergy(const double f); // E -> f x E, flux / f
+    const SKSNSimFluxModel &GetBaseModel() const { return *m_base; }
+    double GetFluxScale() const { return m_norm; }
+    double GetEnergyScale() const { return m_escale; }
+    double GetTimeShift() const { return m_shift; }
+    double GetTimeDilation() const { return m_dilation; }
+    double GetFlux(const double e, const double t, const FLUXNUTYPE type) const { return factor() * m_base->GetFlux(e / m_escale, baseTime(t), type); }
+    void GetFluxSpectrum(const double, const FLUXNUTYPE, const size_t, const double *, double *) const;
+    void GetFluxGrid(const size_t, const double *, const FLUXNUTYPE, const size_t, const double *, double *) const;
+    void GetFluenceSpectrum(const double, const double, const FLUXNUTYPE, const size_t, const double *, double *) const; // fluence of the base over the mapped window
+    void GetEnergyNodes(const double, const FLUXNUTYPE, std::vector<double> &) const; // nodes of the base, scaled
+    double GetEnergyLimitMax() const { return m_escale * m_base->GetEnergyLimitMax(); }
+    double GetEnergyLimitMin() const { return m_escale * m_base->GetEnergyLimitMin(); }
+    double GetTimeLimitMax() const { return m_shift + m_dilation * m_base->GetTimeLimitMax(); }
+    double GetTimeLimitMin() const { return m_shift + m_dilation * m_base->GetTimeLimitMin(); }
+    const std::set<FLUXNUTYPE> &GetSupportedNuTypes() const { return m_base->GetSupportedNuTypes(); }
+    void FillEnvelope(const FLUXNUTYPE, SKSNSimFluxEnvelope &) const; // envelope of the base on the mapped slices
 };
 
 class SKSNSimFluxDSNBHoriuchi : SKSNSimFluxModel {
@@ -201,12 +464,15 @@ class SKSNSimFluxDSNBHoriuchi : SKSNSimFluxModel {
     }
     ~SKSNSimFluxDSNBHoriuchi (){}
     double GetFlux(const double e, const double t, const FLUXNUTYPE type) const { return customflux->GetFlux(e,t, type); }
+    void GetFluxSpectrum(const double t, const FLUXNUTYPE type, const size_t n, const double *e, double *f) const { customflux->GetFluxSpectrum(t, type, n, e, f); }
+    void GetEnergyNodes(const double t, const FLUXNUTYPE type, std::vector<double> &nodes) const { customflux->GetEnergyNodes(t, type, nodes); }
     double GetEnergyLimitMax() const { return customflux->GetEnergyLimitMax(); }
     double GetEnergyLimitMin() const { return customflux->GetEnergyLimitMin(); }
     double GetTimeLimitMax() const { return customflux->GetEnergyLimitMax(); }
     double GetTimeLimitMin() const { return customflux->GetEnergyLimitMin(); }
     void DumpFlux(std::ostream &out = std::cout) const { customflux->DumpFlux(out);};
     const std::set<FLUXNUTYPE> &GetSupportedNuTypes() const { return customflux->GetSupportedNuTypes(); }
+    void FillEnvelope(const FLUXNUTYPE type, SKSNSimFluxEnvelope &env) const { customflux->FillEnvelope(type, env); }
     double FindMaxFluxTime() const {return customflux->FindMaxFluxTime();}
 };
 
@@ -223,31 +489,50 @@ class SKSNSimFluxFlat : SKSNSimFluxModel {
     double FindMaxFluxTime() const {return 0.0;}
 };
 
-class SKSNSimDSNBFluxMonthlyCustom : SKSNSimFluxModel {
+class SKSNSimDSNBFluxMonthlyCustom : public SKSNSimFluxModel {
   private: 
-    std::vector< std::pair< int /* begin_elapsday */, std::unique_ptr<SKSNSimDSNBFluxCustom> > > custommonthlyflux;
-    void sortByTime ();
+    std::vector< std::pair< int /* begin_elapsday */, std::unique_ptr<SKSNSimDSNBFluxCustom> > > custommonthlyflux; // sorted by begin_elapsday
     const std::set<FLUXNUTYPE> supportedType = {FLUXNUEB};
     SKSNSimDSNBFluxCustom &findFluxByTime(const int /* elapsed day from 1996/01/01 */) const;
 
+    // Index built at the first lookup after AddMonthlyFlux(), so that loading N months builds it once:
+    // dense table of elapsed day -> element of custommonthlyflux, covering from the first begin-day to the last begin-day.
+    // Later days use the last element.
+    mutable std::vector<size_t> dayindex;
+    mutable bool dayindexValid = false;
+    void buildIndex() const;
+    inline const SKSNSimDSNBFluxCustom *findFluxPtrByTime(const int elapsed_day) const {
+      const int i = findIndexByTime(elapsed_day);
+      return ( i < 0 ? nullptr : custommonthlyflux[i].second.get() );
+    }
+    inline int findIndexByTime(const int elapsed_day) const { // -1 if out of range
+      if( custommonthlyflux.empty() || elapsed_day < custommonthlyflux.front().first ) return -1;
+      if( !dayindexValid ) buildIndex();
+      const size_t d = elapsed_day - custommonthlyflux.front().first;
+      return ( d < dayindex.size() ? dayindex[d] : custommonthlyflux.size() - 1 );
+    }
+
   public:
     SKSNSimDSNBFluxMonthlyCustom() {}
     ~SKSNSimDSNBFluxMonthlyCustom() {}
     void AddMonthlyFlux( const int /* elapse_day from 1996/01/01 */, std::unique_ptr<SKSNSimDSNBFluxCustom> ); /* unique_ptr will be moved to this class */
     double GetFlux(const double /* MeV */, const double /* elapsed day from 1996/01/01 */, const FLUXNUTYPE ) const;
+    void GetFluxSpectrum(const double /* elapsed day from 1996/01/01 */, const FLUXNUTYPE, const size_t, const double *, double *) const; // monthly flux is searched once
+    void GetEnergyNodes(const double /* elapsed day from 1996/01/01 */, const FLUXNUTYPE, std::vector<double> &) const; // nodes of the monthly flux
     /* this return flux which fulfilling "t >= (elem[n]->begin_elapsed_day) && t < (elem[n+1]->begin_elapsed_day)" */
 
-    double FindMaxFluxTime() const ;
+    void FillEnvelope(const FLUXNUTYPE, SKSNSimFluxEnvelope &) const; // each monthly flux at its begin-day
     SKSNSimDSNBFluxCustom &FindFluxByTime(const int d /* elapsed day from 1996/01/01 */) const { return findFluxByTime(d);}
+    double GetIntegratedFlux(const int d /* elapsed day from 1996/01/01 */) const { const SKSNSimDSNBFluxCustom *f = findFluxPtrByTime(d); return ( f == nullptr ? -1.0 : f->CalcIntegratedFlux() ); }
 
     double GetEnergyLimitMax() const { if(custommonthlyflux.empty()) return -1.0;
       return custommonthlyflux.front().second->GetEnergyLimitMax(); }
     double GetEnergyLimitMin() const { if(custommonthlyflux.empty()) return -1.0;
       return custommonthlyflux.front().second->GetEnergyLimitMin(); }
     double GetTimeLimitMax() const { if(custommonthlyflux.empty()) return -1.0;
-      return custommonthlyflux.front().first; }
+      return custommonthlyflux.back().first; } // !!Be careful!! THIS IS AN EXCEPTION OF LIMIT VALUE. THIS IS INCLUSIVE, and later days also use the last flux.
     double GetTimeLimitMin() const { if(custommonthlyflux.empty()) return -1.0;
-      return custommonthlyflux.back().first; } // !!Be careful!! THIS IS AN EXCEPTION OF LIMIT VALUE. THIS IS INCLUSIVE.
+      return custommonthlyflux.front().first; }
     const std::set<FLUXNUTYPE> &GetSupportedNuTypes() const { return supportedType; }
 };
 
@@ -0,0 +1,64 @@
+/**************************************
+ * File: SKSNSimGridIndex.hh
+ * Description:
+ *   Bin search on sorted one-dimensional grid (e.g. energies of flux table)
+ *************************************/
+
+#ifndef SKSNSIMGRIDINDEX_H_INCLUDED
+#define SKSNSIMGRIDINDEX_H_INCLUDED
+
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+
+class SKSNSimGridIndex {
+  // The grid is classified in Set(): on uniform or log-uniform grid, the bin is found by index arithmetic
+  // and shifted by at most one step; otherwise by binary search.
+  // Only the pointer to the grid is kept: call Set() again when the grid is modified or moved.
+  public:
+    enum GRIDTYPE { kGRIDIRREGULAR = 0, kGRIDUNIFORM, kGRIDLOGUNIFORM };
+  private:
+    const double *m_x;
+    size_t m_n;
+    GRIDTYPE m_type;
+    double m_min, m_step; // x or log(x)
+    bool isEquallySpaced(const bool logscale) const {
+      auto f = [logscale](const double x){ return ( logscale ? std::log(x) : x ); };
+      if( logscale && !( m_x[0] > 0. ) ) return false;
+      const double step = ( f(m_x[m_n - 1]) - f(m_x[0]) ) / double(m_n - 1);
+      if( !( step > 0. ) ) return false;
+      for(size_t i = 1; i < m_n; i++)
+        if( !( m_x[i] > m_x[i - 1] ) || std::fabs( f(m_x[i]) - ( f(m_x[0]) + step * double(i) ) ) > 1.e-3 * step ) return false;
+      return true;
+    }
+  public:
+    SKSNSimGridIndex(): m_x(nullptr), m_n(0), m_type(kGRIDIRREGULAR), m_min(0.), m_step(0.) {}
+    void Set(const double *x, const size_t n) { // x should be non-decreasing
+      m_x = x;
+      m_n = n;
+      m_type = kGRIDIRREGULAR;
+      if( m_n < 3 ) return;
+      if( isEquallySpaced(false) ){
+        m_type = kGRIDUNIFORM;
+        m_min = m_x[0];
+        m_step = ( m_x[m_n - 1] - m_x[0] ) / double(m_n - 1);
+      }
+      else if( isEquallySpaced(true) ){
+        m_type = kGRIDLOGUNIFORM;
+        m_min = std::log(m_x[0]);
+        m_step = ( std::log(m_x[m_n - 1]) - m_min ) / double(m_n - 1);
+      }
+    }
+    GRIDTYPE GetType() const { return m_type; }
+    int FindBin(const double x) const { // i with grid[i] <= x < grid[i+1], -1 if out of the grid
+      if( m_n < 2 || !( x >= m_x[0] ) || !( x < m_x[m_n - 1] ) ) return -1;
+      if( m_type == kGRIDIRREGULAR ) return int( std::upper_bound(m_x, m_x + m_n, x) - m_x ) - 1;
+      const double u = ( ( m_type == kGRIDUNIFORM ? x : std::log(x) ) - m_min ) / m_step;
+      int i = ( u > 0. ? std::min( int(u), int(m_n) - 2 ) : 0 );
+      while( i > 0 && x < m_x[i] ) i--;
+      while( x >= m_x[i + 1] ) i++;
+      return i;
+    }
+};
+
+#endif
@@ -0,0 +1,60 @@
+/**************************************
+ * File: SKSNSimIntegration.hh
+ * Description:
+ *   Numerical integration shared by generators and analysis tools
+ *************************************/
+
+#ifndef SKSNSIMINTEGRATION_H_INCLUDED
+#define SKSNSIMINTEGRATION_H_INCLUDED
+
+#include <vector>
+#include <map>
+#include <tuple>
+#include <utility>
+#include "SKSNSimFlux.hh"
+#include "SKSNSimCrosssection.hh"
+
+namespace SKSNSimIntegration {
+  struct GAUSSLEGENDRE {
+    std::vector<double> x; // nodes in [-1, 1]
+    std::vector<double> w; // weights, sum is 2
+  };
+  const GAUSSLEGENDRE &GetGaussLegendre(const size_t /* order */); // calculated once for each order
+}
+
+class SKSNSimFluxXSecIntegrator {
+  // Integral of (flux) x (total xsec) over neutrino energy.
+  // The energy range is divided at the nodes of the flux interpolation (SKSNSimFluxModel::GetEnergyNodes()),
+  // and each flux bin is divided further into equal intervals not wider than the limit,
+  // then fixed-order Gauss-Legendre rule is applied in each interval, where the flux is smooth.
+  // Error is estimated from the difference to the lower-order rule (order - 2) on the same intervals.
+  // The xsec is tabulated only once on the nodes for each (xsec, interval edges),
+  // and results are cached for each (flux, xsec, time (elapsed day for DSNB), energy range).
+  // Models are identified by their address: call ClearCache() if a model is modified after integration.
+  public:
+    typedef std::pair<double, double> RESULT; // <integral, error>
+
+  private:
+    typedef std::pair<const SKSNSimCrosssectionModel *, std::vector<double>> XSECKEY; // <xsec, edges of intervals>
+    typedef std::tuple<const SKSNSimFluxModel *, const SKSNSimCrosssectionModel *, double, int, double, double> RESULTKEY; // <flux, xsec, time, nutype, emin, emax>
+    size_t m_order;
+    size_t m_nintervals_min;
+    double m_interval_width_max; // MeV, also limited to (energy range) / m_nintervals_min
+    std::map<XSECKEY, std::vector<double>> xsectable; // xsec on the nodes: for each interval, nodes of m_order followed by nodes of (m_order - 2)
+    std::map<RESULTKEY, RESULT> resultcache;
+
+    std::vector<double> makeEdges(const SKSNSimFluxModel &, const double, const double, const double, const SKSNSimFluxModel::FLUXNUTYPE) const;
+    const std::vector<double> &getXSecTable(const SKSNSimCrosssectionModel &, const std::vector<double> &);
+
+  public:
+    SKSNSimFluxXSecIntegrator(const size_t order = 5, const size_t nintervals_min = 100, const double width_max = 0.5 /* MeV */);
+    ~SKSNSimFluxXSecIntegrator() {}
+    RESULT Integrate(const SKSNSimFluxModel &, const SKSNSimCrosssectionModel &,
+        const double /* MeV */, const double /* MeV */,
+        const double /* time, elapsed day for DSNB */ = 0.,
+        const SKSNSimFluxModel::FLUXNUTYPE = SKSNSimFluxModel::FLUXNUEB);
+    void ClearCache() { xsectable.clear(); resultcache.clear(); }
+    size_t GetOrder() const { return m_order; }
+};
+
+#endif
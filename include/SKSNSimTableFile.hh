@@ -0,0 +1,151 @@
+/**************************************
+ * File: SKSNSimTableFile.hh
+ * Description:
+ *   Precompiled binary file of cross-section tables (table/sksnsim_tables.bin)
+ *   It is made by main_tablecompile from the text/ROOT tables in table/,
+ *   and memory-mapped by generators instead of parsing the original tables.
+ *   The same tables can be generated as C++ source and compiled into lib/libSKSNSim.so.
+ *************************************/
+
+#ifndef SKSNSIMTABLEFILE_H_INCLUDED
+#define SKSNSIMTABLEFILE_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <utility>
+#include <cstdint>
+
+class SKSNSimTableView {
+  // Read-only array of double: owned by itself, or zero-copy view of the memory-mapped table file
+  private:
+    std::vector<double> m_own;
+    const double *m_data;
+    size_t m_size;
+  public:
+    SKSNSimTableView(): m_data(nullptr), m_size(0) {}
+    SKSNSimTableView(const SKSNSimTableView &v): m_own(v.m_own), m_data(v.IsMapped() ? v.m_data : m_own.data()), m_size(v.m_size) {}
+    SKSNSimTableView &operator=(const SKSNSimTableView &v) {
+      if( this == &v ) return *this;
+      if( v.IsMapped() ){ Map(v.m_data, v.m_size); return *this; } // own data are released
+      m_own = v.m_own;
+      m_data = ( v.IsMapped() ? v.m_data : m_own.data() );
+      m_size = v.m_size;
+      return *this;
+    }
+    void Assign(std::vector<double> v) { m_own = std::move(v); m_data = m_own.data(); m_size = m_own.size(); }
+    void Map(const double *data, const size_t size) { std::vector<double>().swap(m_own); m_data = data; m_size = size; }
+    void Clear() { Assign(std::vector<double>()); }
+    bool IsMapped() const { return ( m_size > 0 && m_data != m_own.data() ); }
+    const double &operator[](const size_t i) const { return m_data[i]; }
+    const double *data() const { return m_data; }
+    const double *begin() const { return m_data; }
+    const double *end() const { return m_data + m_size; }
+    const double &front() const { return m_data[0]; }
+    const double &back() const { return m_data[m_size - 1]; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    std::vector<double> ToVector() const { return std::vector<double>(m_data, m_data + m_size); }
+};
+
+class SKSNSimTableFile {
+  // File layout (native endian):
+  //   TABLEFILEHEADER, TABLEFILEENTRY x nentries, then arrays of double aligned to ALIGNMENT bytes.
+  //   Checksums (FNV-1a 64bit) are kept for the entry list (in the header) and for the data of each entry.
+  //   The entry list is verified at open, and the data of each entry at its first Get(),
+  //   so that only the pages of the tables actually used are read.
+  //   Entries named SOURCEPREFIX + (file name) hold (size, mtime sec, mtime nsec) of the original tables in table/;
+  //   GetInstance() warns if the tables are modified after main_tablecompile.
+  // The file is mapped once per process at the first call of GetInstance(), and kept until exit.
+  // Tables compiled into the library (BAKEDENTRY) are used in the same way without the file,
+  // and overridden by the entries of the same name in the file.
+  public:
+    constexpr static uint32_t VERSION = 2;
+    constexpr static size_t ALIGNMENT = 64; // bytes
+    constexpr static size_t NAMELENGTH = 48; // including null termination
+    constexpr static char SOURCEPREFIX[] = "source/";
+    struct TABLEFILEHEADER {
+      char magic[8];
+      uint32_t version;
+      uint32_t nentries;
+      uint64_t checksum; // of the entry list
+      uint64_t filesize;
+    };
+    struct TABLEFILEENTRY {
+      char name[NAMELENGTH];
+      uint64_t offset; // bytes from the top of file
+      uint64_t size; // number of doubles
+      uint64_t checksum; // of the data
+    };
+    struct BAKEDENTRY {
+      // table compiled into the library (generated by main_tablecompile --source)
+      const char *name;
+      const double *data;
+      size_t size;
+    };
+
+  private:
+    struct ENTRYREF {
+      const double *data;
+      size_t size;
+      uint64_t checksum;
+      mutable int verified; // 1: checksum is correct (or baked), 0: not yet checked, -1: broken
+    };
+    void *m_addr;
+    size_t m_length;
+    size_t m_nmapped; // number of tables in the file
+    std::string m_fname;
+    std::map<std::string, ENTRYREF> m_entries; // baked tables and tables in the file
+    static bool &enabled() { static bool e = true; return e; }
+    static std::vector<std::pair<const BAKEDENTRY *, size_t>> &baked() { static std::vector<std::pair<const BAKEDENTRY *, size_t>> b; return b; }
+
+    SKSNSimTableFile();
+    SKSNSimTableFile(const SKSNSimTableFile &) = delete;
+    SKSNSimTableFile &operator=(const SKSNSimTableFile &) = delete;
+    bool open(const std::string &, const std::string & /* hint in the message of broken file */);
+    void close();
+    void checkSources(const std::string & /* directory of the original tables */) const;
+
+  public:
+    ~SKSNSimTableFile() { close(); }
+    static const SKSNSimTableFile &GetInstance();
+    static std::shared_ptr<const SKSNSimTableFile> Open(const std::string &); // other file of the same format (e.g. cache), nullptr if missing or broken
+    static std::string GetDefaultFileName(); // $SKSNSIMINSTALLDIR/table/sksnsim_tables.bin, empty if the variable is not defined
+    static void SetEnabled(const bool e) { enabled() = e; } // false: neither the file nor the baked tables are used (call before the first GetInstance())
+    static bool RegisterBakedTables(const BAKEDENTRY *, const size_t); // called in static initialization of the generated source, before the first GetInstance()
+    static uint64_t CalcChecksum(const unsigned char *, const size_t);
+    bool IsOpen() const { return m_addr != nullptr; }
+    const std::string &GetFileName() const { return m_fname; }
+    bool Get(const std::string & /* name */, SKSNSimTableView &) const; // false if not found or broken
+};
+
+class SKSNSimFileLock {
+  // Exclusive lock (flock) of a file, created if missing, held until destruction.
+  // Used to serialize jobs writing the same file; without lock if the name is empty or the file cannot be created.
+  private:
+    int m_fd;
+    SKSNSimFileLock(const SKSNSimFileLock &) = delete;
+    SKSNSimFileLock &operator=(const SKSNSimFileLock &) = delete;
+  public:
+    SKSNSimFileLock(const std::string &);
+    ~SKSNSimFileLock();
+    bool IsLocked() const { return m_fd >= 0; }
+};
+
+class SKSNSimTableFileWriter {
+  private:
+    std::vector<std::pair<std::string, std::vector<double>>> m_entries;
+  public:
+    SKSNSimTableFileWriter() {}
+    ~SKSNSimTableFileWriter() {}
+    void Add(const std::string &, const double *, const size_t);
+    void Add(const std::string &name, const std::vector<double> &v) { Add(name, v.data(), v.size()); }
+    void Add(const std::string &name, const SKSNSimTableView &v) { Add(name, v.data(), v.size()); }
+    bool AddSource(const std::string & /* original table */); // size and modification time, false if missing
+    size_t GetNEntries() const { return m_entries.size(); }
+    bool Write(const std::string &) const;
+    bool WriteSource(const std::string &) const; // C++ source of constexpr arrays, to be compiled into the library
+};
+
+#endif
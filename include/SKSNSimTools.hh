@@ -42,6 +42,20 @@ namespace SKSNSimTools{
   int elapseday(int /* run */);
 }
 
+class SKSNSimAliasTable {
+  // Walker's alias method: sampling index i with probability w_i / sum(w) in O(1)
+  private:
+    std::vector<double> m_prob;
+    std::vector<size_t> m_alias;
+  public:
+    SKSNSimAliasTable() {}
+    SKSNSimAliasTable(const std::vector<double> &w) { Build(w); }
+    ~SKSNSimAliasTable() {}
+    void Build(const std::vector<double> & /* weights, non-negative */);
+    size_t Sample(TRandom &) const;
+    size_t GetSize() const { return m_prob.size(); }
+};
+
 namespace SKSNSimLiveTime {
   typedef std::tuple<int /* runnum */, double /*livetime_day */> RECORDLIVETIME;
   
@@ -12,6 +12,7 @@
 #include <cstdlib>
 #include <string>
 #include <vector>
+#include <set>
 #include <memory>
 #include <TRandom3.h>
 #include "skrun.h"
@@ -36,6 +37,8 @@ class SKSNSimUserConfiguration{
     double m_time_min;
     double m_time_max;
     size_t m_time_nbins;
+    SKSNSIMENUM::SNTIMEMODE m_time_mode;
+    std::vector<double> m_time_windows; // edges of time windows (sec) in time-integrated mode, empty: [m_time_min, m_time_max]
 
     /* Output file related */
     std::string m_output_directory;
@@ -60,11 +63,17 @@ class SKSNSimUserConfiguration{
 
     /* SN related */
     double m_sndistance_kpc;
+    double m_sn_elastic_ethr;
+    std::set<XSECTYPE> m_sn_reactions;
 
     /* Physics related */
     SKSNSIMENUM::NEUTRINOOSCILLATION m_nuosc_type;
+    std::vector<SKSNSimXSecVariation> m_xsec_variations; // stored as extra weights
     std::string m_snburst_fluxmodel;
+    std::vector<std::string> m_snburst_fluxparameters; // settings of SKSNSimSNFluxParametric, used instead of m_snburst_fluxmodel if not empty
+    size_t m_snburst_streamwindow; // time steps kept in memory by SKSNSimSNFluxStream, 0: whole model is loaded
     std::string m_dsnb_fluxmodel;
+    std::vector<std::pair<std::string, double>> m_dsnb_addfluxmodels; // additional flux components: <filename, normalization>
     bool m_dsnb_flatflux;
 
     /* Random Generator related */
@@ -82,6 +91,7 @@ class SKSNSimUserConfiguration{
     bool CheckOFileMode() const { return m_mode_ofile != MODEOFILE::kNMODEOFILE; }
 
     static std::string convOFileModeString(MODEOFILE m);
+    static std::string convReactionString(XSECTYPE t);
 
   public:
     void SetDefaultConfiguation() {
@@ -91,6 +101,8 @@ class SKSNSimUserConfiguration{
       m_time_min = GetDefaultFluxTimeMin();
       m_time_max = GetDefaultFluxTimeMax();
       m_time_nbins = GetDefaultTimeNBins();
+      m_time_mode = SKSNSIMENUM::SNTIMEMODE::kBINNED;
+      m_time_windows.clear();
 
       m_output_directory = GetDefaultOutputDirectory();
       m_outputfile_prefix = GetDefaultOutputPrefix();
@@ -111,11 +123,17 @@ class SKSNSimUserConfiguration{
       m_subrunnum = GetDefaultSubRunnum();
 
       m_sndistance_kpc = GetDefaultSNDistanceKPC();
+      m_sn_elastic_ethr = GetDefaultElasticEnergyThreshold();
+      m_sn_reactions = GetDefaultSNReactions();
       m_snburst_fluxmodel = GetDefaultSNBurstFluxModel();
+      m_snburst_fluxparameters.clear();
+      m_snburst_streamwindow = 0;
       m_dsnb_fluxmodel = GetDefaultDSNBFluxModel();
+      m_dsnb_addfluxmodels.clear();
       m_dsnb_flatflux = GetDefaultDSNBFlatFlux();
 
       m_nuosc_type = GetDefaultNeutrinoOscType();
+      m_xsec_variations.clear();
 
       m_random_seed = GetDefaultRandomSeed();
     }
@@ -146,6 +164,8 @@ class SKSNSimUserConfiguration{
     const static SKSNSIMENUM::TANKVOLUME GetDefaultEventVolume () { return SKSNSIMENUM::TANKVOLUME::kIDFULL; }
     const static SKSNSIMENUM::NEUTRINOOSCILLATION GetDefaultNeutrinoOscType () { return SKSNSIMENUM::NEUTRINOOSCILLATION::kNONE; }
     const static double GetDefaultSNDistanceKPC () { return 10. /* kpc */;}
+    const static double GetDefaultElasticEnergyThreshold () { return 5.0 /* MeV, electron total energy */;}
+    const static std::set<XSECTYPE> GetDefaultSNReactions () { return { XSECTYPE::mXSECIBD, XSECTYPE::mXSECELASTIC, XSECTYPE::mXSECOXYGEN, XSECTYPE::mXSECOXYGENSUB, XSECTYPE::mXSECOXYGENNC }; }
     const static std::string GetDefaultSNModelName () { return "nakazato/intp2002.data" ;}
     const static bool GetDefaultVectorGeneration () { return true; } 
     const static std::string GetDefaultOutputDirectory () { return "./vectout"; }
@@ -198,6 +218,9 @@ class SKSNSimUserConfiguration{
     SKSNSimUserConfiguration &SetFluxTimeMin(double t){ m_time_min = t; return *this;}
     SKSNSimUserConfiguration &SetFluxTimeMax(double t){ m_time_max = t; return *this;}
     SKSNSimUserConfiguration &SetTimeNBins(size_t n){ m_time_nbins = n; return *this;}
+    SKSNSimUserConfiguration &SetTimeMode(SKSNSIMENUM::SNTIMEMODE m){ m_time_mode = m; return *this;}
+    SKSNSimUserConfiguration &SetTimeWindows(const std::vector<double> &w){ m_time_windows = w; return *this;}
+    SKSNSimUserConfiguration &SetTimeWindows(std::string /* comma-separated edges, or "full" */, bool exit_if_wrong); // switches to time-integrated mode
     SKSNSimUserConfiguration &SetNumEvents(size_t n){m_num_events = n; return *this;}
     SKSNSimUserConfiguration &SetNumEventsPerFile(size_t n){m_num_per_file = n; return *this;}
     SKSNSimUserConfiguration &SetNormRuntime(bool t){m_runtime_normalization = t; return *this;}
@@ -210,12 +233,22 @@ class SKSNSimUserConfiguration{
     SKSNSimUserConfiguration &SetRuntimeRunEnd(int r) { m_runtime_runend = r; return *this;}
     SKSNSimUserConfiguration &SetRuntimePeriod(int p) { m_runtime_period = p; return *this;}
     SKSNSimUserConfiguration &SetSNDistanceKpc(double d) { m_sndistance_kpc = d; return *this;}
+    SKSNSimUserConfiguration &SetElasticEnergyThreshold(double e) { m_sn_elastic_ethr = e; return *this;}
+    SKSNSimUserConfiguration &SetSNReactions(const std::set<XSECTYPE> &r) { m_sn_reactions = r; return *this;}
+    SKSNSimUserConfiguration &SetSNReactions(std::string /* comma-separated names, or "all" */, bool exit_if_wrong);
     SKSNSimUserConfiguration &SetSNBurstFluxModel(std::string f) { m_snburst_fluxmodel = f; return *this;}
+    SKSNSimUserConfiguration &SetSNBurstStreamWindow(size_t n) { m_snburst_streamwindow = n; return *this;}
+    SKSNSimUserConfiguration &SetSNBurstStreamWindow(std::string /* positive number of time steps */, bool exit_if_wrong);
+    SKSNSimUserConfiguration &AddSNBurstFluxParameters(std::string /* see SKSNSimSNFluxParametric::SetParameters */, bool exit_if_wrong);
     SKSNSimUserConfiguration &SetDSNBFluxModel(std::string f) { m_dsnb_fluxmodel = f; return *this;}
+    SKSNSimUserConfiguration &AddDSNBFluxModel(std::string f, double norm = 1.0) { m_dsnb_addfluxmodels.push_back(std::make_pair(f, norm)); return *this;}
+    SKSNSimUserConfiguration &AddDSNBFluxModel(std::string /* filename[:norm] */, bool exit_if_wrong);
     SKSNSimUserConfiguration &SetDSNBFlatFlux(bool f) { m_dsnb_flatflux = f; return *this;}
     SKSNSimUserConfiguration &SetVectorGeneration(bool f) { m_eventvector_generation = f; return *this;}
     SKSNSimUserConfiguration &SetNeutrinoOscType( SKSNSIMENUM::NEUTRINOOSCILLATION t) { m_nuosc_type = t; return *this; }
     SKSNSimUserConfiguration &SetNeutrinoOscType( int t) { m_nuosc_type = (SKSNSIMENUM::NEUTRINOOSCILLATION)t; return *this; }
+    SKSNSimUserConfiguration &AddXSecVariation(const SKSNSimXSecVariation &v) { m_xsec_variations.push_back(v); return *this; }
+    SKSNSimUserConfiguration &AddXSecVariations(std::string /* comma-separated list */, bool exit_if_wrong);
     SKSNSimUserConfiguration &SetRunnum(int r) { m_runnum = r; return *this; }
     SKSNSimUserConfiguration &SetSubRunnum(int r) { m_subrunnum = r; return *this; }
     SKSNSimUserConfiguration &SetOFileMode ( MODEOFILE m ) { m_mode_ofile = m; return *this; }
@@ -228,6 +261,8 @@ class SKSNSimUserConfiguration{
     double GetFluxTimeMin() const { return m_time_min;}
     double GetFluxTimeMax() const { return m_time_max;}
     size_t GetTimeNBins() const { return m_time_nbins;}
+    SKSNSIMENUM::SNTIMEMODE GetTimeMode() const { return m_time_mode;}
+    const std::vector<double> &GetTimeWindows() const { return m_time_windows;}
 
     /* Output file related */
     std::string GetOutputDirectory() const { return m_output_directory;}
@@ -253,12 +288,20 @@ class SKSNSimUserConfiguration{
 
     /* SN related */
     double GetSNDistanceKpc() const { return m_sndistance_kpc; }
+    double GetElasticEnergyThreshold() const { return m_sn_elastic_ethr; }
+    const std::set<XSECTYPE> &GetSNReactions() const { return m_sn_reactions; }
+    std::string GetSNReactionsString() const;
     std::string GetSNBurstFluxModel() const { return m_snburst_fluxmodel; }
+    const std::vector<std::string> &GetSNBurstFluxParameters() const { return m_snburst_fluxparameters; }
+    bool GetSNBurstParametricFlux() const { return !m_snburst_fluxparameters.empty(); }
+    size_t GetSNBurstStreamWindow() const { return m_snburst_streamwindow; }
     std::string GetDSNBFluxModel() const { return m_dsnb_fluxmodel; }
+    const std::vector<std::pair<std::string, double>> &GetDSNBAdditionalFluxModels() const { return m_dsnb_addfluxmodels; }
     bool GetDSNBFlatFlux() const { return m_dsnb_flatflux; }
 
     /* Physics related */
     SKSNSIMENUM::NEUTRINOOSCILLATION GetNuOscType() const { return m_nuosc_type; }
+    const std::vector<SKSNSimXSecVariation> &GetXSecVariations() const { return m_xsec_variations; }
 
     unsigned GetRandomSeed() const {return m_random_seed;}
     std::shared_ptr<TRandom> GetRandomGenerator() { return m_randomgenerator;}
@@ -271,6 +314,7 @@ class SKSNSimUserConfiguration{
 
     void Apply( SKSNSimVectorSNGenerator &gen ) const ;
     void Apply( SKSNSimVectorGenerator   &gen ) const ;
+    void Apply( SKSNSimSNFluxParametric  &flux ) const ;
 
   public:
     static void ShowHelpDSNB(const char *argv0);
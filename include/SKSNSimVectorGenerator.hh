@@ -9,6 +9,8 @@
 #define SKSNSIMVECTORGENERATOR_H_INCLUDED
 
 #include <memory>
+#include <set>
+#include <functional>
 #include <mcinfo.h>
 #include <TRandom3.h>
 #include <algorithm>
@@ -16,6 +18,7 @@
 #include "SKSNSimCrosssection.hh"
 #include "SKSNSimEnum.hh"
 #include "SKSNSimTools.hh"
+#include "SKSNSimIntegration.hh"
 
 extern "C" {
   // From SKOFL
@@ -106,6 +109,8 @@ class SKSNSimSNEventVector {
     size_t m_n_randomthrow;
     double m_weight_maxprob;
     double m_weight;
+    int m_flux_component; // index of flux model used to generate this event
+    std::vector<double> m_xsec_weights; // factor of each cross-section variation of the generator (ratio to the nominal)
 
     struct VERTEX {
       double x,y,z; // cm
@@ -143,7 +148,7 @@ class SKSNSimSNEventVector {
     unsigned int m_randomseed;
 
   public:
-    SKSNSimSNEventVector() : m_n_randomthrow(0), m_weight_maxprob(0.), m_weight(0.) {sninfo.iEvt = -1;};
+    SKSNSimSNEventVector() : m_n_randomthrow(0), m_weight_maxprob(0.), m_weight(0.), m_flux_component(0) {sninfo.iEvt = -1;};
     ~SKSNSimSNEventVector() {};
     int AddVertex(
         double x, double y, double z,
@@ -208,15 +213,25 @@ class SKSNSimSNEventVector {
     auto GetWeight() const { return m_weight; }
     auto SetWeight(const double w) { m_weight= w; return GetWeight(); }
 
+    int GetFluxComponent() const { return m_flux_component; }
+    int SetFluxComponent(const int c) { m_flux_component = c; return GetFluxComponent(); }
+
+    const std::vector<double> &GetXSecWeights() const { return m_xsec_weights; }
+    void SetXSecWeights(const std::vector<double> &w) { m_xsec_weights = w; }
+
     unsigned int GetRandomSeed() const { return m_randomseed; }
     unsigned int SetRandomSeed(const unsigned int r) { m_randomseed = r; return GetRandomSeed(); } // This does NOT apply seed value. Just holding runtime-configuration
 
     bool operator< (const SKSNSimSNEventVector &a){ return sninfo.rTime < a.sninfo.rTime; }
 };
 
+// Receiver of generated events, called for each event as soon as it is generated (e.g. writing into output file)
+typedef std::function<void(const SKSNSimSNEventVector &)> SKSNSimEventSink;
+
 class SKSNSimVectorGenerator {
   private:
     std::vector<std::unique_ptr<SKSNSimFluxModel>> fluxmodels;
+    std::vector<double> fluxnorms; // normalization of each flux component
     std::vector<std::unique_ptr<SKSNSimCrosssectionModel>> xsecmodels;
     SKSNSimSNEventVector GenerateSNEvent(){
       return SKSNSimSNEventVector();
@@ -242,25 +257,73 @@ class SKSNSimVectorGenerator {
 
     // For hit-and-miss method
     double m_max_hit_probability; // maximum of (flux) x (xsec) // should be updated with new flux or xsec models
+    std::vector<double> m_max_hit_probabilities; // same as above for each flux component
     static double FindMaxProb ( SKSNSimFluxModel &, SKSNSimCrosssectionModel &, int /* elapseday */ = -1);
     double SetMaximumHitProbability();
+
+    // Mixture of flux components: updated when the run number is changed
+    int m_cached_runnum;
+    int m_cached_elapseday;
+    double m_flux_integral; // sum of m_component_integrals
+    double m_flux_integral_error; // error estimate of the quadrature for m_flux_integral
+    std::vector<double> m_component_integrals; // (normalization) x integral of (flux) x (xsec) for each flux component
+    SKSNSimAliasTable m_component_table; // to select the flux component per event
+    SKSNSimFluxXSecIntegrator m_integrator; // xsec table and integrals are cached over runs
+    void UpdateFluxComponents();
+
+    // Cross-section variations stored as extra weights of events
+    std::vector<SKSNSimXSecVariation> m_xsec_variations;
+    std::vector<std::unique_ptr<SKSNSimXSecVaried>> m_varied_xsecs; // varied xsec of xsecmodels[0], to integrate expected number of events
+    std::vector<double> m_variation_integrals; // integral of (flux) x (varied xsec) for each variation, summed over flux components
+
+    // Buffer of flat-positron events as structure of arrays (SoA), used by GenerateEventsIBDFlat()
+    struct IBDFLATBATCH {
+      std::vector<double> rnd; // uniform random numbers, NRANDOM blocks of n
+      std::vector<double> eEne, cost, nuEne; // MeV, a.u., MeV
+      std::vector<double> vtx_x, vtx_y, vtx_z; // cm
+      std::vector<double> nuDir_x, nuDir_y, nuDir_z;
+      std::vector<double> eDir_x, eDir_y, eDir_z;
+      void Resize(const size_t n);
+      size_t GetSize() const { return eEne.size(); }
+    };
+    void FillBatchIBDFlat(IBDFLATBATCH &, const size_t /* n */);
+    SKSNSimSNEventVector ConvertBatchIBDFlat(const IBDFLATBATCH &, const size_t /* index */) const;
     
   public:
     SKSNSimVectorGenerator():
       m_runnum((int)SKSNSIMENUM::SKPERIODRUN::SKMC),
       m_subrunnum(0),
       m_flat_pos_energy ( false ),
-      m_generator_volume(SKSNSIMENUM::TANKVOLUME::kIDFULL)
+      m_generator_volume(SKSNSIMENUM::TANKVOLUME::kIDFULL),
+      m_cached_runnum(-1),
+      m_cached_elapseday(-1),
+      m_flux_integral(-1.),
+      m_flux_integral_error(-1.)
     {}
     ~SKSNSimVectorGenerator(){}
-    void AddFluxModel(SKSNSimFluxModel *fm){ fluxmodels.push_back(std::move(std::unique_ptr<SKSNSimFluxModel>(fm))); SetMaximumHitProbability(); } // after this, the pointer will be managed by SKSNSimVectorGenerator class
-    void AddXSecModel(SKSNSimCrosssectionModel *xm){ xsecmodels.push_back(std::move(std::unique_ptr<SKSNSimCrosssectionModel>(xm))); SetMaximumHitProbability(); } // after this, the pointer will be managed by SKSNSimVectorGenerator class
+    void AddFluxModel(SKSNSimFluxModel *fm, const double norm = 1.0){ fluxmodels.push_back(std::move(std::unique_ptr<SKSNSimFluxModel>(fm))); fluxnorms.push_back(norm); m_cached_runnum = -1; SetMaximumHitProbability(); } // after this, the pointer will be managed by SKSNSimVectorGenerator class. Multiple flux models are sampled as a mixture weighted by (norm) x integral of (flux) x (xsec)
+    void AddXSecModel(SKSNSimCrosssectionModel *xm){ xsecmodels.push_back(std::move(std::unique_ptr<SKSNSimCrosssectionModel>(xm))); m_cached_runnum = -1; SetMaximumHitProbability(); } // after this, the pointer will be managed by SKSNSimVectorGenerator class
+    size_t GetNFluxComponents() const { return fluxmodels.size(); }
+    double GetFluxComponentNorm(const size_t i) const { return ( i < fluxnorms.size() ? fluxnorms[i] : -1.); }
+    double GetFluxComponentIntegral(const size_t i) const { return ( i < m_component_integrals.size() ? m_component_integrals[i] : -1.); } // valid after the first event of the run
+    double GetFluxIntegral() const { return m_flux_integral; } // valid after the first event of the run
+    double GetFluxIntegralError() const { return m_flux_integral_error; } // valid after the first event of the run
+    void AddXSecVariation(const SKSNSimXSecVariation &v) { m_xsec_variations.push_back(v); m_cached_runnum = -1; } // IBD events get factor of the variation as extra weight
+    const std::vector<SKSNSimXSecVariation> &GetXSecVariations() const { return m_xsec_variations; }
+    std::vector<std::string> GetXSecVariationNames() const { return SKSNSimXSecVariation::GetNames(m_xsec_variations); }
+    double GetXSecVariationIntegral(const size_t i) const { return ( i < m_variation_integrals.size() ? m_variation_integrals[i] : -1.); } // valid after the first event of the run
     SKSNSimSNEventVector GenerateEventIBD();
     SKSNSimSNEventVector GenerateEventIBDFlat();
     SKSNSimSNEventVector GenerateEvent() { return m_flat_pos_energy? GenerateEventIBDFlat(): GenerateEventIBD(); }; // Tentatively, supporting only IBD channel
+    size_t GenerateEventsIBDFlat(const size_t n, std::function<void(const std::vector<SKSNSimSNEventVector> &)> writer, const size_t nchunk = 10000); // batch version of GenerateEventIBDFlat(), events are passed to writer every nchunk events
+    size_t GenerateEvents(int n, SKSNSimEventSink sink) {
+      for(int i = 0; i < n; i++) sink(GenerateEvent());
+      return (n > 0 ? n : 0);
+    };
     std::vector<SKSNSimSNEventVector> GenerateEvents(int n) {
-      std::vector<SKSNSimSNEventVector> buf(n);
-      for(auto it = buf.begin(); it != buf.end(); it++) *it = GenerateEvent();
+      std::vector<SKSNSimSNEventVector> buf;
+      buf.reserve(n > 0 ? n : 0);
+      GenerateEvents(n, [&buf](const SKSNSimSNEventVector &ev){ buf.push_back(ev); });
       return buf;
     } ;
     // std::vector<SKSNSimSNEventVector> GenerateEventsAlongLivetime(int, int, double);
@@ -296,7 +359,12 @@ class SKSNSimVectorGenerator {
 class SKSNSimVectorSNGenerator {
   private:
     std::vector<std::unique_ptr<SKSNSimFluxModel>> fluxmodels;
-    std::map<XSECTYPE, std::shared_ptr<SKSNSimCrosssectionModel>> xsecmodels;
+    std::map<XSECTYPE, std::shared_ptr<SKSNSimCrosssectionModel>> xsecmodels; // only models of selected reactions are constructed, at GenerateEvents()
+    std::set<XSECTYPE> m_reactions; // reactions to be simulated
+    double m_elastic_ethr; // MeV, kept here since the elastic model may not be constructed yet
+    std::vector<SKSNSimXSecVariation> m_xsec_variations; // stored as extra weights of events
+    static XSECTYPE GetXSecType(const int /* nReact */);
+    void LoadXSecModels();
     SKSNSimSNEventVector GenerateSNEvent(){
       return SKSNSimSNEventVector();
     }
@@ -311,6 +379,8 @@ class SKSNSimVectorSNGenerator {
     double m_generator_time_min;
     double m_generator_time_max;
     size_t m_time_nbins;
+    SKSNSIMENUM::SNTIMEMODE m_time_mode;
+    std::vector<double> m_time_windows; // edges of time windows in kINTEGRATED mode, empty: whole time range
     bool   m_fill_event;
     SKSNSIMENUM::TANKVOLUME m_generator_volume;
 
@@ -332,8 +402,18 @@ class SKSNSimVectorSNGenerator {
 
     //double SetMaximumHitProbability();
     std::vector<SKSNSimSNEventVector> MakeEvent(const double nuEneBinSize, const double tBinSize, const double time, const double nu_energy, const int nReact, const int nuType, const double rate);
-    void FillEvent(std::vector<SKSNSimSNEventVector> &evt_buffer);
-    static void determineKinematics( std::map<XSECTYPE, std::shared_ptr<SKSNSimCrosssectionModel>> xsecmodels, TRandom &rng, SKSNSimSNEventVector &ev, const double snDir[]);
+
+    // Number of generated events for each reaction, accumulated over FillEvent() calls
+    struct GENCOUNTER {
+      int totGenNuebarp=0;
+      int totGenNueElastic=0, totGenNuebarElastic=0, totGenNuxElastic=0, totGenNuxbarElastic=0;
+      int totGenNueO=0, totGenNuebarO=0;
+      int totGenNueOsub=0, totGenNuebarOsub=0;
+      int totGenNcNuep=0, totGenNcNuebarp=0, totGenNcNuxp=0, totGenNcNuxbarp=0, totGenNcNuen=0, totGenNcNuebarn=0, totGenNcNuxn=0, totGenNcNuxbarn=0;
+    };
+    void FillEvent(std::vector<SKSNSimSNEventVector> &evt_buffer, const size_t iEvtOffset, GENCOUNTER &counter);
+    static void DumpGenCounter(const GENCOUNTER &counter);
+    static void determineKinematics( const std::map<XSECTYPE, std::shared_ptr<SKSNSimCrosssectionModel>> &xsecmodels, TRandom &rng, SKSNSimSNEventVector &ev, const double snDir[]);
     static void determineKinematicsIBD( const SKSNSimXSecIBDSV & xsec, TRandom &rng, SKSNSimSNEventVector &ev, const UtilVector3<double> nuDir);
     static void determineAngleNuebarP( TRandom &rng, const SKSNSimXSecIBDSV & xsec, const double nuEne, double & eEne, double & eTheta, double & ePhi );
     static void determineAngleElastic( TRandom &rng, const SKSNSimXSecNuElastic & xsec, const int nReact, const double nuEne, double & eEne, double & eTheta, double & ePhi, int &iSkip );
@@ -345,7 +425,12 @@ class SKSNSimVectorSNGenerator {
     ~SKSNSimVectorSNGenerator(){ SKSNSimTools::DumpDebugMessage(" dtor of SKSNSimVectorSNGenerator");}
     void AddFluxModel(SKSNSimFluxModel *fm){ fluxmodels.push_back(std::move(std::unique_ptr<SKSNSimFluxModel>(fm))); /* SetMaximumHitProbability(); */ } // after this, the pointer will be managed by SKSNSimVectorGenerator class
     void AddFluxModel(std::unique_ptr<SKSNSimFluxModel> fm){ fluxmodels.push_back(std::move(fm)); /* SetMaximumHitProbability(); */ } // after this, the pointer will be managed by SKSNSimVectorGenerator class
-    std::vector<SKSNSimSNEventVector> GenerateEvents();
+    size_t GenerateEvents(SKSNSimEventSink sink); // events are passed to sink in time order, time-bin by time-bin
+    std::vector<SKSNSimSNEventVector> GenerateEvents() {
+      std::vector<SKSNSimSNEventVector> buf;
+      GenerateEvents([&buf](const SKSNSimSNEventVector &ev){ buf.push_back(ev); });
+      return buf;
+    }
 
     //========================================
     // Configuration
@@ -363,6 +448,10 @@ class SKSNSimVectorSNGenerator {
     double GetTimeMax() const {return m_generator_time_max;}
     size_t GetTimeNBins() const {return m_time_nbins;}
     double GetTimeBinWidth() const { return (GetTimeMax() - GetTimeMin())/(double)GetTimeNBins(); }
+    SKSNSIMENUM::SNTIMEMODE GetTimeMode() const { return m_time_mode; }
+    SKSNSIMENUM::SNTIMEMODE SetTimeMode(const SKSNSIMENUM::SNTIMEMODE m) { m_time_mode = m; return GetTimeMode(); } // kINTEGRATED: event times are uniform in each window
+    const std::vector<double> &SetTimeWindows(const std::vector<double> &w) { m_time_windows = w; return m_time_windows; } // ascending edges in sec, used in kINTEGRATED mode
+    std::vector<double> GetTimeWindows() const { return ( m_time_windows.size() < 2 ? std::vector<double>{ GetTimeMin(), GetTimeMax() } : m_time_windows ); }
     bool   GetFlagFillEvent() const { return m_fill_event; }
     bool   SetFlagFillEvent(const bool f){ m_fill_event = f; return GetFlagFillEvent(); }
     unsigned int GetRandomSeed() const {return m_randomseed; }
@@ -374,6 +463,18 @@ class SKSNSimVectorSNGenerator {
     double GetSNDistanceKpc() const { return m_distance_kpc;}
     double GetSNDistanceRatioTo10kpc() const { return  pow(10.0 / GetSNDistanceKpc(),2.); }
     double SetSNDistanceKpc(const double d) { m_distance_kpc = d; return GetSNDistanceKpc();}
+    double GetElasticEnergyThreshold() const { return m_elastic_ethr; }
+    double SetElasticEnergyThreshold(const double e) { // MeV, electron total energy, applied to total cross section without event generation
+      m_elastic_ethr = e;
+      if( xsecmodels.count(XSECTYPE::mXSECELASTIC) ) dynamic_cast<SKSNSimXSecNuElastic&>(*xsecmodels[XSECTYPE::mXSECELASTIC]).SetElectronEnergyThreshold(e);
+      return GetElasticEnergyThreshold();
+    }
+    const std::set<XSECTYPE> &GetReactions() const { return m_reactions; }
+    const std::set<XSECTYPE> &SetReactions(const std::set<XSECTYPE> &r) { m_reactions = r; return GetReactions(); } // models of unselected reactions are never constructed, and their channels are skipped
+    bool IsReactionEnabled(const XSECTYPE t) const { return m_reactions.count(t) > 0; }
+    void AddXSecVariation(const SKSNSimXSecVariation &v) { m_xsec_variations.push_back(v); } // events get factor of each variation as extra weight, and expected number of events is shown for each variation
+    const std::vector<SKSNSimXSecVariation> &GetXSecVariations() const { return m_xsec_variations; }
+    std::vector<std::string> GetXSecVariationNames() const { return SKSNSimXSecVariation::GetNames(m_xsec_variations); }
     SKSNSIMENUM::NEUTRINOOSCILLATION GetGeneratorNuOscType () const { return m_nuosc_type; }
     SKSNSIMENUM::NEUTRINOOSCILLATION SetGeneratorNuOscType(SKSNSIMENUM::NEUTRINOOSCILLATION t) { m_nuosc_type = t; return GetGeneratorNuOscType(); }
     SKSNSIMENUM::NEUTRINOOSCILLATION SetGeneratorNuOscType(int t) { m_nuosc_type = (SKSNSIMENUM::NEUTRINOOSCILLATION)t; return GetGeneratorNuOscType(); }
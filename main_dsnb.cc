@@ -8,6 +8,7 @@
 #include <memory>
 #include <sstream>
 #include <iomanip>
+#include <vector>
 #include "SKSNSimVectorGenerator.hh"
 #include "SKSNSimFileIO.hh"
 #include "SKSNSimFlux.hh"
@@ -33,6 +34,13 @@ int main(int argc, char **argv){
   if( ! config->GetDSNBFlatFlux() ) {
     auto flux = std::make_unique<SKSNSimDSNBFluxCustom>( config->GetDSNBFluxModel() );
     vectgen->AddFluxModel((SKSNSimFluxModel*)flux.release());
+
+    /* Additional flux components (e.g. backgrounds) sampled together as a mixture */
+    const auto &addflux = config->GetDSNBAdditionalFluxModels();
+    for(auto it = addflux.begin(); it != addflux.end(); it++){
+      auto fluxadd = std::make_unique<SKSNSimDSNBFluxCustom>( it->first );
+      vectgen->AddFluxModel((SKSNSimFluxModel*)fluxadd.release(), it->second);
+    }
   }
   auto xsec = std::make_unique<SKSNSimXSecIBDRVV>();
   vectgen->AddXSecModel((SKSNSimCrosssectionModel*)xsec.release());
@@ -41,12 +49,10 @@ int main(int argc, char **argv){
   int num_random_throw = 0;
   int num_total_event = 0;
   double max_weight = 0;
-  auto calcToralRandomThrow = [](const std::vector<SKSNSimSNEventVector> &v){
-    int n = 0;
-    for(auto it = v.begin(); it != v.end(); it++) n += it->GetNRandomThrow();
-    return n;
-  };
-
+  /* Same as above for each flux component, as the hit-and-miss is done with the max-probability of the sampled component */
+  std::vector<int> comp_random_throw(vectgen->GetNFluxComponents(), 0);
+  std::vector<int> comp_total_event(vectgen->GetNFluxComponents(), 0);
+  std::vector<double> comp_max_weight(vectgen->GetNFluxComponents(), 0.);
 
   /* Generate number of events and output file-name etc. */
   auto flist = GenerateOutputFileList(*config);
@@ -55,32 +61,63 @@ int main(int argc, char **argv){
     /* Open file IO and then generate events from file configuration */
     std::unique_ptr<SKSNSimFileOutput> vectio;
     if( config->GetOFileMode() == SKSNSimUserConfiguration::MODEOFILE::kNUANCE ) vectio.reset(new SKSNSimFileOutNuance(it->GetFileName()));
-    else if( config->GetOFileMode() == SKSNSimUserConfiguration::MODEOFILE::kSKROOT ) vectio.reset(new SKSNSimFileOutTFile(it->GetFileName()));
+    else if( config->GetOFileMode() == SKSNSimUserConfiguration::MODEOFILE::kSKROOT ) {
+      auto vectio_tmp = new SKSNSimFileOutTFile();
+      vectio_tmp->SetXSecWeightNames(vectgen->GetXSecVariationNames());
+      vectio_tmp->Open(it->GetFileName());
+      vectio.reset( vectio_tmp );
+    }
     else { 
       std::cout << "ERR: strange output format " << std::endl;
       exit(EXIT_FAILURE);
     }
     vectgen->SetRUNNUM( it->GetRun() );
     vectgen->SetSubRUNNUM( it->GetSubrun() );
-    auto evt_buffer = vectgen->GenerateEvents(it->GetNumEvents());
 
-    /*  Calculate event weight in order to define integration of dN/dE spectrum */
-    num_random_throw += calcToralRandomThrow(evt_buffer);
-    num_total_event += evt_buffer.size();
-    if( evt_buffer.size() > 0 && max_weight < evt_buffer.at(0).GetWeightMaxProb() ) max_weight = evt_buffer.at(0).GetWeightMaxProb();
+    if( config->GetDSNBFlatFlux() ){
+      /* Flat positron mode: generated in batch, and written every chunk */
+      num_total_event += vectgen->GenerateEventsIBDFlat(it->GetNumEvents(),
+          [&vectio](const std::vector<SKSNSimSNEventVector> &v){ vectio->Write(v); });
+      vectio->Close();
+      continue;
+    }
+
+    /* Output generated vectors one-by-one, and calculate event weight in order to define integration of dN/dE spectrum */
+    num_total_event += vectgen->GenerateEvents(it->GetNumEvents(),
+        [&](const SKSNSimSNEventVector &ev){
+          num_random_throw += ev.GetNRandomThrow();
+          if( max_weight < ev.GetWeightMaxProb() ) max_weight = ev.GetWeightMaxProb();
+          const int ic = ev.GetFluxComponent();
+          comp_random_throw[ic] += ev.GetNRandomThrow();
+          comp_total_event[ic]++;
+          if( comp_max_weight[ic] < ev.GetWeightMaxProb() ) comp_max_weight[ic] = ev.GetWeightMaxProb();
+          vectio->Write(ev);
+        });
 
-    /* Output generated vectors and close file IO */
-    vectio->Write(evt_buffer);
+    /* Close file IO */
     vectio->Close();
   }
 
   /* Calculation of integrateion of dN/dE spectrum */
   if( num_random_throw > 0 ){
+  /* each component gives (max-probability) x (events) / (throws), summed with its normalization */
+  double integral_hitmiss = 0.;
+  for(size_t i = 0; i < comp_random_throw.size(); i++)
+    if( comp_random_throw[i] > 0 ) integral_hitmiss += vectgen->GetFluxComponentNorm(i) * comp_max_weight[i] * (double) comp_total_event[i] / (double)comp_random_throw[i];
   std::cout << "=============================" << std::endl
     <<  "Finished event generation: integration results: " << std::endl
     << "(Total Events) / (Total Random Throw)  = " << num_total_event << " / " << num_random_throw << " = " << (double)num_total_event/(double)num_random_throw << std::endl
-    << "Weight of max-probability in hit-and-miss method = " << max_weight << std::endl
-    << "(Integration of dN/dE spectrum (flux x xsec)) / ( total number of free-proton ) = " << max_weight * (double) num_total_event / (double)num_random_throw << std::endl
+    << "Weight of max-probability in hit-and-miss method = " << max_weight << std::endl;
+  if( comp_random_throw.size() > 1 ){
+    for(size_t i = 0; i < comp_random_throw.size(); i++)
+      std::cout << "  component " << i << " (norm " << vectgen->GetFluxComponentNorm(i) << "): (Events) / (Random Throw) = " << comp_total_event[i] << " / " << comp_random_throw[i] << ", weight of max-probability = " << comp_max_weight[i] << std::endl;
+  }
+  std::cout
+    << "(Integration of dN/dE spectrum (flux x xsec)) / ( total number of free-proton ) = " << integral_hitmiss << std::endl
+    << "Integration of (flux x xsec) by quadrature (last run) = " << vectgen->GetFluxIntegral() << " +- " << vectgen->GetFluxIntegralError() << std::endl;
+  for(size_t i = 0; i < vectgen->GetXSecVariations().size(); i++)
+    std::cout << "  with cross-section variation " << vectgen->GetXSecVariations()[i].GetName() << " (weight_" << vectgen->GetXSecVariations()[i].GetName() << ") = " << vectgen->GetXSecVariationIntegral(i) << std::endl;
+  std::cout
     << "============================="   << std::endl;
   } else {
     std::cout <<  "Finished event generation: total number of random throw is zero or negative ( " << num_random_throw << " )" << std::endl
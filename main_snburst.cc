@@ -48,19 +48,37 @@ int main( int argc, char ** argv )
   config->Dump();
 
 
-  std::unique_ptr<SKSNSimSNFluxNakazatoFormat> flux (new SKSNSimSNFluxNakazatoFormat());
-  flux->SetModel(config->GetSNBurstFluxModel());
-  
+  std::unique_ptr<SKSNSimFluxModel> flux;
+  if( config->GetSNBurstParametricFlux() ){
+    auto fluxparam = std::make_unique<SKSNSimSNFluxParametric>();
+    config->Apply(*fluxparam);
+    fluxparam->DumpParameters();
+    flux = std::move(fluxparam);
+  }
+  else if( config->GetSNBurstStreamWindow() > 0 ){
+    const char * env_p = std::getenv(DATADIRVARIABLENAME);
+    if( env_p == nullptr ){
+      std::cout << "The environmental variable \"" << DATADIRVARIABLENAME << "\" is not defined. Please set it..." << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    flux = std::make_unique<SKSNSimSNFluxStream>( std::string(env_p) + "/snburst/" + config->GetSNBurstFluxModel(), config->GetSNBurstStreamWindow() );
+  }
+  else {
+    auto fluxmodel = std::make_unique<SKSNSimSNFluxNakazatoFormat>();
+    fluxmodel->SetModel(config->GetSNBurstFluxModel());
+    flux = std::move(fluxmodel);
+  }
+
 
 	/*-----Geneartion-----*/
   std::unique_ptr<SKSNSimVectorSNGenerator> generator = std::make_unique<SKSNSimVectorSNGenerator>();
   generator->AddFluxModel(std::move(flux));
   config->Apply(*generator);
   generator->SetRandomGenerator(config->GetRandomGenerator());
-  auto buffer = generator->GenerateEvents();
-  SKSNSimTools::DumpDebugMessage(Form("Successed GenerateEvents -> %d events", (int)buffer.size()));
 
+  /* Open all of output files in advance, then generated events are written as soon as they are generated */
   auto flist = GenerateOutputFileList(*config);
+  std::vector<std::unique_ptr<SKSNSimFileOutput>> vectios;
   for(auto it = flist.begin(); it != flist.end(); it++){
     std::unique_ptr<SKSNSimFileOutput> vectio;
     if( config->GetOFileMode() == SKSNSimUserConfiguration::MODEOFILE::kNUANCE ) {
@@ -68,12 +86,19 @@ int main( int argc, char ** argv )
       vectio->Open(it->GetFileName());
     } else if( config->GetOFileMode() == SKSNSimUserConfiguration::MODEOFILE::kSKROOT ) {
       auto vectio_tmp = new SKSNSimFileOutTFile();
+      vectio_tmp->SetXSecWeightNames(generator->GetXSecVariationNames());
       vectio_tmp->Open(it->GetFileName(), true);
       vectio.reset( vectio_tmp );
     }
-    vectio->Write(buffer);
-    vectio->Close();
+    vectios.push_back(std::move(vectio));
   }
 
+  const size_t nevents = generator->GenerateEvents([&vectios](const SKSNSimSNEventVector &ev){
+      for(auto it = vectios.begin(); it != vectios.end(); it++) (*it)->Write(ev);
+      });
+  SKSNSimTools::DumpDebugMessage(Form("Successed GenerateEvents -> %d events", (int)nevents));
+
+  for(auto it = vectios.begin(); it != vectios.end(); it++) (*it)->Close();
+
   return EXIT_SUCCESS;
 }
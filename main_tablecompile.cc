@@ -0,0 +1,70 @@
+/******************************
+ * File: main_tablecompile.cc
+ * Description:
+ * compile cross-section tables in table/ (text and ROOT files) and the total cross sections of IBD models into one binary file,
+ * which is memory-mapped by main_snburst and main_dsnb instead of parsing the original tables.
+ * With --source, C++ source of the same tables is written instead, which is compiled into lib/libSKSNSim.so by GNUmakefile.
+ * Run again whenever the original tables are updated.
+ *******************************/
+
+#include <string>
+#include <iostream>
+#include <cstdlib>
+#include <dirent.h>
+#include "SKSNSimCrosssection.hh"
+#include "SKSNSimTableFile.hh"
+
+
+int main(int argc, char **argv){
+
+  bool source = false;
+  std::string ofname;
+  for(int i = 1; i < argc; i++){
+    const std::string arg(argv[i]);
+    if( arg == "--source" ){
+      source = true;
+      continue;
+    }
+    if( arg == "-h" || arg == "--help" || !ofname.empty() ){
+      std::cout << "Usage: " << argv[0] << " [output file (default: " << SKSNSimTableFile::GetDefaultFileName() << ")]" << std::endl
+                << "       " << argv[0] << " --source [output C++ source file (default: SKSNSimBakedTables.cc)]" << std::endl;
+      return EXIT_FAILURE;
+    }
+    ofname = arg;
+  }
+  if( ofname.empty() ) ofname = ( source ? std::string("SKSNSimBakedTables.cc") : SKSNSimTableFile::GetDefaultFileName() );
+  if( ofname.empty() ){
+    std::cerr << "The environmental variable \"" << INSTALLDIRVARIABLENAME << "\" is not defined. Please set it..." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /* Always load the original tables, even if the precompiled file or the baked tables exist */
+  SKSNSimTableFile::SetEnabled(false);
+
+  SKSNSimTableFileWriter writer;
+  SKSNSimXSecNuElastic().ExportTable(writer);
+  SKSNSimXSecNuOxygen().ExportTable(writer);
+  SKSNSimXSecNuOxygenNC().ExportTable(writer);
+  SKSNSimXSecNuOxygenSub().ExportTable(writer);
+  SKSNSimXSecIBDVB().ExportTable(writer);
+  SKSNSimXSecIBDSV().ExportTable(writer);
+  SKSNSimXSecIBDRVV().ExportTable(writer);
+
+  /* Size and modification time of the original tables, to warn at startup when they are updated without compiling again */
+  if( const char *env_p = std::getenv(INSTALLDIRVARIABLENAME) ){
+    const std::string dir = std::string(env_p) + "/table/";
+    if( DIR *d = opendir(dir.c_str()) ){
+      while( const dirent *ent = readdir(d) ){
+        const std::string name(ent->d_name);
+        auto endsWith = [&name](const std::string &x){ return name.size() > x.size() && name.compare(name.size() - x.size(), x.size(), x) == 0; };
+        if( endsWith(".dat") || endsWith(".root") ) writer.AddSource(dir + name);
+      }
+      closedir(d);
+    }
+  }
+
+  if( !( source ? writer.WriteSource(ofname) : writer.Write(ofname) ) ) return EXIT_FAILURE;
+  std::cout << "Wrote " << writer.GetNEntries() << " tables into " << ofname << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -24,6 +24,7 @@ FluxCalculation::FluxCalculation()
       ene_flux_v = new std::vector<std::pair<double,double> >();
       lower_energy_bin_width = 0.1;
       upper_energy_bin_width = 0.1;
+      buildIndex();
       return;
 }
 
@@ -52,6 +53,7 @@ void FluxCalculation::loadFile(const std::string fname)
   }
   datafile.close();
   sortByEnergy();
+  buildIndex();
   return;
 }
 
@@ -73,35 +75,38 @@ void FluxCalculation::sortByEnergy()
   return;
 }
 
+void FluxCalculation::buildIndex()
+{
+  // Assumed the data field ene_flux_v is sorted as lowest energy on first
+  const size_t n = getNBins();
+  binEne.resize(n);
+  binSlope.assign(n, 0.);
+  for(size_t b = 0; b < n; b++) binEne[b] = (*ene_flux_v)[b].first;
+  for(size_t b = 0; b + 1 < n; b++){
+    const std::pair<double,double> &bin = (*ene_flux_v)[b], &nextbin = (*ene_flux_v)[b + 1];
+    if( nextbin.first > bin.first ) binSlope[b] = (nextbin.second - bin.second) / (nextbin.first - bin.first);
+  }
+  eneIndex.Set(binEne.data(), n);
+}
+
 double FluxCalculation::getFlux(const double nu_ene_MeV) const 
 {
-  // Assumed the data field ene_flux_v is sorted as lowest energy on first 
   // Calculate flux with linear interpolation
   const static double ERROR_CODE = -9999.;
   const static double OUTOFRANGE = -9998.;
   if(ene_flux_v == NULL) return ERROR_CODE;
-  std::pair<double,double> bin = std::make_pair(-1, 0);
-  std::pair<double,double> nextbin;
-  for(std::vector<std::pair<double,double> >::iterator it = ene_flux_v->begin(); it+1 != ene_flux_v->end(); it++){
-    // IMPROVEMENT: if you implement this with binary tree search, it will be faster
-    if(it->first <= nu_ene_MeV && nu_ene_MeV < (it+1)->first){
-      bin = *it;
-      nextbin = *(it+1);
-      break;
-    }
-  }
-  if(bin.first == -1) {
+  const int b = eneIndex.FindBin(nu_ene_MeV);
+  if(b < 0) {
 #ifdef RETURNEXCEPATIONS
     throw  std::out_of_range("energy is out of range");
 #endif
     return OUTOFRANGE;
   }
 
-  double nuFlux = (nextbin.second - bin.second) * (nu_ene_MeV - bin.first) / (nextbin.first - bin.first) + bin.second;
+  double nuFlux = binSlope[b] * (nu_ene_MeV - binEne[b]) + (*ene_flux_v)[b].second;
 #ifdef DEBUG
-  std::cout << "FluxCalculation: nuEne = " << nu_ene_MeV <<", flux = " << nuFlux << ", bin = (" << bin.first << ", " << bin.second << ")" << std::endl;
+  std::cout << "FluxCalculation: nuEne = " << nu_ene_MeV <<", flux = " << nuFlux << ", bin = (" << binEne[b] << ", " << (*ene_flux_v)[b].second << ")" << std::endl;
 #endif
 
   return nuFlux;
 }
-
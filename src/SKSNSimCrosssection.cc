@@ -8,9 +8,13 @@
 #include <limits>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
 #include <pdg_codes.h>
 #include "SKSNSimCrosssection.hh"
 #include "SKSNSimConstant.hh"
+#include "SKSNSimIntegration.hh"
 
 using namespace SKSNSimPhysConst;
 
@@ -30,6 +34,190 @@ namespace SKSNSimCrosssection {
   }
 }
 
+void SKSNSimXSecTable::Build(const std::function<double(double)> &exact){
+  auto toEnergy = [this](const double x){ return m_ethr + exp(x); };
+  size_t n = NINTERVALINIT;
+  m_xmin = log(OFFSETMIN);
+  m_dx = ( log(m_emax - m_ethr) - m_xmin ) / double(n);
+  m_xsec.resize(n + 1);
+  for(size_t i = 0; i <= n; i++) m_xsec[i] = exact( toEnergy( m_xmin + m_dx * double(i) ) );
+
+  // self-test at the midpoints, and the midpoints become nodes of the refined grid if needed
+  std::vector<double> mid;
+  while( true ){
+    calcSlope();
+    mid.resize(n);
+    m_max_error = 0.;
+    for(size_t i = 0; i < n; i++){
+      const double x = m_xmin + m_dx * ( double(i) + 0.5 );
+      mid[i] = exact( toEnergy(x) );
+      const double scale = std::max( fabs(mid[i]), std::max( fabs(m_xsec[i]), fabs(m_xsec[i + 1]) ) ); // local scale, in case of sign change
+      if( scale <= 0. ) continue;
+      const double err = fabs( interpolate(x) - mid[i] ) / scale;
+      if( err > m_max_error ) m_max_error = err;
+    }
+    if( m_max_error <= m_error_target || n >= NINTERVALMAX ) break;
+
+    std::vector<double> refined(2 * n + 1);
+    for(size_t i = 0; i < n; i++){
+      refined[2 * i] = m_xsec[i];
+      refined[2 * i + 1] = mid[i];
+    }
+    refined[2 * n] = m_xsec[n];
+    m_xsec.swap(refined);
+    n *= 2;
+    m_dx *= 0.5;
+  }
+  m_built = true;
+
+  std::cout << "[SKSNSimXSecTable] built with " << m_xsec.size() << " nodes in ( " << m_ethr + OFFSETMIN << ", " << m_emax << " ) MeV: max relative error " << m_max_error << " (target " << m_error_target << ")" << std::endl;
+  if( m_max_error > m_error_target ) std::cerr << "[SKSNSimXSecTable] WARNING: error target is not achieved with maximum number of nodes" << std::endl;
+}
+
+bool SKSNSimXSecTable::load(const std::function<double(double)> &exact){
+  const SKSNSimTableFile &tablefile = SKSNSimTableFile::GetInstance();
+  SKSNSimTableView def, xsec, slope;
+  if( m_name.empty()
+      || !tablefile.Get(m_name + "/definition", def) || def.size() != 6
+      || std::vector<double>(def.data(), def.data() + 3) != getDefinition()
+      || !tablefile.Get(m_name + "/xsec", xsec) || !tablefile.Get(m_name + "/slope", slope)
+      || xsec.size() < 2 || slope.size() != xsec.size() ) return false;
+
+  const double xmin = m_xmin, dx = m_dx;
+  m_xmin = def[3];
+  m_dx = def[4];
+  m_xsec = xsec.ToVector();
+  m_slope = slope.ToVector();
+
+  // spot check at the midpoints spread over the table
+  const size_t n = m_xsec.size() - 1;
+  for(size_t k = 0; k < NVALIDATION; k++){
+    const size_t i = n * ( 2 * k + 1 ) / ( 2 * NVALIDATION );
+    const double x = m_xmin + m_dx * ( double(i) + 0.5 );
+    const double mid = exact( m_ethr + exp(x) );
+    const double scale = std::max( fabs(mid), std::max( fabs(m_xsec[i]), fabs(m_xsec[i + 1]) ) );
+    if( scale > 0. && fabs( interpolate(x) - mid ) / scale > std::max( m_error_target, def[5] ) ){
+      std::cout << "[SKSNSimXSecTable] stored table " << m_name << " does not agree with the calculation, rebuilt" << std::endl;
+      m_xmin = xmin;
+      m_dx = dx;
+      m_xsec.clear();
+      m_slope.clear();
+      return false;
+    }
+  }
+  m_max_error = def[5];
+  m_built = true;
+  return true;
+}
+
+void SKSNSimXSecTable::Export(SKSNSimTableFileWriter &writer, const std::function<double(double)> &exact){
+  if( m_error_target <= 0. ) return;
+  if( !m_built ) Build(exact);
+  std::vector<double> def = getDefinition();
+  def.insert(def.end(), { m_xmin, m_dx, m_max_error });
+  writer.Add(m_name + "/definition", def);
+  writer.Add(m_name + "/xsec", m_xsec);
+  writer.Add(m_name + "/slope", m_slope);
+}
+
+void SKSNSimXSecTable::calcSlope(){
+  // Fritsch-Carlson: secant average, limited to keep monotonicity in each interval
+  const size_t n = m_xsec.size() - 1;
+  std::vector<double> d(n);
+  for(size_t i = 0; i < n; i++) d[i] = ( m_xsec[i + 1] - m_xsec[i] ) / m_dx;
+  m_slope.resize(n + 1);
+  m_slope[0] = d[0];
+  m_slope[n] = d[n - 1];
+  for(size_t i = 1; i < n; i++) m_slope[i] = ( d[i - 1] * d[i] <= 0. ? 0. : 0.5 * ( d[i - 1] + d[i] ) );
+  for(size_t i = 0; i < n; i++){
+    if( d[i] == 0. ){
+      m_slope[i] = m_slope[i + 1] = 0.;
+      continue;
+    }
+    const double a = m_slope[i] / d[i];
+    const double b = m_slope[i + 1] / d[i];
+    const double r2 = a * a + b * b;
+    if( r2 > 9. ){
+      const double tau = 3. / sqrt(r2);
+      m_slope[i] = tau * a * d[i];
+      m_slope[i + 1] = tau * b * d[i];
+    }
+  }
+}
+
+double SKSNSimXSecTable::interpolate(const double x) const {
+  const double u = ( x - m_xmin ) / m_dx;
+  const size_t n = m_xsec.size() - 1;
+  size_t i = ( u > 0. ? size_t(u) : 0 );
+  if( i >= n ) i = n - 1;
+  const double t = u - double(i);
+  const double t2 = t * t;
+  const double t3 = t2 * t;
+  return ( 2. * t3 - 3. * t2 + 1. ) * m_xsec[i] + ( t3 - 2. * t2 + t ) * m_dx * m_slope[i]
+    + ( -2. * t3 + 3. * t2 ) * m_xsec[i + 1] + ( t3 - t2 ) * m_dx * m_slope[i + 1];
+}
+
+double SKSNSimXSecTable::Eval(const double e) const {
+  return interpolate( log(e - m_ethr) );
+}
+
+
+double SKSNSimIBDAngularIntegrator::GetCosThetaMin(const double enu){
+  // Positron energy (eq.21 of Strumia-Vissani) is real if (enu - delta)^2 >= Me^2 * ( (1+epsilon)^2 - (epsilon*costheta)^2 )
+  constexpr double delta = (Mn*Mn - Mp*Mp - Me*Me)*0.5/Mp;
+  if( enu <= nuEneThr ) return 2.0;
+  const double epsilon = enu / Mp;
+  const double c2 = ( Me*Me*(1.0 + epsilon)*(1.0 + epsilon) - (enu - delta)*(enu - delta) ) / ( Me*Me*epsilon*epsilon );
+  if( c2 <= 0. ) return -1.0;
+  return ( c2 >= 1.0 ? 2.0 : sqrt(c2) );
+}
+
+double SKSNSimIBDAngularIntegrator::Integrate(const SKSNSimCrosssectionModel &model, const double ethr, const double enu) const {
+  double xsec = 0.;
+  IntegrateBatch(model, ethr, 1, &enu, &xsec);
+  return xsec;
+}
+
+void SKSNSimIBDAngularIntegrator::IntegrateBatch(const SKSNSimCrosssectionModel &model, const double ethr, const size_t n, const double *enu, double *xsec) const {
+  const auto &gl = SKSNSimIntegration::GetGaussLegendre(m_order);
+  std::vector<size_t> index;
+  std::vector<double> halfwidth, e, costheta, dxsec, escat;
+  for(size_t top = 0; top < n; top += NENERGYCHUNK){
+    // nodes of all energies above the threshold in this chunk
+    index.clear();
+    halfwidth.clear();
+    e.clear();
+    costheta.clear();
+    for(size_t i = top; i < std::min(n, top + NENERGYCHUNK); i++){
+      xsec[i] = 0.;
+      const double cmin = GetCosThetaMin(enu[i]);
+      if( !( enu[i] > ethr && cmin < 1.0 ) ) continue;
+      const double mid = ( 1.0 + cmin ) * 0.5;
+      const double hw = ( 1.0 - cmin ) * 0.5;
+      for(size_t k = 0; k < m_order; k++){
+        e.push_back(enu[i]);
+        costheta.push_back(mid + hw * gl.x[k]);
+      }
+      index.push_back(i);
+      halfwidth.push_back(hw);
+    }
+    if( index.empty() ) continue;
+    dxsec.resize(e.size());
+    escat.resize(e.size());
+    model.GetDiffCrosssectionBatch(e.size(), e.data(), costheta.data(), dxsec.data(), escat.data());
+
+    for(size_t j = 0; j < index.size(); j++){
+      double sum = 0.;
+      for(size_t k = 0; k < m_order; k++) sum += gl.w[k] * dxsec[j * m_order + k];
+      xsec[index[j]] = sum * halfwidth[j];
+    }
+  }
+}
+
+SKSNSimXSecIBDSV::SKSNSimXSecIBDSV():
+  table("ibdsv", nuEneThr) // kinematic threshold, below which the differential cross section is not defined
+{}
+
 std::pair<double,double> SKSNSimXSecIBDSV::GetDiffCrosssection(double enu /* MeV */ , double costheta) const {
   /*********************************************************************/
   /// Copied from VectGenNuCrosssection::DcsNuebP_SV
@@ -127,37 +315,9 @@ std::pair<double,double> SKSNSimXSecIBDSV::GetDiffCrosssection(double enu /* MeV
   return std::make_pair(dcs, Epo);
 }
 
-double SKSNSimXSecIBDSV::GetCrosssection(double enu) const
-{
-  /*
-     Total cross section of nu_e_bar + p --> e^+  + n  interaction
-     using the precise calculation by Strumia and Vissani
-     enu : Neutrino energy in MeV
-     (Epo : Positoron total energy in MeV, should be later)
-     return : Total cross section (cm^2)
-  */
-
-  double totcsnuebp_SV = 0;
-  const double Ee = enu - DeltaM;
-  if(Ee <= Me) return 0.0;
-
-  constexpr double COSTHETARANGELOW  = -1.;
-  constexpr double COSTHETARANGEHIGH =  1.;
-  constexpr int    NBIN = 200;
-  constexpr double BINWIDTH = (COSTHETARANGEHIGH - COSTHETARANGELOW)/double(NBIN);
-  constexpr double HALFBINWIDTH = BINWIDTH / 2.0;
-  constexpr double COSTHETARANGELOWINCLBIAS = COSTHETARANGELOW + HALFBINWIDTH;
-  for(int b=0; b<NBIN; b++){
-    double costheta = COSTHETARANGELOWINCLBIAS + BINWIDTH * double(b);
-    double dcs0, Epo0;
-    auto result = GetDiffCrosssection(enu, costheta);
-    totcsnuebp_SV += result.first;
-  }
-  totcsnuebp_SV *= BINWIDTH;
-
-  //cout << totcsnuebp_SV << endl;
-  return totcsnuebp_SV;
-}
+SKSNSimXSecIBDVB::SKSNSimXSecIBDVB():
+  table("ibdvb", nuEneThr, 300.) // Ee >= 3 MeV, and step-like structure by the positron energy cut above ~470 MeV is out of the table
+{}
 
 std::pair<double,double> SKSNSimXSecIBDVB::GetDiffCrosssection(double enu, double costheta)
  const {
@@ -210,40 +370,37 @@ std::pair<double,double> SKSNSimXSecIBDVB::GetDiffCrosssection(double enu, doubl
   return std::make_pair(dcs, Epo);
 }
 
-double SKSNSimXSecIBDVB::GetCrosssection(double enu) const
-{
-  /*
-    Total cross section of nu_e_bar + p --> e^+  + n  interaction
-    using the precise calculation by Vogel and Beacom
-        enu : Neutrino energy in MeV
-	(Epo : Positoron total energy in MeV, should be later)
-     return : Total cross section (cm^2)
-  */
 
-  double totcsnuebp_vb = 0;
-  const double Ee = enu - DeltaM;
-  if(Ee < 3.0 /* MeV */) return 0.0;
-
-  constexpr double COSTHETARANGELOW  = -1.;
-  constexpr double COSTHETARANGEHIGH =  1.;
-  constexpr int    NBIN = 200;
-  constexpr double BINWIDTH = (COSTHETARANGEHIGH - COSTHETARANGELOW)/double(NBIN);
-  constexpr double HALFBINWIDTH = BINWIDTH / 2.0;
-  constexpr double COSTHETARANGELOWINCLBIAS = COSTHETARANGELOW + HALFBINWIDTH;
-  for(int b=0; b<NBIN; b++){
-    double costheta = COSTHETARANGELOWINCLBIAS + BINWIDTH * double(b);
-    double dcs0, Epo0;
-    auto result = GetDiffCrosssection(enu, costheta);
-    totcsnuebp_vb += result.first;
-  }
-  totcsnuebp_vb *= BINWIDTH;
+SKSNSimXSecIBDRVV::SKSNSimXSecIBDRVV():
+  table("ibdrvv", nuEneThr)
+{}
 
-  //cout << totcsnuebp_SV << endl;
-  return totcsnuebp_vb;
+std::pair<double,double> SKSNSimXSecIBDRVV::GetDiffCrosssection(double Enu, double costheta) const {
+  if( Enu <= nuEneThr ){
+#ifdef DEBUG
+    std::cerr << "[SKSNSimXSecIBDRVV] Enu is smaller than threshold ( Enu = " << Enu << " <= " << nuEneThr << std::endl;
+#endif
+    return std::make_pair(0, 0);
+  }
+  double Ee;
+  const double dxsec = calcDiffCrosssection(Enu, costheta, Ee);
+  return std::make_pair(dxsec, Ee);
 }
 
+void SKSNSimXSecIBDRVV::GetDiffCrosssectionBatch(const size_t n, const double *Enu, const double *costheta, double *dxsec, double *Ee) const {
+  // Energies below threshold are calculated at dummy energy and masked,
+  // so that the loop has no branch and can be vectorized by compiler.
+  constexpr double dummyEne = nuEneThr + 1.0;
+  for(size_t i = 0; i < n; i++){
+    const bool above = ( Enu[i] > nuEneThr );
+    double ee;
+    const double x = calcDiffCrosssection( above ? Enu[i] : dummyEne, costheta[i], ee);
+    dxsec[i] = above ? x : 0.;
+    Ee[i] = above ? ee : 0.;
+  }
+}
 
-std::pair<double,double> SKSNSimXSecIBDRVV::GetDiffCrosssection(double Enu, double costheta) const {
+inline double SKSNSimXSecIBDRVV::calcDiffCrosssection(const double Enu, const double costheta, double &Ee_out) {
   /*
    * Differential cross section
    * Detail of reference are in header file
@@ -293,17 +450,11 @@ std::pair<double,double> SKSNSimXSecIBDRVV::GetDiffCrosssection(double Enu, doub
   constexpr double InvM  = 1.0 / M; // To avoid division
   constexpr double InvM2 = 1.0 / M2; // To avoid division
   constexpr double delta =  (Mn2 - Mp2 - Me2)*0.5/Mp; // from eq12 of ref2
-  constexpr double Ethr = ((Mn + Me)*(Mn + Me) - Mp2)*0.5/Mp;
   constexpr double MA2   = 12.0 / axial_raddius2;
   constexpr double diff_mag_moment = mag_moment_p - mag_moment_n;
   constexpr double InvMA2= 1.0 / MA2;
 
 
-  if( Enu <= Ethr ){
-    std::cerr << "[SKSNSimXSecIBDRVV] Enu is smaller than threshold ( Enu = " << Enu << " <= " << Ethr << std::endl;
-    return std::make_pair(0, 0);
-  }
-
   // Calculation of Ee from Enu and costheta (eq 21 of ref2)
   const double epsilon = Enu * InvMp;
   const double kappa = ( 1.0 + epsilon) * (1.0 + epsilon) - epsilon * epsilon * costheta * costheta;
@@ -439,10 +590,11 @@ std::pair<double,double> SKSNSimXSecIBDRVV::GetDiffCrosssection(double Enu, doub
   const double dsigma_per_dt = Gf2 * cos2ThetaC * matrix_element2 / ( 64.0 * M_PI * s_minus_Mp2 * s_minus_Mp2 );
 
 #ifdef DEBUG
-  std::cout << "[SKSNSimXSecIBDRVV] dsigma_per_dt " << Enu << " " << dsigma_per_dt << " "  << matrix_element2 << " " << Anu << " " << Bnu << " " << s_minus_u * Bnu << " " << Cnu << " " << s_minus_Mp2 * Cnu << Ethr << std::endl;
+  std::cout << "[SKSNSimXSecIBDRVV] dsigma_per_dt " << Enu << " " << dsigma_per_dt << " "  << matrix_element2 << " " << Anu << " " << Bnu << " " << s_minus_u * Bnu << " " << Cnu << " " << s_minus_Mp2 * Cnu << " " << nuEneThr << std::endl;
 #endif
 
-  const double radiative_correction = ALPHA / M_PI * ( 6.0 + 1.5 * log(Mp * 0.5 / Ee) + 1.2 * pow(Me / Ee, 1.5)); // p6
+  const double Me_over_Ee = Me / Ee;
+  const double radiative_correction = ALPHA / M_PI * ( 6.0 + 1.5 * log(Mp * 0.5 / Ee) + 1.2 * Me_over_Ee * sqrt(Me_over_Ee)); // p6, (Me/Ee)^1.5 without pow() for vectorization
 
   // Not used for free proton
   auto sommerfeld_factor_func = [] ( double Ee ) {
@@ -455,41 +607,50 @@ std::pair<double,double> SKSNSimXSecIBDRVV::GetDiffCrosssection(double Enu, doub
   const double dEe_per_dcostheta /* MeV */ = Pe * epsilon / ( 1.0 + epsilon * ( 1.0 - Ee * costheta / Pe) );
   const double dsigma_per_dconstheta /* cm^2 */ = dsigma_per_dt * dt_per_dEe * dEe_per_dcostheta * HBARC2 * ( 1.0 + radiative_correction);
 
-  return std::make_pair(dsigma_per_dconstheta,Ee);
+  Ee_out = Ee;
+  return dsigma_per_dconstheta;
 }
 
-double SKSNSimXSecIBDRVV::GetCrosssection(double Enu /* MeV */) const {
-  double totcsnuebp_RVV = 0;
-
-  constexpr double COSTHETARANGELOW  = -1.;
-  constexpr double COSTHETARANGEHIGH =  1.;
-  constexpr size_t NBIN = 200;
-  constexpr double BINWIDTH = (COSTHETARANGEHIGH - COSTHETARANGELOW)/double(NBIN);
-  constexpr double HALFBINWIDTH = BINWIDTH / 2.0;
-  constexpr double COSTHETARANGELOWINCLBIAS = COSTHETARANGELOW + HALFBINWIDTH;
-  for(size_t b=0; b<NBIN; b++){
-    double costheta = COSTHETARANGELOWINCLBIAS + BINWIDTH * double(b);
-    auto result = GetDiffCrosssection(Enu, costheta).first;
-    totcsnuebp_RVV += result;
-  }
-  totcsnuebp_RVV *= BINWIDTH;
-
-#ifdef DEBUG
-  std::cout << totcsnuebp_RVV << std::endl;
-#endif
-  return totcsnuebp_RVV;
+double SKSNSimXSecIBDRVV::GetCrosssectionError(double Enu /* MeV */) {
+  return GetCrosssectionError(Enu, kNERRORSOURCE);
 }
 
-double SKSNSimXSecIBDRVV::GetCrosssectionError(double Enu /* MeV */) const {
+double SKSNSimXSecIBDRVV::GetCrosssectionError(double Enu /* MeV */, ERRORSOURCE src) {
   /* Simple approximation of uncertainty in ref[1]. See detail in header file. */
   constexpr double delta_vud_lambda = 9.4e-4;
   double delta_axial_radii = [](double Enu){
     return 2.0e-6 * pow( Enu , 2.0 );
   } ( Enu );
 
+  if( src == kERRVUDLAMBDA ) return delta_vud_lambda;
+  if( src == kERRAXIALRADII ) return delta_axial_radii;
   return sqrt(delta_vud_lambda * delta_vud_lambda + delta_axial_radii * delta_axial_radii );
 }
 
+SKSNSimXSecVariation SKSNSimXSecVariation::MakeScale(const std::string &name, const XSECTYPE type, const double f){
+  return SKSNSimXSecVariation(name, type, [f](double){ return f; });
+}
+
+SKSNSimXSecVariation SKSNSimXSecVariation::MakeIBDError(const std::string &name, const double nsigma, const SKSNSimXSecIBDRVV::ERRORSOURCE src){
+  // relative error of RVV model is used for any IBD model
+  return SKSNSimXSecVariation(name, XSECTYPE::mXSECIBD, [nsigma, src](double e){
+      const double f = 1.0 + nsigma * SKSNSimXSecIBDRVV::GetCrosssectionError(e, src);
+      return ( f > 0. ? f : 0. );
+      });
+}
+
+std::vector<double> SKSNSimXSecVariation::GetFactors(const std::vector<SKSNSimXSecVariation> &vars, const double e, const XSECTYPE t){
+  std::vector<double> f(vars.size());
+  for(size_t i = 0; i < vars.size(); i++) f[i] = vars[i].GetFactor(e, t);
+  return f;
+}
+
+std::vector<std::string> SKSNSimXSecVariation::GetNames(const std::vector<SKSNSimXSecVariation> &vars){
+  std::vector<std::string> n;
+  for(auto it = vars.begin(); it != vars.end(); it++) n.push_back( it->GetName() );
+  return n;
+}
+
 
 double SKSNSimXSecNuElastic::GetCrosssection(double enu, int ipart, FLAGETHR flag) const
 {
@@ -509,46 +670,34 @@ double SKSNSimXSecNuElastic::GetCrosssection(double enu, int ipart, FLAGETHR fla
   if(enu <= nuElaEneMin || enu >= nuElaEneMax) return x;
 
   if(flag == ETHRON) { // should apply Eth
-    constexpr double t_min = eEneThr - Me;
-    const double t_max = 2.*enu*enu/(Me+2.*enu);
-
-    if(t_min > t_max){
-      x = 0.;
-      return x;
+    if( enu <= nuEneThr ) return 0.;
+    const std::vector<double> &cs = csThrSlice[GetFlavorIndex(ipart)];
+    // quadratic interpolation with 3 nodes from the lower edge of the bin,
+    // where the node below the kinematic threshold is replaced by (nuEneThr, 0)
+    int iene = (int)((enu - nuElaEneMin) / thrEneBinSize);
+    if( iene > thrEneNBins - 2 ) iene = thrEneNBins - 2;
+    double e[3], c[3];
+    for(int k = 0; k < 3; k++){
+      e[k] = nuElaEneMin + thrEneBinSize * double(iene + k);
+      c[k] = cs[iene + k];
     }
-
-    constexpr int istep = 1000;
-    const double dstep = (t_max - t_min) / double(istep);
-    x=0.;
-    for (int i = 0; i<istep; i++){
-      double E = (t_min + dstep/2.) + dstep * double(i) + Me;
-      switch (ipart)
-      {
-        case  PDG_ELECTRON_NEUTRINO: x += sl_nue_dif_rad_(&enu, &E) * dstep; break;
-        case -PDG_ELECTRON_NEUTRINO: x += sl_neb_dif_rad_(&enu, &E) * dstep; break;
-        case  PDG_MUON_NEUTRINO:     x += sl_num_dif_rad_(&enu, &E) * dstep; break;
-        case -PDG_MUON_NEUTRINO:     x += sl_nmb_dif_rad_(&enu, &E) * dstep; break;
-        default: std::cerr << "Should not appear this message: " << __FILE__ << " L:" << __LINE__ << std::endl; break;
-      }
+    if( e[0] <= nuEneThr ){
+      e[0] = nuEneThr;
+      c[0] = 0.;
     }
+    x = c[0] * (enu - e[1]) * (enu - e[2]) / ((e[0] - e[1]) * (e[0] - e[2]))
+      + c[1] * (enu - e[0]) * (enu - e[2]) / ((e[1] - e[0]) * (e[1] - e[2]))
+      + c[2] * (enu - e[0]) * (enu - e[1]) / ((e[2] - e[0]) * (e[2] - e[1]));
   }
   else if(flag == ETHROFF) { // should not apply Eth
-    double e1, e2, c1=0., c2=0.;
-
-    const int iene = (int)(enu / nuElaEneBinSize);
-    fCsElaTree->GetEntry(iene-1);
-    e1 = NuElaEnergy;
-    if(ipart ==  12) c1 = CsElaNue;
-    if(ipart == -12) c1 = CsElaNeb;
-    if(ipart ==  14) c1 = CsElaNux;
-    if(ipart == -14) c1 = CsElaNxb;
-
-    fCsElaTree->GetEntry(iene);
-    e2 = NuElaEnergy;
-    if(ipart ==  12) c2 = CsElaNue;
-    if(ipart == -12) c2 = CsElaNeb;
-    if(ipart ==  14) c2 = CsElaNux;
-    if(ipart == -14) c2 = CsElaNxb;
+    const SKSNSimTableView &cs = csEla[GetFlavorIndex(ipart)];
+    int iene = (int)(enu / nuElaEneBinSize);
+    if( iene < 1 ) iene = 1;
+    if( iene >= (int)csElaEne.size() ) iene = (int)csElaEne.size() - 1;
+    const double e1 = csElaEne[iene-1];
+    const double e2 = csElaEne[iene];
+    const double c1 = cs[iene-1];
+    const double c2 = cs[iene];
 
     x = (c2-c1) / (e2-e1) * (enu - e1) + c1;
     //std::cout << enu << " " << iene << " " << e1 << " " << e2 << " " << c1 << " " << c2 << " " << x << std::endl;
@@ -558,7 +707,16 @@ double SKSNSimXSecNuElastic::GetCrosssection(double enu, int ipart, FLAGETHR fla
 
 }
 
-void SKSNSimXSecNuElastic::OpenCsElaFile(){
+void SKSNSimXSecNuElastic::LoadCsElaFile(){
+
+  // Precompiled table file is used if available
+  const SKSNSimTableFile &tablefile = SKSNSimTableFile::GetInstance();
+  if( tablefile.Get("elastic/ene", csElaEne) && csElaEne.size() >= 2 ){
+    bool found = true;
+    for(int k = 0; k < kNELAFLAVOR; k++)
+      found = found && tablefile.Get("elastic/cs/" + std::to_string(k), csEla[k]) && csEla[k].size() == csElaEne.size();
+    if( found ) return;
+  }
 
   const char * env_p = std::getenv(INSTALLDIRVARIABLENAME);
   if( env_p == nullptr ){
@@ -567,20 +725,183 @@ void SKSNSimXSecNuElastic::OpenCsElaFile(){
   }
   const std::string cselafilename = std::string(env_p) + "/table/sn_elastic.root";
 
-  fCsElaFile.reset(new TFile(cselafilename.c_str(), "READ"));
-  fCsElaTree = (TTree*)fCsElaFile->Get("nuela");
-  fCsElaTree->SetBranchAddress("nuene", &NuElaEnergy);
-  fCsElaTree->SetBranchAddress("cnue", &CsElaNue);
-  fCsElaTree->SetBranchAddress("cnux", &CsElaNux);
-  fCsElaTree->SetBranchAddress("cneb", &CsElaNeb);
-  fCsElaTree->SetBranchAddress("cnxb", &CsElaNxb);
+  // Whole table is copied into memory, then the file is closed
+  std::unique_ptr<TFile> f(new TFile(cselafilename.c_str(), "READ"));
+  TTree *tr = (TTree*)f->Get("nuela");
+  if( tr == nullptr ){
+    std::cerr << "nuela tree is not found in " << cselafilename << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  double nuene, cs[kNELAFLAVOR];
+  tr->SetBranchAddress("nuene", &nuene);
+  tr->SetBranchAddress("cnue", &cs[kELANUE]);
+  tr->SetBranchAddress("cneb", &cs[kELANEB]);
+  tr->SetBranchAddress("cnux", &cs[kELANUX]);
+  tr->SetBranchAddress("cnxb", &cs[kELANXB]);
+
+  const Long64_t nentries = tr->GetEntries();
+  if( nentries < 2 ){
+    std::cerr << "Too few entries in nuela tree ( " << nentries << " ) in " << cselafilename << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::vector<double> ene(nentries), ela[kNELAFLAVOR];
+  for(int k = 0; k < kNELAFLAVOR; k++) ela[k].resize(nentries);
+  for(Long64_t i = 0; i < nentries; i++){
+    tr->GetEntry(i);
+    ene[i] = nuene;
+    for(int k = 0; k < kNELAFLAVOR; k++) ela[k][i] = cs[k];
+  }
+  f->Close();
+  csElaEne.Assign(std::move(ene));
+  for(int k = 0; k < kNELAFLAVOR; k++) csEla[k].Assign(std::move(ela[k]));
 }
 
-void SKSNSimXSecNuElastic::CloseCsElaFile(){
-  delete fCsElaTree;
-  if( fCsElaFile != NULL)
-    fCsElaFile->Close();
+double SKSNSimXSecNuElastic::CalcCrosssectionWithThreshold(double enu, int ipart, double ethr) const
+{
+  // Same as the original implementation of ETHRON: midpoint integration of 1000 steps
+  if(enu <= nuElaEneMin || enu >= nuElaEneMax) return 0.;
+  const int flavor = GetFlavorIndex(ipart);
+  if( flavor < 0 ){
+    std::cerr << "Not support particle code " << ipart << std::endl;
+    exit(1);
+  }
+  const double t_min = ethr - Me;
+  const double t_max = 2.*enu*enu/(Me+2.*enu);
+  if(t_min > t_max) return 0.;
+  return IntegrateDiffCrosssection(flavor, enu, t_min, t_max, tailNSteps);
+}
+
+double SKSNSimXSecNuElastic::CalcDiffCrosssectionKin(const int flavor, double enu, double E)
+{
+  switch (flavor)
+  {
+    case kELANUE: return sl_nue_dif_rad_(&enu, &E);
+    case kELANEB: return sl_neb_dif_rad_(&enu, &E);
+    case kELANUX: return sl_num_dif_rad_(&enu, &E);
+    case kELANXB: return sl_nmb_dif_rad_(&enu, &E);
+    default: std::cerr << "Should not appear this message: " << __FILE__ << " L:" << __LINE__ << std::endl; break;
+  }
+  return 0.;
+}
+
+double SKSNSimXSecNuElastic::IntegrateDiffCrosssection(const int flavor, const double enu, const double t_min, const double t_max, const int nsteps)
+{
+  // midpoint rule in kinetic energy of electron
+  if( t_max <= t_min ) return 0.;
+  const double dstep = (t_max - t_min) / double(nsteps);
+  double x = 0.;
+  for (int i = 0; i < nsteps; i++){
+    const double E = (t_min + dstep/2.) + dstep * double(i) + Me;
+    x += CalcDiffCrosssectionKin(flavor, enu, E) * dstep;
+  }
+  return x;
+}
+
+std::vector<double> SKSNSimXSecNuElastic::GetThrTableDefinition() const {
+  return std::vector<double>{ (double)thrEneNBins, (double)thrKinNBins, (double)thrNSteps, (double)tailNSteps, nuElaEneMin, nuElaEneMax, thrKinMax, Me };
+}
+
+void SKSNSimXSecNuElastic::LoadThrTable(){
+  // Precompiled table file is used if it is made with the same table definition
+  const SKSNSimTableFile &tablefile = SKSNSimTableFile::GetInstance();
+  SKSNSimTableView def;
+  if( tablefile.Get("elastic/thr/definition", def) && def.ToVector() == GetThrTableDefinition() ){
+    const size_t n = (thrEneNBins + 1) * (thrKinNBins + 1);
+    bool found = true;
+    for(int k = 0; k < kNELAFLAVOR; k++)
+      found = found && tablefile.Get("elastic/thr/cs/" + std::to_string(k), csThr[k]) && csThr[k].size() == n;
+    if( found ) return;
+  }
+
+  const char * env_p = std::getenv(INSTALLDIRVARIABLENAME);
+  if( env_p == nullptr ){
+    std::cerr << "The environmental variable \"" << INSTALLDIRVARIABLENAME << "\" is not defined. Please set it..." << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  const std::string thrfilename = std::string(env_p) + "/table/sn_elastic_thr.bin";
+  if( ReadThrTable(thrfilename) ) return;
+
+  std::cout << "[SKSNSimXSecNuElastic] building elastic cross section table with threshold ( this is done only once, cached in " << thrfilename << " )" << std::endl;
+  BuildThrTable();
+  WriteThrTable(thrfilename);
+}
+
+void SKSNSimXSecNuElastic::BuildThrTable(){
+  constexpr int nthr = thrKinNBins + 1;
+  for(int k = 0; k < kNELAFLAVOR; k++){
+    std::vector<double> table( (thrEneNBins + 1) * nthr, 0. );
+    for(int i = 1; i <= thrEneNBins; i++){
+      const double enu = nuElaEneMin + thrEneBinSize * double(i);
+      const double t_max = 2.*enu*enu/(Me+2.*enu);
+      double *cs = &table[i * nthr];
+      // cumulative integral from the kinematic maximum down to each threshold
+      cs[thrKinNBins] = IntegrateDiffCrosssection(k, enu, thrKinMax, t_max, tailNSteps);
+      for(int j = thrKinNBins - 1; j >= 0; j--){
+        const double t_low = thrKinBinSize * double(j);
+        const double t_high = std::min(thrKinBinSize * double(j + 1), t_max);
+        cs[j] = cs[j+1] + IntegrateDiffCrosssection(k, enu, t_low, t_high, thrNSteps);
+      }
+    }
+    csThr[k].Assign(std::move(table));
+  }
+}
+
+bool SKSNSimXSecNuElastic::ReadThrTable(const std::string &fname){
+  // SKSNSimTableFile format: broken files are rejected by the checksum
+  std::shared_ptr<const SKSNSimTableFile> f = SKSNSimTableFile::Open(fname);
+  if( f == nullptr ) return false;
+  SKSNSimTableView def, cs[kNELAFLAVOR];
+  if( !f->Get("elastic/thr/definition", def) || def.ToVector() != GetThrTableDefinition() ){
+    std::cout << "[SKSNSimXSecNuElastic] " << fname << " is not compatible with current table definition, ignored" << std::endl;
+    return false;
+  }
+  const size_t n = (thrEneNBins + 1) * (thrKinNBins + 1);
+  for(int k = 0; k < kNELAFLAVOR; k++)
+    if( !f->Get("elastic/thr/cs/" + std::to_string(k), cs[k]) || cs[k].size() != n ) return false;
+  thrfile = f;
+  for(int k = 0; k < kNELAFLAVOR; k++) csThr[k] = cs[k];
+  return true;
+}
+
+void SKSNSimXSecNuElastic::WriteThrTable(const std::string &fname) const {
+  // written to a unique temporary file and renamed by SKSNSimTableFileWriter: safe for jobs writing it at once
+  SKSNSimTableFileWriter writer;
+  writer.Add("elastic/thr/definition", GetThrTableDefinition());
+  for(int k = 0; k < kNELAFLAVOR; k++) writer.Add("elastic/thr/cs/" + std::to_string(k), csThr[k]);
+  if( !writer.Write(fname) )
+    std::cerr << "[SKSNSimXSecNuElastic] WARNING: cannot write " << fname << ", the table will be built again next time" << std::endl;
+}
 
+void SKSNSimXSecNuElastic::ExportTable(SKSNSimTableFileWriter &writer) const {
+  writer.Add("elastic/ene", csElaEne);
+  for(int k = 0; k < kNELAFLAVOR; k++) writer.Add("elastic/cs/" + std::to_string(k), csEla[k]);
+  writer.Add("elastic/thr/definition", GetThrTableDefinition());
+  for(int k = 0; k < kNELAFLAVOR; k++) writer.Add("elastic/thr/cs/" + std::to_string(k), csThr[k]);
+}
+
+void SKSNSimXSecNuElastic::UpdateThrSlice(){
+  // Only the bin including the threshold is integrated, the rest is taken from the table.
+  // Above the table range, whole range is integrated.
+  constexpr int nthr = thrKinNBins + 1;
+  const double t_min = eEneThr - Me;
+  nuEneThr = ( t_min > 0. ? 0.5 * ( t_min + sqrt( t_min * t_min + 2. * Me * t_min ) ) : 0. ); // solution of t_max(Enu) = t_min
+  const bool inTable = ( t_min >= 0. && t_min < thrKinMax );
+  const int j = inTable ? (int)(t_min / thrKinBinSize) : -1;
+  for(int k = 0; k < kNELAFLAVOR; k++){
+    csThrSlice[k].assign(thrEneNBins + 1, 0.);
+    for(int i = 1; i <= thrEneNBins; i++){
+      const double enu = nuElaEneMin + thrEneBinSize * double(i);
+      const double t_max = 2.*enu*enu/(Me+2.*enu);
+      if( t_min > t_max ) continue;
+      if( inTable ){
+        const double t_high = std::min(thrKinBinSize * double(j + 1), t_max);
+        csThrSlice[k][i] = csThr[k][i * nthr + j + 1] + IntegrateDiffCrosssection(k, enu, t_min, t_high, thrNSteps);
+      }
+      else{
+        csThrSlice[k][i] = IntegrateDiffCrosssection(k, enu, t_min, t_max, tailNSteps);
+      }
+    }
+  }
 }
 
 std::pair<double,double> SKSNSimXSecNuElastic::GetDiffCrosssection(double e, double r) const{
@@ -621,17 +942,86 @@ double SKSNSimXSecNuElastic::CalcCosThr(const double nuEne, const double eEth){
 	return cosTth;
 }
 
+void SKSNSimXSecEnergyGrid::Set(const std::vector<double> &ene){
+  m_ene = ene;
+  m_lut.clear();
+  m_cellwidth = 0.;
+  if( m_ene.size() < 2 ) return;
+
+  double width = std::numeric_limits<double>::max();
+  for(size_t i = 1; i < m_ene.size(); i++){
+    if( !( m_ene[i] > m_ene[i-1] ) ){
+      std::cerr << "SKSNSimXSecEnergyGrid: energy grid should be strictly increasing: " << m_ene[i-1] << " " << m_ene[i] << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    width = std::min(width, m_ene[i] - m_ene[i-1]);
+  }
+  m_cellwidth = width;
+
+  const size_t ncell = (size_t)( ( m_ene.back() - m_ene.front() ) / m_cellwidth ) + 1;
+  m_lut.resize(ncell);
+  int i = 0;
+  for(size_t cell = 0; cell < ncell; cell++){
+    const double e = m_ene.front() + m_cellwidth * (double)cell;
+    while( i + 2 < (int)m_ene.size() && e >= m_ene[i + 1] ) i++;
+    m_lut[cell] = i;
+  }
+}
+
+void SKSNSimXSecEnergyGrid::CalcSlope(const double *y, double *slope) const {
+  const size_t n = m_ene.size();
+  for(size_t i = 0; i + 1 < n; i++) slope[i] = ( y[i+1] - y[i] ) / ( m_ene[i+1] - m_ene[i] );
+  if( n > 0 ) slope[n-1] = 0.;
+}
+
 void SKSNSimXSecNuOxygen::LoadFile(){
+  if( LoadCompiledTable() ) return;
+  std::vector<double> crsbuf, slopebuf;
   for(int i = 0; i < NTYPE; i++){
     for(int j = 0; j < NIXSTATE; j++){
-      LoadFile( convToINISTATE(i,j));
+      LoadFile( convToINISTATE(i,j), crsbuf, slopebuf);
     }
   }
+  crs.Assign(std::move(crsbuf));
+  crsSlope.Assign(std::move(slopebuf));
 }
-void SKSNSimXSecNuOxygen::LoadFile(INISTATE ini){
+
+bool SKSNSimXSecNuOxygen::LoadCompiledTable(){
+  const SKSNSimTableFile &tablefile = SKSNSimTableFile::GetInstance();
+  SKSNSimTableView offset, exene, ene;
+  if( !tablefile.Get("oxygen/crs", crs) || !tablefile.Get("oxygen/slope", crsSlope) || crs.size() != crsSlope.size()
+      || !tablefile.Get("oxygen/offset", offset) || offset.size() != NTYPE * NIXSTATE
+      || !tablefile.Get("oxygen/exene", exene) || exene.size() != NTYPE * NIXSTATE * NEXSTATE ){
+    InitializeTable();
+    return false;
+  }
+  for(int iblock = 0; iblock < NTYPE * NIXSTATE; iblock++){
+    if( !tablefile.Get("oxygen/ene/" + std::to_string(iblock), ene)
+        || offset[iblock] + NEXSTATE * NCHANNEL * ene.size() > crs.size() ){
+      InitializeTable();
+      return false;
+    }
+    nuEneGrid[iblock].Set(ene.ToVector());
+    crsOffset[iblock] = (size_t)offset[iblock];
+    isOpened[iblock] = true;
+  }
+  std::copy(exene.data(), exene.data() + exene.size(), exEne);
+  return true;
+}
+
+void SKSNSimXSecNuOxygen::ExportTable(SKSNSimTableFileWriter &writer) const {
+  writer.Add("oxygen/crs", crs);
+  writer.Add("oxygen/slope", crsSlope);
+  writer.Add("oxygen/offset", std::vector<double>(crsOffset, crsOffset + NTYPE * NIXSTATE));
+  writer.Add("oxygen/exene", exEne, NTYPE * NIXSTATE * NEXSTATE);
+  for(int iblock = 0; iblock < NTYPE * NIXSTATE; iblock++) writer.Add("oxygen/ene/" + std::to_string(iblock), nuEneGrid[iblock].GetEnergies());
+}
+
+void SKSNSimXSecNuOxygen::LoadFile(INISTATE ini, std::vector<double> &crsbuf, std::vector<double> &slopebuf){
   const static std::string rctn[NTYPE] = {"nue", "neb"};
-  if (!isOpened[ini]) {
-    std::cout << "new file open (num, ix, isOpen): " << std::get<0>(ini) << " " << std::get<1>(ini) << " " << isOpened[ini] << std::endl;
+  const int iblock = GetBlockIndex(std::get<0>(ini), std::get<1>(ini));
+  if (!isOpened[iblock]) {
+    std::cout << "new file open (num, ix, isOpen): " << std::get<0>(ini) << " " << std::get<1>(ini) << " " << isOpened[iblock] << std::endl;
     const char * env_p = std::getenv(INSTALLDIRVARIABLENAME);
     if( env_p == nullptr ){
         std::cerr << "The environmental variable \"" << INSTALLDIRVARIABLENAME << "\" is not defined. Please set it..." << std::endl;
@@ -647,64 +1037,50 @@ void SKSNSimXSecNuOxygen::LoadFile(INISTATE ini){
       exit(EXIT_FAILURE);
     }
 
+    const int numEx = GetNumEx(std::get<1>(ini));
     double tmp, tmp_e0;
     double tmp_num, tmp_ex, tmp_rec, tmp_pro, tmp_sum;
     double tmp_cs[NCHANNEL];
-    int index = 0;
+    std::vector<double> ene;
+    std::vector<double> filecrs; // [(ibin * numEx + ex) * NCHANNEL + ch], order in the file
     while(ifs>>tmp>>tmp_e0){
-      nuene[ini].push_back(tmp_e0);
-      for(int j=0;j<GetNumEx(std::get<1>(ini));j++){
+      ene.push_back(tmp_e0);
+      for(int j=0;j<numEx;j++){
         ifs >>tmp_num>>tmp_ex>>tmp_rec>>tmp_pro>>tmp_sum>>tmp_cs[0]>>tmp_cs[1]>>tmp_cs[2]>>tmp_cs[3]>>tmp_cs[4]>>tmp_cs[5]>>tmp_cs[6];
-        index++;
-        exEne[ini].push_back(tmp_ex);
-        rec[ini].push_back(tmp_rec);
-        pro_energy[ini].push_back(tmp_pro);
+        if( ene.size() == 1 ) exEne[iblock * NEXSTATE + j] = tmp_ex; // same for all energies
+        for(int k = 0; k < NCHANNEL; k++) filecrs.push_back(tmp_cs[k]);
+      }
+    }
+    ifs.close();
+
+    nuEneGrid[iblock].Set(ene);
+    const size_t nene = ene.size();
+    crsOffset[iblock] = crsbuf.size();
+    crsbuf.resize(crsbuf.size() + NEXSTATE * NCHANNEL * nene, 0.);
+    slopebuf.resize(crsbuf.size(), 0.);
+    for(size_t ie = 0; ie < nene; ie++){
+      for(int j = 0; j < numEx; j++){
         for(int k = 0; k < NCHANNEL; k++){
-          INIFINSTATE inifin = convToINIFINSTATE(ini, j, k);
-          crs[inifin].push_back(tmp_cs[k]);
+          crsbuf[crsOffset[iblock] + (j * NCHANNEL + k) * nene + ie] = filecrs[(ie * numEx + j) * NCHANNEL + k];
         }
       }
     }
-    fileSize[ini] = index;
-    //std::cout << fileSize[num][ix] << std::endl;
-    //std::cout << num << " " << ix << " " << index << std::endl;
-    //std::cout << exEne[num][ix].at(0) << " " << exEne[num][ix].at(1) << " " << exEne[num][ix].at(2) << std::endl;
-    //
-    isOpened[ini] = true;
-    ifs.close();
+    for(int row = 0; row < NEXSTATE * NCHANNEL; row++){
+      nuEneGrid[iblock].CalcSlope(&crsbuf[crsOffset[iblock] + row * nene], &slopebuf[crsOffset[iblock] + row * nene]);
+    }
+
+    isOpened[iblock] = true;
   }
 }
 
 void SKSNSimXSecNuOxygen::InitializeTable(){
-  isOpened.clear();
-  rec.clear();
-  pro_energy.clear();
-  fileSize.clear();
-  exNum.clear();
-  exEne.clear();
-  nuene.clear();
-  crs.clear();
-  for(int t = 0; t < NTYPE; t++){
-    exNum[convToINISTATE(t,0)] = 3;
-    exNum[convToINISTATE(t,1)] = 15;
-    exNum[convToINISTATE(t,2)] = 8;
-    exNum[convToINISTATE(t,3)] = 1;
-    exNum[convToINISTATE(t,4)] = 6;
-    for(int ix = 0; ix < NIXSTATE; ix++){
-      INISTATE ini = convToINISTATE(t,ix);
-      isOpened[ini] = false;
-      rec[ini].clear();
-      pro_energy[ini].clear();
-      exEne[ini].clear();
-      nuene.clear();
-      fileSize[ini] = 0;
-      for(int ex = 0; ex < NEXSTATE; ex++){
-        for(int ch = 0; ch < NCHANNEL; ch++){
-          INIFINSTATE inifin = convToINIFINSTATE(ini,ex,ch);
-          crs[inifin].clear();
-        }
-      }
-    }
+  crs.Clear();
+  crsSlope.Clear();
+  for(int iblock = 0; iblock < NTYPE * NIXSTATE; iblock++){
+    isOpened[iblock] = false;
+    nuEneGrid[iblock] = SKSNSimXSecEnergyGrid();
+    crsOffset[iblock] = 0;
+    for(int ex = 0; ex < NEXSTATE; ex++) exEne[iblock * NEXSTATE + ex] = 0.;
   }
 }
 
@@ -714,28 +1090,18 @@ double SKSNSimXSecNuOxygen::GetCrosssection(double enu, INIFINSTATE inifin) cons
    * Total cross section of nu_e + O --> e^- + X, nu_e_bar + O --> e^+ + X interaction
    */
 
-  double totcso = 0;
-
-  const INISTATE ini = GetINISTATE(inifin);
+  const int iblock = GetBlockIndex(std::get<0>(inifin), std::get<1>(inifin));
   const int ex = std::get<2>(inifin);
   const int ch = std::get<3>(inifin);
-  double rec_energy = 0.0;
-  auto findBin = [ini] (double e, const std::vector<double> &enebin){
-    for(int i = 0; i < 20; i++){
-      if( i > 0 && e < enebin.at(i) && e >= enebin.at(i-1)) return i;
-    }
-    return -1;
-  };
+  const SKSNSimXSecEnergyGrid &grid = nuEneGrid[iblock];
 
-  int ienebin = findBin(enu, nuene.at(ini)); 
+  const int ienebin = grid.FindBin(enu);
   if( ienebin == -1 ) return .0;
-  rec_energy = enu - exEne.at(ini).at(ex);
-  if(rec_energy > Me && rec_energy>eEneThr){
-    totcso = (((crs.at(inifin).at(ienebin)-crs.at(inifin).at(ienebin-1))/(nuene.at(ini).at(ienebin)-nuene.at(ini).at(ienebin-1)))*enu + crs.at(inifin).at(ienebin-1) - ((crs.at(inifin).at(ienebin)-crs.at(inifin).at(ienebin-1))/(nuene.at(ini).at(ienebin)-nuene.at(ini).at(ienebin-1)))*nuene.at(ini).at(ienebin-1)) * 1.0e-26;
-  }
-  else
-    totcso = 0.;
-  return totcso;
+  const double rec_energy = enu - exEne[iblock * NEXSTATE + ex];
+  if( !(rec_energy > Me && rec_energy > eEneThr) ) return .0;
+
+  const size_t i = crsOffset[iblock] + (ex * NCHANNEL + ch) * grid.GetSize() + ienebin;
+  return ( crs[i] + crsSlope[i] * ( enu - grid.GetEnergy(ienebin) ) ) * 1.0e-26;
 }
 
 std::pair<double,double> SKSNSimXSecNuOxygen::GetDiffCrosssection(double e, double r) const
@@ -752,66 +1118,11 @@ double SKSNSimXSecNuOxygen::OxigFuncAngleRecCC(int num, int ix, int ex, int ch,
 
   double costheta = 0;
 
-  std::ifstream ifs[2][5];
-  std::string rctn[2] = {"nue", "neb"};
-
-  const char * env_p = std::getenv(INSTALLDIRVARIABLENAME);
-  if( env_p == nullptr ){
-    std::cerr << "The environmental variable \"" << INSTALLDIRVARIABLENAME << "\" is not defined. Please set it..." << std::endl;
-    exit(EXIT_FAILURE);
-  }
-
-  const std::string target_fname = std::string(env_p) + Form("/table/crsox%s%dstate.dat",rctn[num].c_str(),ix);
-  ifs[num][ix].open(target_fname);
-
-  if(!ifs[num][ix]){
-    std::cerr << "file does not exist" << std::endl;
-    std::cerr << "file name is " << target_fname << std::endl;
-    exit(EXIT_FAILURE);
-  }
-
-  int fileSize[2][5] = {{0}};
-  int exNum[2][5] = {{3,15,8,1,6}};
-  int num_ex = 0;
-  double nuEne = 0.;
-  std::vector<double> Enu[2][5];
-  std::vector<double> totcrs[2][5];
-  std::vector<double> Ee[2][5];
-  int index = 0;
-  double tmp_ene, tmp_crs;
-  std::vector<double> nuene[2][5];
-  double tmp_e0;
-  double tmp;
-  double tmp_cs0, tmp_cs1, tmp_cs2, tmp_cs3, tmp_cs4, tmp_cs5, tmp_cs6, tmp_sum, tmp_rec, tmp_pro, tmp_ex, tmp_num;
-  std::vector<double> exEne[2][5];
-  std::vector<double> rec[2][5];
-  std::vector<double> pro_energy[2][5];
-  if(ix==0) num_ex = 3;
-  else if(ix==1) num_ex = 15;
-  else if(ix==2) num_ex = 8;
-  else if(ix==3) num_ex = 1;
-  else if(ix==4) num_ex = 16;
-  //std::cout << ix << " " << "num_ex is" << " " << num_ex << std::endl;
-  while(ifs[num][ix]>>tmp>>tmp_e0){
-    nuene[num][ix].push_back(tmp_e0);
-    for(int j=0;j<num_ex;j++){
-      ifs[num][ix]>>tmp_num>>tmp_ex>>tmp_rec>>tmp_pro>>tmp_sum>>tmp_cs0>>tmp_cs1>>tmp_cs2>>tmp_cs3>>tmp_cs4>>tmp_cs5>>tmp_cs6;
-      index++;
-      exEne[num][ix].push_back(tmp_ex);
-      rec[num][ix].push_back(tmp_rec);
-      pro_energy[num][ix].push_back(tmp_pro);
-    }
-  }
-  fileSize[num][ix] = index;
-
-  constexpr double me = Me; // MeV
-
   if(ch!=8){
-    double rec_energy[16] = {0.};
-    rec_energy[ex] = enu - exEne[num][ix].at(ex); //energy [MeV] of recoil electron or positron
+    const double rec_energy = enu - GetExcitationEnergy(num, ix, ex); //energy [MeV] of recoil electron or positron
 
-    double a = 1. + (rec_energy[ex]/25.)*(rec_energy[ex]/25.)*(rec_energy[ex]/25.)*(rec_energy[ex]/25.);
-    double b = 3. + (rec_energy[ex]/25.)*(rec_energy[ex]/25.)*(rec_energy[ex]/25.)*(rec_energy[ex]/25.);
+    double a = 1. + (rec_energy/25.)*(rec_energy/25.)*(rec_energy/25.)*(rec_energy/25.);
+    double b = 3. + (rec_energy/25.)*(rec_energy/25.)*(rec_energy/25.)*(rec_energy/25.);
 
     costheta = 0.5 * (1.-(a/b)*cos);
 
@@ -844,62 +1155,7 @@ double SKSNSimXSecNuOxygen::OxigFuncRecEneCC(int num, int ix, int ex, int ch, do
   double recEnergy = 0;
 
   if(ch!=8){
-    std::ifstream ifs[2][5];
-    std::string rctn[2] = {"nue", "neb"};
-
-    const char * env_p = std::getenv(INSTALLDIRVARIABLENAME);
-    if( env_p == nullptr ){
-      std::cerr << "The environmental variable \"" << INSTALLDIRVARIABLENAME << "\" is not defined. Please set it..." << std::endl;
-      exit(EXIT_FAILURE);
-    }
-
-    const std::string target_fname =std::string( env_p) + Form("/table/crsox%s%dstate.dat",rctn[num].c_str(),ix);
-    ifs[num][ix].open( target_fname );
-
-    if(!ifs[num][ix]){
-      std::cerr << "file does not exist" << std::endl;
-      std::cerr << "file name is " << target_fname << std::endl;
-      exit(EXIT_FAILURE);
-    }
-
-    int fileSize[2][5] = {{0}};
-    int exNum[2][5] = {{3,15,8,1,6}};
-    int num_ex = 0;
-    double nuEne = 0.;
-    std::vector<double> Enu[2][5];
-    std::vector<double> Ee[2][5];
-    int index = 0;
-    double tmp_ene, tmp_crs;
-    std::vector<double> nuene[2][5];
-    double tmp_e0;
-    double tmp;
-    double tmp_cs0, tmp_cs1, tmp_cs2, tmp_cs3, tmp_cs4, tmp_cs5, tmp_cs6, tmp_sum, tmp_rec, tmp_pro, tmp_ex, tmp_num;
-    std::vector<double> exEne[2][5];
-    std::vector<double> rec[2][5];
-    std::vector<double> pro_energy[2][5];
-    if     (ix==0) num_ex = 3;
-    else if(ix==1) num_ex = 15;
-    else if(ix==2) num_ex = 8;
-    else if(ix==3) num_ex = 1;
-    else if(ix==4) num_ex = 16;
-    while(ifs[num][ix]>>tmp>>tmp_e0){
-      nuene[num][ix].push_back(tmp_e0);
-      for(int j=0;j<num_ex;j++){
-        ifs[num][ix]>>tmp_num>>tmp_ex>>tmp_rec>>tmp_pro>>tmp_sum>>tmp_cs0>>tmp_cs1>>tmp_cs2>>tmp_cs3>>tmp_cs4>>tmp_cs5>>tmp_cs6;
-        index++;
-        exEne[num][ix].push_back(tmp_ex);
-        rec[num][ix].push_back(tmp_rec);
-        pro_energy[num][ix].push_back(tmp_pro);
-      }
-    }
-    fileSize[num][ix] = index;
-
-    constexpr double me = Me; // MeV
-
-    double rec_energy[16] = {0.};
-    rec_energy[ex] = enu - exEne[num][ix].at(ex); //energy [MeV] of recoil electron or positron
-
-    recEnergy = rec_energy[ex];
+    recEnergy = enu - GetExcitationEnergy(num, ix, ex); //energy [MeV] of recoil electron or positron
   }
 
   if(ch==8){
@@ -920,10 +1176,11 @@ double SKSNSimXSecNuOxygen::OxigFuncRecEneCC(int num, int ix, int ex, int ch, do
   return recEnergy;
 }
 
-void SKSNSimXSecNuOxygenNC::LoadFile(INISTATE ini){
+void SKSNSimXSecNuOxygenNC::LoadFile(INISTATE ini, std::vector<double> &crsbuf, std::vector<double> &slopebuf){
   const static std::string rctn[NTYPE] = {"N", "O"};
-  if (!isOpened[ini]) {
-    std::cout << "new file open (num, isOpen): " << std::get<0>(ini) << " " << isOpened[ini] << std::endl;
+  const int type = std::get<0>(ini);
+  if (!isOpened[type]) {
+    std::cout << "new file open (num, isOpen): " << type << " " << isOpened[type] << std::endl;
 
     const char * env_p = std::getenv(INSTALLDIRVARIABLENAME);
     if( env_p == nullptr ){
@@ -931,7 +1188,7 @@ void SKSNSimXSecNuOxygenNC::LoadFile(INISTATE ini){
       exit(EXIT_FAILURE);
     }
 
-    const std::string target = std::string(env_p) + Form("/table/crossNC_ex%s.dat",rctn[std::get<0>(ini)].c_str());
+    const std::string target = std::string(env_p) + Form("/table/crossNC_ex%s.dat",rctn[type].c_str());
     std::ifstream ifs(target);
 
     if(!ifs){
@@ -940,64 +1197,98 @@ void SKSNSimXSecNuOxygenNC::LoadFile(INISTATE ini){
       exit(EXIT_FAILURE);
     }
 
-    double tmp, tmp_e0;
+    const int numEx = GetNumEx(type);
+    double tmp_e0;
     double tmp_ex;
     double tmp_cs;
-    int index = 0;
+    std::vector<double> ene;
+    std::vector<double> filecrs; // [ibin * numEx + ex], order in the file
     while(ifs>>tmp_e0){
-      nuene[ini].push_back(tmp_e0);
-      for(int j=0;j<GetNumEx(std::get<0>(ini));j++){
-        INIFINSTATE inifin = convToINIFINSTATE(ini, j);
+      ene.push_back(tmp_e0);
+      for(int j=0;j<numEx;j++){
         ifs >>tmp_ex>>tmp_cs;
-        index++;
-        exEne[ini].push_back(tmp_ex);
-        crs[inifin].push_back(tmp_cs);
+        if( ene.size() == 1 ) exEne[type * NEXSTATE + j] = tmp_ex; // same for all energies
+        filecrs.push_back(tmp_cs);
       }
     }
-    fileSize[ini] = index;
-
-    isOpened[ini] = true;
     ifs.close();
+
+    nuEneGrid[type].Set(ene);
+    const size_t nene = ene.size();
+    crsOffset[type] = crsbuf.size();
+    crsbuf.resize(crsbuf.size() + NEXSTATE * nene, 0.);
+    slopebuf.resize(crsbuf.size(), 0.);
+    for(size_t ie = 0; ie < nene; ie++){
+      for(int j = 0; j < numEx; j++) crsbuf[crsOffset[type] + j * nene + ie] = filecrs[ie * numEx + j];
+    }
+    for(int j = 0; j < NEXSTATE; j++){
+      nuEneGrid[type].CalcSlope(&crsbuf[crsOffset[type] + j * nene], &slopebuf[crsOffset[type] + j * nene]);
+    }
+
+    isOpened[type] = true;
   }
 }
 
 void SKSNSimXSecNuOxygenNC::LoadFile() {
-  for( size_t t = 0; t < NTYPE; t++) LoadFile({t});
+  if( LoadCompiledTable() ) return;
+  std::vector<double> crsbuf, slopebuf;
+  for( size_t t = 0; t < NTYPE; t++) LoadFile({t}, crsbuf, slopebuf);
+  crs.Assign(std::move(crsbuf));
+  crsSlope.Assign(std::move(slopebuf));
 }
 
-void SKSNSimXSecNuOxygenNC::InitializeTable(){
-  isOpened.clear();
-  fileSize.clear();
-  exEne.clear();
-  nuene.clear();
-  crs.clear();
+bool SKSNSimXSecNuOxygenNC::LoadCompiledTable(){
+  const SKSNSimTableFile &tablefile = SKSNSimTableFile::GetInstance();
+  SKSNSimTableView offset, exene, ene;
+  if( !tablefile.Get("oxygennc/crs", crs) || !tablefile.Get("oxygennc/slope", crsSlope) || crs.size() != crsSlope.size()
+      || !tablefile.Get("oxygennc/offset", offset) || offset.size() != NTYPE
+      || !tablefile.Get("oxygennc/exene", exene) || exene.size() != NTYPE * NEXSTATE ){
+    InitializeTable();
+    return false;
+  }
   for(int t = 0; t < NTYPE; t++){
-    INISTATE ini = convToINISTATE(t);
-    isOpened[ini] = false;
-    fileSize[ini] = 0;
-    for(int ch = 0; ch < GetNumEx(t); ch++){
-      INIFINSTATE inifin = convToINIFINSTATE(ini,ch);
-      crs[inifin].clear();
+    if( !tablefile.Get("oxygennc/ene/" + std::to_string(t), ene)
+        || offset[t] + NEXSTATE * ene.size() > crs.size() ){
+      InitializeTable();
+      return false;
     }
+    nuEneGrid[t].Set(ene.ToVector());
+    crsOffset[t] = (size_t)offset[t];
+    isOpened[t] = true;
+  }
+  std::copy(exene.data(), exene.data() + exene.size(), exEne);
+  return true;
+}
+
+void SKSNSimXSecNuOxygenNC::ExportTable(SKSNSimTableFileWriter &writer) const {
+  writer.Add("oxygennc/crs", crs);
+  writer.Add("oxygennc/slope", crsSlope);
+  writer.Add("oxygennc/offset", std::vector<double>(crsOffset, crsOffset + NTYPE));
+  writer.Add("oxygennc/exene", exEne, NTYPE * NEXSTATE);
+  for(int t = 0; t < NTYPE; t++) writer.Add("oxygennc/ene/" + std::to_string(t), nuEneGrid[t].GetEnergies());
+}
+
+void SKSNSimXSecNuOxygenNC::InitializeTable(){
+  crs.Clear();
+  crsSlope.Clear();
+  for(int t = 0; t < NTYPE; t++){
+    isOpened[t] = false;
+    nuEneGrid[t] = SKSNSimXSecEnergyGrid();
+    crsOffset[t] = 0;
+    for(int ex = 0; ex < NEXSTATE; ex++) exEne[t * NEXSTATE + ex] = 0.;
   }
 }
 
 double SKSNSimXSecNuOxygenNC::GetCrosssection(double e, INIFINSTATE inifin) const {
-  double totcso = 0.;
+  const int type = std::get<0>(inifin);
+  const int ex = std::get<1>(inifin);
+  const SKSNSimXSecEnergyGrid &grid = nuEneGrid[type];
 
-  const INISTATE ini = GetINISTATE(inifin);
-  auto findBin = [] (double e, const std::vector<double> &enebin){
-    for(size_t i = 1; i < enebin.size(); i++){
-      if(e < enebin.at(i) && e >= enebin.at(i-1)) return (int)i;
-    }
-    return -1;
-  };
-  const int e_bin = findBin(e, nuene.at(ini));
+  const int e_bin = grid.FindBin(e);
+  if( e_bin < 0 || !( e > exEne[type * NEXSTATE + ex] ) ) return 0.;
 
-  if( e_bin >= 0 && e>exEne.at(ini).at(e_bin)){
-    totcso = ((((crs.at(inifin).at(e_bin)-crs.at(inifin).at(e_bin-1))/(nuene.at(ini).at(e_bin)-nuene.at(ini).at(e_bin-1)))*e + crs.at(inifin).at(e_bin-1) - ((crs.at(inifin).at(e_bin)-crs.at(inifin).at(e_bin-1))/(nuene.at(ini).at(e_bin)-nuene.at(ini).at(e_bin-1)))*nuene.at(ini).at(e_bin-1))) * 1.0e-42;
-  }
-  return totcso;
+  const size_t i = crsOffset[type] + ex * grid.GetSize() + e_bin;
+  return ( crs[i] + crsSlope[i] * ( e - grid.GetEnergy(e_bin) ) ) * 1.0e-42;
 }
 
 std::pair<double,double> SKSNSimXSecNuOxygenNC::GetDiffCrosssection(double e, double r) const
@@ -1007,16 +1298,50 @@ std::pair<double,double> SKSNSimXSecNuOxygenNC::GetDiffCrosssection(double e, do
 }
 
 void SKSNSimXSecNuOxygenSub::LoadFile(){
+  if( LoadCompiledTable() ) return;
+  std::vector<double> crsbuf, slopebuf;
   for(int i = 0; i < NTYPE; i++){
     for(int j = 0; j < NIXSTATE; j++){
-      LoadFile(convToINISTATE(i,j));
+      LoadFile(convToINISTATE(i,j), crsbuf, slopebuf);
+    }
+  }
+  crs.Assign(std::move(crsbuf));
+  crsSlope.Assign(std::move(slopebuf));
+}
+
+bool SKSNSimXSecNuOxygenSub::LoadCompiledTable(){
+  const SKSNSimTableFile &tablefile = SKSNSimTableFile::GetInstance();
+  SKSNSimTableView offset, ene;
+  if( !tablefile.Get("oxygensub/crs", crs) || !tablefile.Get("oxygensub/slope", crsSlope) || crs.size() != crsSlope.size()
+      || !tablefile.Get("oxygensub/offset", offset) || offset.size() != NTYPE * NIXSTATE ){
+    InitializeTable();
+    return false;
+  }
+  for(int iblock = 0; iblock < NTYPE * NIXSTATE; iblock++){
+    if( !tablefile.Get("oxygensub/ene/" + std::to_string(iblock), ene)
+        || offset[iblock] + NCHANNEL * ene.size() > crs.size() ){
+      InitializeTable();
+      return false;
     }
+    nuEneGrid[iblock].Set(ene.ToVector());
+    crsOffset[iblock] = (size_t)offset[iblock];
+    isOpened[iblock] = true;
   }
+  return true;
 }
-void SKSNSimXSecNuOxygenSub::LoadFile(INISTATE ini){
+
+void SKSNSimXSecNuOxygenSub::ExportTable(SKSNSimTableFileWriter &writer) const {
+  writer.Add("oxygensub/crs", crs);
+  writer.Add("oxygensub/slope", crsSlope);
+  writer.Add("oxygensub/offset", std::vector<double>(crsOffset, crsOffset + NTYPE * NIXSTATE));
+  for(int iblock = 0; iblock < NTYPE * NIXSTATE; iblock++) writer.Add("oxygensub/ene/" + std::to_string(iblock), nuEneGrid[iblock].GetEnergies());
+}
+
+void SKSNSimXSecNuOxygenSub::LoadFile(INISTATE ini, std::vector<double> &crsbuf, std::vector<double> &slopebuf){
   const static std::string rctn[NTYPE] = {"nue", "neb"};
-  if (!isOpened[ini]) {
-    std::cout << "new file open (num, ix, isOpen): " << std::get<0>(ini) << " " << std::get<1>(ini) << " " << isOpened[ini] << std::endl;
+  const int iblock = GetBlockIndex(std::get<0>(ini), std::get<1>(ini));
+  if (!isOpened[iblock]) {
+    std::cout << "new file open (num, ix, isOpen): " << std::get<0>(ini) << " " << std::get<1>(ini) << " " << isOpened[iblock] << std::endl;
 
     const char * env_p = std::getenv(INSTALLDIRVARIABLENAME);
     if( env_p == nullptr ){
@@ -1033,53 +1358,41 @@ void SKSNSimXSecNuOxygenSub::LoadFile(INISTATE ini){
       exit(EXIT_FAILURE);
     }
 
-    double tmp, tmp_e0;
-    //double tmp_num, tmp_ex, tmp_rec, tmp_pro, tmp_sum;
+    double tmp_e0;
     double tmp_cs[NCHANNEL];
-    int index = 0;
-    while(!ifs.eof()){
-      ifs >>tmp_e0>>
-        tmp_cs[0]>>tmp_cs[1]>>tmp_cs[2]>>tmp_cs[3]>>tmp_cs[4]
-        >>tmp_cs[5]>>tmp_cs[6]>>tmp_cs[7]>>tmp_cs[8]>>tmp_cs[9]
-        >>tmp_cs[10]>>tmp_cs[11]>>tmp_cs[12]>>tmp_cs[13]>>tmp_cs[14]
-        >>tmp_cs[15]>>tmp_cs[16]>>tmp_cs[17]>>tmp_cs[18]>>tmp_cs[19]
-        >>tmp_cs[20]>>tmp_cs[21]>>tmp_cs[22]>>tmp_cs[23]>>tmp_cs[24]
-        >>tmp_cs[25]>>tmp_cs[26]>>tmp_cs[27]>>tmp_cs[28]>>tmp_cs[29]
-        >>tmp_cs[30]>>tmp_cs[31];
-
-      index++;
-      Enu[ini].push_back(tmp_e0);
-      for(int k = 0; k < NCHANNEL; k++){
-        INIFINSTATE inifin = convToINIFINSTATE(ini, k);
-        crs[inifin].push_back(tmp_cs[k]);
-      }
+    std::vector<double> ene;
+    std::vector<double> filecrs; // [ibin * NCHANNEL + ch], order in the file
+    while(ifs>>tmp_e0){
+      for(int k = 0; k < NCHANNEL; k++) ifs >> tmp_cs[k];
+      if( !ifs ) break; // incomplete line at the end
+      ene.push_back(tmp_e0);
+      for(int k = 0; k < NCHANNEL; k++) filecrs.push_back(tmp_cs[k]);
     }
-    fileSize[ini] = index-1;
-    //std::cout << fileSize[num][ix] << std::endl;
-    //std::cout << num << " " << ix << " " << index << std::endl;
-    //std::cout << exEne[num][ix].at(0) << " " << exEne[num][ix].at(1) << " " << exEne[num][ix].at(2) << std::endl;
-    //
-    isOpened[ini] = true;
     ifs.close();
+
+    nuEneGrid[iblock].Set(ene);
+    const size_t nene = ene.size();
+    crsOffset[iblock] = crsbuf.size();
+    crsbuf.resize(crsbuf.size() + NCHANNEL * nene, 0.);
+    slopebuf.resize(crsbuf.size(), 0.);
+    for(size_t ie = 0; ie < nene; ie++){
+      for(int k = 0; k < NCHANNEL; k++) crsbuf[crsOffset[iblock] + k * nene + ie] = filecrs[ie * NCHANNEL + k];
+    }
+    for(int k = 0; k < NCHANNEL; k++){
+      nuEneGrid[iblock].CalcSlope(&crsbuf[crsOffset[iblock] + k * nene], &slopebuf[crsOffset[iblock] + k * nene]);
+    }
+
+    isOpened[iblock] = true;
   }
 }
 
 void SKSNSimXSecNuOxygenSub::InitializeTable(){
-  isOpened.clear();
-  fileSize.clear();
-  Enu.clear();
-  crs.clear();
-  for(int t = 0; t < NTYPE; t++){
-    for(int ix = 0; ix < NIXSTATE; ix++){
-      INISTATE ini = convToINISTATE(t,ix);
-      isOpened[ini] = false;
-      Enu[ini].clear();
-      fileSize[ini] = 0;
-      for(int ch = 0; ch < NCHANNEL; ch++){
-        INIFINSTATE inifin = convToINIFINSTATE(ini,ch);
-        crs[inifin].clear();
-      }
-    }
+  crs.Clear();
+  crsSlope.Clear();
+  for(int iblock = 0; iblock < NTYPE * NIXSTATE; iblock++){
+    isOpened[iblock] = false;
+    nuEneGrid[iblock] = SKSNSimXSecEnergyGrid();
+    crsOffset[iblock] = 0;
   }
 }
 
@@ -1089,21 +1402,15 @@ double SKSNSimXSecNuOxygenSub::GetCrosssection(double enu, INIFINSTATE inifin) c
    * Total cross section of nu_e + O --> e^- + X, nu_e_bar + O --> e^+ + X interaction
    */
 
-  double totcso = 0;
-
-  const INISTATE ini = GetINISTATE(inifin);
+  const int iblock = GetBlockIndex(std::get<0>(inifin), std::get<1>(inifin));
   const int ch = std::get<2>(inifin);
-  double rec_energy = 0.0;
-  auto findBin = [ini] (double e, const std::vector<double> &enebin){
-    for(size_t i = 0; i < enebin.size(); i++){
-      if( i > 0 && e < enebin.at(i) && e >= enebin.at(i-1)) return (int)i;
-    }
-    return -1;
-  };
+  const SKSNSimXSecEnergyGrid &grid = nuEneGrid[iblock];
 
-  int ienebin = findBin(enu, Enu.at(ini)); 
+  const int ienebin = grid.FindBin(enu);
   if( ienebin == -1 ) return .0;
-  switch( std::get<0>(ini)){ // RCN
+
+  double rec_energy = 0.0;
+  switch( std::get<0>(inifin)){ // RCN
     case 0: // nue
       rec_energy = enu - 15.4;
       break;
@@ -1115,13 +1422,10 @@ double SKSNSimXSecNuOxygenSub::GetCrosssection(double enu, INIFINSTATE inifin) c
       rec_energy = 0.0;
       break;
   }
+  if( !(rec_energy > Me) ) return 0.;
 
-  if(rec_energy > Me){
-    totcso = (((crs.at(inifin).at(ienebin)-crs.at(inifin).at(ienebin-1))/(Enu.at(ini).at(ienebin)-Enu.at(ini).at(ienebin-1)))*enu + crs.at(inifin).at(ienebin-1) - ((crs.at(inifin).at(ienebin)-crs.at(inifin).at(ienebin-1))/(Enu.at(ini).at(ienebin)-Enu.at(ini).at(ienebin-1)))*Enu.at(ini).at(ienebin-1)) /* 1.0e-26 */;
-  }
-  else
-    totcso = 0.;
-  return std::max(0.0, totcso);
+  const size_t i = crsOffset[iblock] + ch * grid.GetSize() + ienebin;
+  return std::max(0.0, crs[i] + crsSlope[i] * ( enu - grid.GetEnergy(ienebin) ) /* 1.0e-26 */);
 }
 
 std::pair<double,double> SKSNSimXSecNuOxygenSub::GetDiffCrosssection(double e, double r) const 
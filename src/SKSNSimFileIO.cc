@@ -58,6 +58,10 @@ void SKSNSimFileOutTFile::Open(const std::string fname, const bool including_sne
 	int bufsize = 8*1024*1024;      // may be this is the best 15-OCT-2007 Y.T.
 	m_OutTree->Branch(TopBranch,bufsize);
   m_OutWeightTree->Branch("weight", &weight, "weight/D");
+  m_OutWeightTree->Branch("fluxcomponent", &fluxcomponent, "fluxcomponent/I");
+  m_xsecweights.assign(m_xsecweight_names.size(), 1.0); // not resized after making branches
+  for(size_t i = 0; i < m_xsecweight_names.size(); i++)
+    m_OutWeightTree->Branch(("weight_" + m_xsecweight_names[i]).c_str(), &m_xsecweights[i], ("weight_" + m_xsecweight_names[i] + "/D").c_str());
 }
 
 void SKSNSimFileOutTFile::Close(){
@@ -120,6 +124,9 @@ void SKSNSimFileOutTFile::Write(const SKSNSimSNEventVector &ev){
   m_OutTree->Fill();
 
   weight = ev.GetWeight();
+  fluxcomponent = ev.GetFluxComponent();
+  const std::vector<double> &xsecweights = ev.GetXSecWeights();
+  for(size_t i = 0; i < m_xsecweights.size(); i++) m_xsecweights[i] = ( i < xsecweights.size() ? xsecweights[i] : 1.0 );
   m_OutWeightTree->Fill();
 }
 
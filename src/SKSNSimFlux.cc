@@ -3,6 +3,7 @@
  * Desctiption:
  ************************************/
 
+#include <cmath>
 #include <vector>
 #include <fstream>
 #include <string>
@@ -10,6 +11,10 @@
 #include <iostream>
 #include <sstream>
 #include <iterator>
+#include <map>
+#include <cstdio>
+#include <cstdint>
+#include <sys/stat.h>
 #include "SKSNSimFlux.hh"
 #include "SKSNSimConstant.hh"
 
@@ -17,11 +22,30 @@
 
 using namespace SKSNSimPhysConst;
 
+void SKSNSimFluxModel::FillEnvelope(const FLUXNUTYPE type, SKSNSimFluxEnvelope &env) const {
+  // flux sampled at NSAMPLE energies in each slice (including the edges) and NTIME times
+  constexpr size_t NSAMPLE = 10;
+  constexpr size_t NTIME = 1000;
+  const size_t nslice = env.GetNSlices();
+  std::vector<double> e(nslice * NSAMPLE), flux(nslice * NSAMPLE);
+  for(size_t s = 0; s < nslice; s++)
+    for(size_t i = 0; i < NSAMPLE; i++)
+      e[s * NSAMPLE + i] = env.GetSliceEdge(s) + ( env.GetSliceEdge(s + 1) - env.GetSliceEdge(s) ) * double(i) / double(NSAMPLE - 1);
+  const double tmin = GetTimeLimitMin(), tmax = GetTimeLimitMax();
+  const size_t nt = ( tmax > tmin ? NTIME : 1 );
+  for(size_t it = 0; it < nt; it++){
+    const double t = ( nt > 1 ? tmin + ( tmax - tmin ) * double(it) / double(nt - 1) : tmin );
+    GetFluxSpectrum(t, type, e.size(), e.data(), flux.data());
+    for(size_t i = 0; i < e.size(); i++) env.FillSlice(i / NSAMPLE, t, flux[i]);
+  }
+}
+
 SKSNSimDSNBFluxCustom::SKSNSimDSNBFluxCustom()
 {
       ene_flux_v = std::make_unique<std::vector<std::pair<double,double>>>();
       lower_energy_bin_width = 0.1;
       upper_energy_bin_width = 0.1;
+      buildIndex();
       return;
 }
 
@@ -47,6 +71,8 @@ void SKSNSimDSNBFluxCustom::loadFile(const std::string fname, const std::string
   }
   datafile.close();
   sortByEnergy();
+  buildIndex();
+  invalidateEnvelope();
   return;
 }
 
@@ -68,49 +94,115 @@ void SKSNSimDSNBFluxCustom::sortByEnergy()
   return;
 }
 
+void SKSNSimDSNBFluxCustom::buildIndex()
+{
+  // Assumed the data field ene_flux_v is sorted as lowest energy on first
+  const size_t n = getNBins();
+  binEne.resize(n);
+  binSlope.assign(n, 0.);
+  for(size_t b = 0; b < n; b++) binEne[b] = (*ene_flux_v)[b].first;
+  for(size_t b = 0; b + 1 < n; b++){
+    const std::pair<double,double> &bin = (*ene_flux_v)[b], &nextbin = (*ene_flux_v)[b + 1];
+    // bins of zero width are never selected
+    if( nextbin.first > bin.first ) binSlope[b] = (nextbin.second - bin.second) / (nextbin.first - bin.first);
+  }
+  eneIndex.Set(binEne.data(), n);
+
+  integratedFlux = 0.0;
+  if( n > 1 ){
+    for(size_t b = 0; b < n; b++)
+      integratedFlux += getBinnedFlux(b) * getBinWidth();
+  }
+}
+
 double SKSNSimDSNBFluxCustom::GetFlux(const double nu_ene_MeV, const double time_sec, const FLUXNUTYPE nutype) const 
 {
-  // Assumed the data field ene_flux_v is sorted as lowest energy on first 
   // Calculate flux with linear interpolation
   const static double ERROR_CODE = -9999.;
   const static double OUTOFRANGE = -9998.;
   if(ene_flux_v == NULL) return ERROR_CODE;
-  std::pair<double,double> bin = std::make_pair(-1, 0);
-  std::pair<double,double> nextbin;
-  for(std::vector<std::pair<double,double> >::iterator it = ene_flux_v->begin(); it+1 != ene_flux_v->end(); it++){
-    // IMPROVEMENT: if you implement this with binary tree search, it will be faster
-    if(it->first <= nu_ene_MeV && nu_ene_MeV < (it+1)->first){
-      bin = *it;
-      nextbin = *(it+1);
-      break;
-    }
-  }
-  if(bin.first == -1) {
+  const int b = eneIndex.FindBin(nu_ene_MeV);
+  if(b < 0) {
 #ifdef RETURNEXCEPATIONS
     throw  std::out_of_range("energy is out of range");
 #endif
     return OUTOFRANGE;
   }
 
-  double nuFlux = (nextbin.second - bin.second) * (nu_ene_MeV - bin.first) / (nextbin.first - bin.first) + bin.second;
+  double nuFlux = interpolate(b, nu_ene_MeV);
 #ifdef DEBUG
-  std::cout << "FluxCalculation: nuEne = " << nu_ene_MeV <<", flux = " << nuFlux << ", bin = (" << bin.first << ", " << bin.second << ")" << std::endl;
+  std::cout << "FluxCalculation: nuEne = " << nu_ene_MeV <<", flux = " << nuFlux << ", bin = (" << binEne[b] << ", " << (*ene_flux_v)[b].second << ")" << std::endl;
 #endif
 
   return nuFlux;
 }
 
-double SKSNSimDSNBFluxCustom::CalcIntegratedFlux() const {
-  double sum = 0.0;
-  for(size_t b = 0; b < getNBins(); b++)
-    sum += getBinnedFlux(b) * getBinWidth();
-  return sum;
+void SKSNSimDSNBFluxCustom::GetFluxSpectrum(const double /* time_sec */, const FLUXNUTYPE /* nutype */, const size_t n, const double *e, double *flux) const {
+  const static double ERROR_CODE = -9999.;
+  const static double OUTOFRANGE = -9998.;
+  if(ene_flux_v == NULL){
+    std::fill(flux, flux + n, ERROR_CODE);
+    return;
+  }
+  for(size_t i = 0; i < n; i++){
+    const int b = eneIndex.FindBin(e[i]);
+    flux[i] = ( b < 0 ? OUTOFRANGE : interpolate(b, e[i]) );
+  }
 }
 
 
+void SKSNSimDSNBFluxCustom::FillEnvelopeAt(const double time_sec, SKSNSimFluxEnvelope &env) const {
+  // linear interpolation takes the maximum at the data points or at the edges of the slice
+  const size_t n = getNBins();
+  if( n < 2 ) return;
+  for(size_t b = 0; b < n; b++) env.Fill(binEne[b], time_sec, (*ene_flux_v)[b].second);
+  for(size_t s = 0; s <= env.GetNSlices(); s++){
+    const double e = env.GetSliceEdge(s);
+    const int b = eneIndex.FindBin(e);
+    if( b < 0 ) continue;
+    const double f = interpolate(b, e);
+    if( s > 0 ) env.FillSlice(s - 1, time_sec, f);
+    if( s < env.GetNSlices() ) env.FillSlice(s, time_sec, f);
+  }
+}
+
 void SKSNSimSNFluxCustom::LoadFluxFile(std::string fname){
   std::cout <<"SN model data in SnLoading :  "<<fname << std::endl;
 
+  struct stat st;
+  if( stat(fname.c_str(), &st) != 0 ){
+    std::cerr<<"file load failed"<<std::endl;
+    exit(-1);
+  }
+
+  // cache is used only if it is made from the same model file
+  const std::vector<double> def = { (double)CACHEVERSION, (double)st.st_size, (double)st.st_mtim.tv_sec, (double)st.st_mtim.tv_nsec };
+  const std::string cachename = GetCacheFileName(fname);
+  // a valid cache is mapped without the lock, so that jobs sharing a warm cache do not wait for each other
+  if( cacheEnabled() && readCache(cachename, def) )
+    std::cout << "SN model data is mapped from cache " << cachename << std::endl;
+  else {
+    // other jobs loading the same model wait here until the cache is written, then check it again
+    SKSNSimFileLock lock( cacheEnabled() ? cachename + ".lock" : std::string() );
+    if( cacheEnabled() && readCache(cachename, def) )
+      std::cout << "SN model data is mapped from cache " << cachename << std::endl;
+    else {
+      loadTextFile(fname);
+      buildFluence();
+      if( cacheEnabled() ){
+        writeCache(cachename, def);
+        // parsed data are replaced by the mapping shared with other jobs
+        if( readCache(cachename, def) ) std::cout << "SN model data is mapped from cache " << cachename << std::endl;
+      }
+    }
+  }
+  checkTimeMesh();
+  invalidateEnvelope();
+
+  return;
+}
+
+void SKSNSimSNFluxCustom::loadTextFile(const std::string &fname){
   // file open
   std::ifstream ifs(fname.c_str());
   if(!ifs.is_open()){
@@ -118,7 +210,7 @@ void SKSNSimSNFluxCustom::LoadFluxFile(std::string fname){
     exit(-1);
   }
 
-  // Count Energy bin from the table
+  // Count Energy bin from the first block of the table
   std::string line;
   int Ebin = 0;
   while(std::getline(ifs, line)){
@@ -126,149 +218,740 @@ void SKSNSimSNFluxCustom::LoadFluxFile(std::string fname){
     Ebin++;
   }
   Ebin--;
-  ifs.close();
+  if(Ebin < 2){
+    std::cerr << "Too few energy bins ( " << Ebin << " ) in " << fname << std::endl;
+    exit(EXIT_FAILURE);
+  }
 
-  // Read data
-  ifs.open(fname.c_str());
+  // Read data from the top again
+  ifs.clear();
+  ifs.seekg(0);
+  nbinsEne = Ebin;
+  std::vector<double> t;
+  std::vector<double> me[NFLUXNUTYPE], nf[NFLUXNUTYPE], lf[NFLUXNUTYPE];
   double t0, elow, ehigh;
-  std::vector<double> a0(Ebin), a1(Ebin), a2(Ebin), a3(Ebin), a4(Ebin), a5(Ebin), a6(Ebin), a7(Ebin), a8(Ebin);
+  double n[NFLUXNUTYPE], l[NFLUXNUTYPE];
 
   while(ifs>>t0){
-    tmesh.push_back(t0);
+    t.push_back(t0);
     for(int j=0; j<Ebin ;j++){
-      ifs>>elow>>ehigh>>a3[j]>>a4[j]>>a5[j]>>a6[j]>>a7[j]>>a8[j];
-
-      if(a3[j] > ZERO_PRECISION) a0[j] = a6[j]/a3[j]*ERG2MEV;
-      else {
-        a0[j] = (elow+ehigh)/2.;
-        a3[j] = 0;
-        a6[j] = 0;
+      ifs>>elow>>ehigh>>n[FLUXNUE]>>n[FLUXNUEB]>>n[FLUXNUX]>>l[FLUXNUE]>>l[FLUXNUEB]>>l[FLUXNUX];
+
+      for(int k = 0; k < NFLUXNUTYPE; k++){
+        if(n[k] > ZERO_PRECISION) me[k].push_back(l[k]/n[k]*ERG2MEV);
+        else {
+          me[k].push_back((elow+ehigh)/2.);
+          n[k] = 0.;
+          l[k] = 0.;
+        }
+        nf[k].push_back(n[k]);
+        lf[k].push_back(l[k]);
       }
-      if(a4[j] > ZERO_PRECISION) a1[j] = a7[j]/a4[j]*ERG2MEV;
-      else {
-        a1[j] = (elow+ehigh)/2.;
-        a4[j] = 0.;
-        a7[j] = 0.;
+    }
+  }
+  ifs.close();
+
+  cachefile.reset();
+  tmesh.Assign(std::move(t));
+  for(int k = 0; k < NFLUXNUTYPE; k++){
+    meanEne[k].Assign(std::move(me[k]));
+    numFlux[k].Assign(std::move(nf[k]));
+    lumFlux[k].Assign(std::move(lf[k]));
+  }
+}
+
+SKSNSimSNFluxStream::SKSNSimSNFluxStream(const std::string &fname, const size_t windowsize): m_fname(fname), nbinsEne(0), m_windowsize(std::max(windowsize, (size_t)2)), m_emin(0.), m_emax(0.), m_nread(0), m_fluence_t1(0.), m_fluence_t2(0.) {
+  std::cout << "SN model data is streamed from " << fname << " ( window of " << m_windowsize << " time steps )" << std::endl;
+  m_ifs.open(fname.c_str());
+  if( !m_ifs.is_open() ){
+    std::cerr << "file load failed" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  scanFile();
+  TIMESTEP first;
+  readTimeStep(0, first);
+  m_emin = first.meanEne[FLUXNUE].front();
+  m_emax = first.meanEne[FLUXNUE].back();
+}
+
+void SKSNSimSNFluxStream::scanFile(){
+  // Each time step is a line of the time, lines of the energy bins and a blank line (see SKSNSimSNFluxCustom::loadTextFile).
+  // Only the time lines are parsed here.
+  std::string line;
+  size_t nlines = 0; // lines of the current time step
+  while( std::getline(m_ifs, line) ){
+    const std::streamoff next = m_ifs.tellg();
+    if( line.size() < 2 ){
+      if( nlines > 0 ){
+        if( nbinsEne == 0 ) nbinsEne = nlines - 1;
+        else if( nlines - 1 != nbinsEne ){
+          std::cerr << "Number of energy bins ( " << nlines - 1 << " ) at time " << tmesh.back() << " is different from the first time step ( " << nbinsEne << " ) in " << m_fname << std::endl;
+          exit(EXIT_FAILURE);
+        }
       }
-      if(a5[j] > ZERO_PRECISION) a2[j] = a8[j]/a5[j]*ERG2MEV;
+      nlines = 0;
+    }
+    else if( nlines++ == 0 ){
+      tmesh.push_back( std::stod(line) );
+      offsets.push_back( next );
+    }
+  }
+  if( nlines > 0 && nbinsEne == 0 ) nbinsEne = nlines - 1;
+  if( nbinsEne < 2 || tmesh.size() < 2 ){
+    std::cerr << "Too few energy bins ( " << nbinsEne << " ) or time steps ( " << tmesh.size() << " ) in " << m_fname << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  for(size_t i = 1; i < tmesh.size(); i++){
+    if( !( tmesh[i] > tmesh[i-1] ) ){
+      std::cerr << "Time steps should be in ascending order ( " << tmesh[i-1] << " -> " << tmesh[i] << " ) in " << m_fname << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+  m_ifs.clear();
+}
+
+void SKSNSimSNFluxStream::readTimeStep(const size_t i, TIMESTEP &ts) const {
+  // same conversion as SKSNSimSNFluxCustom::loadTextFile
+  ts.step = i;
+  for(int k = 0; k < NFLUXNUTYPE; k++){
+    ts.meanEne[k].resize(nbinsEne);
+    ts.numFlux[k].resize(nbinsEne);
+  }
+  m_ifs.clear();
+  m_ifs.seekg(offsets[i]);
+  double elow, ehigh, n[NFLUXNUTYPE], l[NFLUXNUTYPE];
+  for(size_t j = 0; j < nbinsEne; j++){
+    if( !( m_ifs >> elow >> ehigh >> n[FLUXNUE] >> n[FLUXNUEB] >> n[FLUXNUX] >> l[FLUXNUE] >> l[FLUXNUEB] >> l[FLUXNUX] ) ){
+      std::cerr << "Failed to read time step " << tmesh[i] << " in " << m_fname << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    for(int k = 0; k < NFLUXNUTYPE; k++){
+      if( n[k] > ZERO_PRECISION ) ts.meanEne[k][j] = l[k] / n[k] * ERG2MEV;
       else {
-        a2[j] = (elow+ehigh)/2.;
-        a5[j] = 0.;
-        a8[j] = 0.;
+        ts.meanEne[k][j] = ( elow + ehigh ) / 2.;
+        n[k] = 0.;
       }
-      //std::cout << t0 << " " << a0[j] << " " << a1[j] << " " << a2[j] << std::endl;// kasiwagi
-      //std::cout << a3[j] << " " << a4[j] << " " << a5[j] << std::endl;// kasiwagi
+      ts.numFlux[k][j] = n[k];
+    }
+  }
+  m_nread++;
+}
 
+const SKSNSimSNFluxStream::TIMESTEP *SKSNSimSNFluxStream::findTimeSteps(const size_t i) const {
+  if( m_window.empty() || i < m_window.front().step || i + 1 > m_window.back().step ){
+    // steps before i are dropped, and the window is filled from i (continued from the last step if it is kept)
+    if( m_window.empty() || i < m_window.front().step || i > m_window.back().step ) m_window.clear();
+    while( !m_window.empty() && m_window.front().step < i ) m_window.pop_front();
+    const size_t last = std::min( i + m_windowsize - 1, tmesh.size() - 1 );
+    for(size_t s = ( m_window.empty() ? i : m_window.back().step + 1 ); s <= last; s++){
+      m_window.emplace_back();
+      readTimeStep(s, m_window.back());
     }
-    enue.push_back(a0);
-    eneb.push_back(a1);
-    enux.push_back(a2);
-    nnue.push_back(a3);
-    nneb.push_back(a4);
-    nnux.push_back(a5);
-    lnue.push_back(a6);
-    lneb.push_back(a7);
-    lnux.push_back(a8);
   }
+  return &m_window[i - m_window.front().step];
+}
 
-  ifs.close();
+size_t SKSNSimSNFluxStream::findTimeBin(const double t) const {
+  const size_t i = std::lower_bound(tmesh.begin(), tmesh.end(), t) - tmesh.begin();
+  return std::min( ( i > 0 ? i - 1 : 0 ), tmesh.size() - 2 );
+}
 
-  return;
+void SKSNSimSNFluxStream::GetFluxSpectrum(const double t, const FLUXNUTYPE type, const size_t n, const double *e, double *flux) const {
+  // same as SKSNSimSNFluxCustom::GetFluxSpectrum()
+  if( !( t >= tmesh.front() && t <= tmesh.back() ) ){
+    std::fill(flux, flux + n, 0.);
+    return;
+  }
+
+  fluxSpectrumInBin(findTimeBin(t), t, type, n, e, flux);
+}
+
+void SKSNSimSNFluxStream::fluxSpectrumInBin(const size_t i, const double t, const FLUXNUTYPE type, const size_t n, const double *e, double *flux) const {
+  const TIMESTEP *ts = findTimeSteps(i); // step i + 1 follows in m_window
+  const TIMESTEP &ts1 = m_window[i + 1 - m_window.front().step];
+  SKSNSimSNFluxCustom::InterpolateTimeStep(t, tmesh[i], tmesh[i+1], nbinsEne,
+      ts->meanEne[type].data(), ts->numFlux[type].data(), ts1.meanEne[type].data(), ts1.numFlux[type].data(), n, e, flux);
+}
+
+void SKSNSimSNFluxStream::GetFluenceSpectrum(const double t1, const double t2, const FLUXNUTYPE type, const size_t n, const double *e, double *fluence) const {
+  // The flux is linear in time within a time step, so that the trapezoid over the parts of the steps in [t1, t2] is exact.
+  // Both ends of a part are evaluated in its own step, as the energy bins are chosen at the top of the step.
+  const double ta = std::max( t1, tmesh.front() ), tb = std::min( t2, tmesh.back() );
+  if( !( tb > ta ) ){
+    std::fill(fluence, fluence + n, 0.);
+    return;
+  }
+  if( !( t1 == m_fluence_t1 && t2 == m_fluence_t2 && m_fluence_e.size() == n && std::equal(e, e + n, m_fluence_e.begin()) ) ){
+    m_fluence_t1 = t1;
+    m_fluence_t2 = t2;
+    m_fluence_e.assign(e, e + n);
+    std::vector<double> f0(n), f1(n);
+    for(int k = 0; k < NFLUXNUTYPE; k++) m_fluence[k].assign(n, 0.);
+    // forward in time: each time step is read at most once
+    for(size_t i = findTimeBin(ta); i + 1 < tmesh.size() && tmesh[i] < tb; i++){
+      const double u = std::max( ta, tmesh[i] ), v = std::min( tb, tmesh[i+1] );
+      if( !( v > u ) ) continue;
+      for(int k = 0; k < NFLUXNUTYPE; k++){
+        fluxSpectrumInBin(i, u, (FLUXNUTYPE)k, n, e, f0.data());
+        fluxSpectrumInBin(i, v, (FLUXNUTYPE)k, n, e, f1.data());
+        for(size_t j = 0; j < n; j++) m_fluence[k][j] += 0.5 * ( v - u ) * ( f0[j] + f1[j] );
+      }
+    }
+  }
+  std::copy(m_fluence[type].begin(), m_fluence[type].end(), fluence);
+}
+
+void SKSNSimSNFluxStream::GetEnergyNodes(const double t, const FLUXNUTYPE type, std::vector<double> &nodes) const {
+  // same as SKSNSimSNFluxCustom::GetEnergyNodes()
+  if( !( t >= tmesh.front() && t <= tmesh.back() ) ){
+    nodes.clear();
+    return;
+  }
+  nodes = findTimeSteps(findTimeBin(t))->meanEne[type];
+}
+
+std::string SKSNSimSNFluxCustom::GetCacheFileName(const std::string &fname){
+  const char *dir = std::getenv(FLUXCACHEDIRVARIABLENAME);
+  if( dir == nullptr || *dir == '\0' ) return fname + ".sksnsimcache";
+
+  // in the cache directory, file name is made unique by the hash of the full path
+  std::string path = fname;
+  if( char *p = realpath(fname.c_str(), nullptr) ){
+    path = p;
+    free(p);
+  }
+  const uint64_t h = SKSNSimTableFile::CalcChecksum(reinterpret_cast<const unsigned char *>(path.data()), path.size());
+  char hash[17];
+  std::snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)h);
+  return std::string(dir) + "/" + path.substr(path.find_last_of('/') + 1) + "." + hash + ".sksnsimcache";
+}
+
+bool SKSNSimSNFluxCustom::readCache(const std::string &cachename, const std::vector<double> &def){
+  std::shared_ptr<const SKSNSimTableFile> f = SKSNSimTableFile::Open(cachename);
+  if( f == nullptr ) return false;
+  SKSNSimTableView d, shape, t, me[NFLUXNUTYPE], nf[NFLUXNUTYPE], lf[NFLUXNUTYPE], cnf[NFLUXNUTYPE], clf[NFLUXNUTYPE];
+  if( !f->Get("definition", d) || d.ToVector() != def ){
+    std::cout << "SN model cache " << cachename << " is outdated, ignored" << std::endl;
+    return false;
+  }
+  if( !f->Get("shape", shape) || shape.size() != 1 || !f->Get("tmesh", t) ) return false;
+  const size_t nbins = (size_t)shape[0];
+  const size_t n = nbins * t.size();
+  if( nbins < 2 || t.size() < 2 ) return false;
+  for(int k = 0; k < NFLUXNUTYPE; k++){
+    const std::string sk = std::to_string(k);
+    if( !f->Get("meanene/" + sk, me[k]) || !f->Get("numflux/" + sk, nf[k]) || !f->Get("lumflux/" + sk, lf[k])
+        || !f->Get("cumnumflux/" + sk, cnf[k]) || !f->Get("cumlumflux/" + sk, clf[k])
+        || me[k].size() != n || nf[k].size() != n || lf[k].size() != n || cnf[k].size() != n || clf[k].size() != n ) return false;
+  }
+
+  cachefile = f;
+  nbinsEne = nbins;
+  tmesh = t;
+  for(int k = 0; k < NFLUXNUTYPE; k++){
+    meanEne[k] = me[k];
+    numFlux[k] = nf[k];
+    lumFlux[k] = lf[k];
+    cumNumFlux[k] = cnf[k];
+    cumLumFlux[k] = clf[k];
+  }
+  return true;
+}
+
+void SKSNSimSNFluxCustom::writeCache(const std::string &cachename, const std::vector<double> &def) const {
+  SKSNSimTableFileWriter writer;
+  writer.Add("definition", def);
+  writer.Add("shape", std::vector<double>{ (double)nbinsEne });
+  writer.Add("tmesh", tmesh);
+  for(int k = 0; k < NFLUXNUTYPE; k++){
+    const std::string sk = std::to_string(k);
+    writer.Add("meanene/" + sk, meanEne[k]);
+    writer.Add("numflux/" + sk, numFlux[k]);
+    writer.Add("lumflux/" + sk, lumFlux[k]);
+    writer.Add("cumnumflux/" + sk, cumNumFlux[k]);
+    writer.Add("cumlumflux/" + sk, cumLumFlux[k]);
+  }
+  if( writer.Write(cachename) ) std::cout << "SN model data is cached in " << cachename << std::endl;
+  else std::cout << "SN model data is not cached ( set " << FLUXCACHEDIRVARIABLENAME << " to a writable directory )" << std::endl;
+}
+
+void SKSNSimSNFluxCustom::checkTimeMesh(){
+  tmeshUniform = false;
+  if( tmesh.size() < 2 ) return;
+  const double dt = ( tmesh.back() - tmesh.front() ) / double(tmesh.size() - 1);
+  if( !( dt > 0. ) ) return;
+  for(size_t i = 0; i < tmesh.size(); i++)
+    if( std::fabs( tmesh[i] - ( tmesh.front() + dt * double(i) ) ) > 1.e-3 * dt ) return;
+  tmeshUniform = true;
+}
+
+size_t SKSNSimSNFluxCustom::findTimeBin(const double t) const {
+  const size_t nlast = tmesh.size() - 2;
+  if( !tmeshUniform ){
+    const size_t i = std::lower_bound(tmesh.begin(), tmesh.end(), t) - tmesh.begin();
+    return ( i == 0 ? 0 : std::min(i - 1, nlast) );
+  }
+  // guess from equal spacing, then corrected by at most one step
+  const double u = ( t - tmesh.front() ) / ( tmesh.back() - tmesh.front() ) * double(tmesh.size() - 1);
+  size_t i = ( u > 1. ? std::min( (size_t)std::ceil(u) - 1, nlast ) : 0 );
+  while( i > 0 && tmesh[i] >= t ) i--;
+  while( i < nlast && tmesh[i + 1] < t ) i++;
+  return i;
 }
 
 double SKSNSimSNFluxCustom::GetFlux(const double e, const double t, const FLUXNUTYPE type) const {
+  // out of time range
+  if( tmesh.size() < 2 || nbinsEne < 2 || !( t >= tmesh.front() && t <= tmesh.back() ) ) return 0.;
+
+  const size_t i = findTimeBin(t);
+  const double *ebins0 = &meanEne[type][i * nbinsEne];
+  const double *nbins0 = &numFlux[type][i * nbinsEne];
+  const double *ebins1 = ebins0 + nbinsEne;
+  const double *nbins1 = nbins0 + nbinsEne;
+
+  // energy bin is searched at time step i, and used for both time steps
+  const size_t j = std::lower_bound(ebins0 + 1, ebins0 + nbinsEne - 1, e) - ebins0;
+
+  auto interpolate = [e, j](const double *ebins, const double *nbins){
+    const double elow = ebins[j-1], ehigh = ebins[j];
+    if( ehigh == 0 && elow == 0 ) return 0.;
+    return (nbins[j] - nbins[j-1]) * (e - elow) / (ehigh - elow) + nbins[j-1];
+  };
+  const double nspc0 = interpolate(ebins0, nbins0);
+  const double nspc1 = interpolate(ebins1, nbins1);
+  return (nspc1 - nspc0) * (t - tmesh[i]) / (tmesh[i+1] - tmesh[i]) + nspc0;
+}
+
+void SKSNSimSNFluxCustom::GetFluxSpectrum(const double t, const FLUXNUTYPE type, const size_t n, const double *e, double *flux) const {
+  // same as GetFlux(), with the time bin searched once
+  if( tmesh.size() < 2 || nbinsEne < 2 || !( t >= tmesh.front() && t <= tmesh.back() ) ){
+    std::fill(flux, flux + n, 0.);
+    return;
+  }
+
+  const size_t i = findTimeBin(t);
+  const double *ebins0 = &meanEne[type][i * nbinsEne];
+  const double *nbins0 = &numFlux[type][i * nbinsEne];
+  InterpolateTimeStep(t, tmesh[i], tmesh[i+1], nbinsEne, ebins0, nbins0, ebins0 + nbinsEne, nbins0 + nbinsEne, n, e, flux);
+}
 
-  double nspc = 0;
-  double nspc0 = 0.;
-
-  const std::vector<std::vector<double>> &ebins = 
-    type == FLUXNUTYPE::FLUXNUE? enue: (
-    type == FLUXNUTYPE::FLUXNUEB? eneb: enux);
-  const std::vector<std::vector<double>> &nbins = 
-    type == FLUXNUTYPE::FLUXNUE? nnue: (
-    type == FLUXNUTYPE::FLUXNUEB? nneb: nnux);
-
-  if(t >= tmesh[0] || t < tmesh[tmesh.size()-1]){
-    int i = 0;
-    while(tmesh[i] < t) i++;
-    i--;
-    int j = 1;
-    while(ebins[i][j] < e && j<20) j++;
-
-    //cout << "time   " << time << " " << i << " " << tmesh[i] << " " << tmesh[i+1] << endl;
-    //cout << "energy " << energy << " " << j << endl;
-
-    double nspclow, nspchigh, elow, ehigh;
-
-    nspclow  = nbins[i][j-1];
-    nspchigh = nbins[i][j];
-    elow  = ebins[i][j-1];
-    ehigh = ebins[i][j];
-    if(ehigh!=0 || elow!=0){
-      nspc0 = (nspchigh - nspclow) * (e - elow) / (ehigh - elow) + nspclow;
+void SKSNSimSNFluxCustom::InterpolateTimeStep(const double t, const double t0, const double t1, const size_t nbins,
+    const double *ebins0, const double *nbins0, const double *ebins1, const double *nbins1, const size_t n, const double *e, double *flux){
+  auto interpolate = [](const double e, const size_t j, const double *ebins, const double *nbins){
+    const double elow = ebins[j-1], ehigh = ebins[j];
+    if( ehigh == 0 && elow == 0 ) return 0.;
+    return (nbins[j] - nbins[j-1]) * (e - elow) / (ehigh - elow) + nbins[j-1];
+  };
+  size_t j = 1;
+  for(size_t k = 0; k < n; k++){
+    // ascending energies continue the search from the previous bin
+    if( k > 0 && e[k] >= e[k-1] ) while( j < nbins - 1 && ebins0[j] < e[k] ) j++;
+    else j = std::lower_bound(ebins0 + 1, ebins0 + nbins - 1, e[k]) - ebins0;
+    const double nspc0 = interpolate(e[k], j, ebins0, nbins0);
+    const double nspc1 = interpolate(e[k], j, ebins1, nbins1);
+    flux[k] = (nspc1 - nspc0) * (t - t0) / (t1 - t0) + nspc0;
+  }
+}
+
+void SKSNSimSNFluxCustom::buildFluence(){
+  const size_t nt = tmesh.size();
+  for(int k = 0; k < NFLUXNUTYPE; k++){
+    std::vector<double> cn(nt * nbinsEne, 0.), cl(nt * nbinsEne, 0.);
+    for(size_t i = 1; i < nt; i++){
+      const double dt = tmesh[i] - tmesh[i-1];
+      for(size_t j = 0; j < nbinsEne; j++){
+        const size_t b = i * nbinsEne + j;
+        cn[b] = cn[b - nbinsEne] + 0.5 * ( numFlux[k][b - nbinsEne] + numFlux[k][b] ) * dt;
+        cl[b] = cl[b - nbinsEne] + 0.5 * ( lumFlux[k][b - nbinsEne] + lumFlux[k][b] ) * dt;
+      }
     }
-    else if(ehigh==0 && elow==0){
-      nspc0 = 0.;
+    cumNumFlux[k].Assign(std::move(cn));
+    cumLumFlux[k].Assign(std::move(cl));
+  }
+}
+
+void SKSNSimSNFluxCustom::integrateBins(const double t, const FLUXNUTYPE type, double *num, double *lum) const {
+  // accumulated to time step i, then the linearly interpolated flux from tmesh[i] to t
+  const double tc = std::min( std::max( t, tmesh.front() ), tmesh.back() );
+  const size_t i = findTimeBin(tc);
+  const double dt = tc - tmesh[i];
+  const double f = 0.5 * dt / ( tmesh[i+1] - tmesh[i] );
+  const size_t b0 = i * nbinsEne, b1 = b0 + nbinsEne;
+  for(size_t j = 0; j < nbinsEne; j++){
+    num[j] = cumNumFlux[type][b0 + j] + dt * ( numFlux[type][b0 + j] + f * ( numFlux[type][b1 + j] - numFlux[type][b0 + j] ) );
+    lum[j] = cumLumFlux[type][b0 + j] + dt * ( lumFlux[type][b0 + j] + f * ( lumFlux[type][b1 + j] - lumFlux[type][b0 + j] ) );
+  }
+}
+
+void SKSNSimSNFluxCustom::GetBinnedFluence(const double t1, const double t2, const FLUXNUTYPE type, double *num, double *meanene) const {
+  if( tmesh.size() < 2 || nbinsEne < 2 ) return;
+  std::vector<double> num1(nbinsEne), lum1(nbinsEne), lum2(nbinsEne);
+  integrateBins(t1, type, num1.data(), lum1.data());
+  integrateBins(t2, type, num, lum2.data());
+  // mean energy of the bin weighted by the fluence, or that at t1 without fluence (same as loadTextFile())
+  const size_t b1 = findTimeBin( std::min( std::max( t1, tmesh.front() ), tmesh.back() ) ) * nbinsEne;
+  for(size_t j = 0; j < nbinsEne; j++){
+    num[j] = ( t2 > t1 ? num[j] - num1[j] : 0. );
+    const double lum = lum2[j] - lum1[j];
+    meanene[j] = ( num[j] > ZERO_PRECISION && lum > 0. ? lum / num[j] * ERG2MEV : meanEne[type][b1 + j] );
+  }
+}
+
+void SKSNSimSNFluxCustom::GetFluenceSpectrum(const double t1, const double t2, const FLUXNUTYPE type, const size_t n, const double *e, double *fluence) const {
+  if( tmesh.size() < 2 || nbinsEne < 2 ){
+    std::fill(fluence, fluence + n, 0.);
+    return;
+  }
+  std::vector<double> nbins(nbinsEne), ebins(nbinsEne);
+  GetBinnedFluence(t1, t2, type, nbins.data(), ebins.data());
+  // energy interpolation of GetFlux()
+  for(size_t k = 0; k < n; k++){
+    const size_t j = std::lower_bound(ebins.begin() + 1, ebins.end() - 1, e[k]) - ebins.begin();
+    const double elow = ebins[j-1], ehigh = ebins[j];
+    fluence[k] = ( ehigh == 0 && elow == 0 ? 0. : (nbins[j] - nbins[j-1]) * (e[k] - elow) / (ehigh - elow) + nbins[j-1] );
+  }
+}
+
+void SKSNSimSNFluxCustom::GetEnergyNodes(const double t, const FLUXNUTYPE type, std::vector<double> &nodes) const {
+  // energy bin is searched at the top of the time step in GetFlux()
+  if( tmesh.size() < 2 || nbinsEne < 2 || !( t >= tmesh.front() && t <= tmesh.back() ) ){
+    nodes.clear();
+    return;
+  }
+  const double *ebins = &meanEne[type][findTimeBin(t) * nbinsEne];
+  nodes.assign(ebins, ebins + nbinsEne);
+}
+
+void SKSNSimSNFluxCustom::FillEnvelope(const FLUXNUTYPE type, SKSNSimFluxEnvelope &env) const {
+  // In time step i, the energy bin j is chosen at tmesh[i] and the flux is linear in energy at both ends of the step
+  // and linear in time between them, so that the maximum in each (bin j) x (slice) region is at its corners.
+  if( tmesh.size() < 2 || nbinsEne < 2 ) return;
+  const double emin = env.GetSliceEdge(0), emax = env.GetSliceEdge(env.GetNSlices());
+  for(size_t i = 0; i + 1 < tmesh.size(); i++){
+    const double *ebins0 = &meanEne[type][i * nbinsEne];
+    const double *nbins0 = &numFlux[type][i * nbinsEne];
+    const double *ebins1 = ebins0 + nbinsEne;
+    const double *nbins1 = nbins0 + nbinsEne;
+    for(size_t j = 1; j < nbinsEne; j++){
+      const double elow = ebins0[j-1], ehigh = ebins0[j];
+      if( ehigh == elow ) continue; // zero flux (both zero) or empty region
+      // energies given bin j in GetFlux(): (ebins0[j-1], ebins0[j]], open at both ends of the table
+      const double lo = ( j == 1 ? emin : std::max(emin, ebins0[j-1]) );
+      const double hi = ( j == nbinsEne - 1 ? emax : std::min(emax, ebins0[j]) );
+      if( lo > hi ) continue;
+      auto interpolate = [j](const double e, const double *ebins, const double *nbins){
+        return (nbins[j] - nbins[j-1]) * (e - ebins[j-1]) / (ebins[j] - ebins[j-1]) + nbins[j-1];
+      };
+      const size_t s1 = env.FindSlice(lo), s2 = env.FindSlice(hi);
+      for(size_t sl = s1; sl <= s2; sl++){
+        const double corners[2] = { std::max(lo, env.GetSliceEdge(sl)), std::min(hi, env.GetSliceEdge(sl + 1)) };
+        for(const double e : corners){
+          env.FillSlice(sl, tmesh[i], interpolate(e, ebins0, nbins0));
+          env.FillSlice(sl, tmesh[i+1], interpolate(e, ebins1, nbins1));
+        }
+      }
     }
-    //cout << nspc0 << endl;
+  }
+}
 
-    nspclow  = nbins[i+1][j-1];
-    nspchigh = nbins[i+1][j];
-    elow  = ebins[i+1][j-1];
-    ehigh = ebins[i+1][j];
-    if(ehigh!=0 || elow!=0){
-      double nspc1 = (nspchigh - nspclow) * (e - elow) / (ehigh - elow) + nspclow;
-      //cout << nspc1 << endl;
+SKSNSimPiecewiseLinear::SKSNSimPiecewiseLinear(const std::vector<double> &t, const std::vector<double> &v): m_t(t), m_v(v) {
+  if( m_t.empty() || m_t.size() != m_v.size() ){
+    std::cerr << "SKSNSimPiecewiseLinear: sizes of times ( " << m_t.size() << " ) and values ( " << m_v.size() << " ) are different or zero" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  for(size_t i = 1; i < m_t.size(); i++){
+    if( !( m_t[i] > m_t[i-1] ) ){
+      std::cerr << "SKSNSimPiecewiseLinear: times should be in ascending order ( " << m_t[i-1] << " -> " << m_t[i] << " )" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+}
 
-      nspc = (nspc1 - nspc0) * (t - tmesh[i]) / (tmesh[i+1] - tmesh[i]) + nspc0;
+bool SKSNSimPiecewiseLinear::Parse(const std::string &s, SKSNSimPiecewiseLinear &f){
+  // format: "15" (constant) or "9.5@0/15@0.5/12@10" ({value}@{time} in ascending time)
+  std::vector<double> t, v;
+  std::string::size_type begin = 0;
+  while( begin <= s.size() ){
+    const auto end = std::min( s.find('/', begin), s.size() );
+    const std::string item = s.substr(begin, end - begin);
+    begin = end + 1;
+    const auto pos = item.find('@');
+    try {
+      size_t nv = 0, nt = 0;
+      v.push_back( std::stod( item.substr(0, pos), &nv ) );
+      t.push_back( ( pos == std::string::npos ? 0. : std::stod( item.substr(pos+1), &nt ) ) );
+      if( nv != item.substr(0, pos).size() || ( pos != std::string::npos && nt != item.size() - pos - 1 ) ) throw std::invalid_argument(item);
+    } catch ( const std::exception &e ) {
+      std::cout << "ERR: wrong knot \"" << item << "\" ({value} or {value}@{time})" << std::endl;
+      return false;
     }
-    else if(ehigh==0 && elow==0){
-      double nspc1 = 0.;
-      nspc = (nspc1 - nspc0) * (t - tmesh[i]) / (tmesh[i+1] - tmesh[i]) + nspc0;
+    if( pos == std::string::npos && s.find('/') != std::string::npos ){
+      std::cout << "ERR: time is needed for each knot of \"" << s << "\"" << std::endl;
+      return false;
+    }
+    if( t.size() > 1 && !( t.back() > t[t.size() - 2] ) ){
+      std::cout << "ERR: knots should be in ascending order of time: " << s << std::endl;
+      return false;
     }
-    //cout << nspc << endl;
   }
+  f = SKSNSimPiecewiseLinear(t, v);
+  return true;
+}
 
-  return nspc;
+SKSNSimSNFluxParametric::SKSNSimSNFluxParametric(): m_emin(0.), m_emax(300.), m_tmin(0.), m_tmax(20.) {
+  SetDefaultParameters();
+}
 
+void SKSNSimSNFluxParametric::SetDefaultParameters(){
+  // constant in time: hierarchy of mean energies in the cooling phase, and 3x10^53 erg emitted in 10 sec by 6 species
+  const double meanene[NFLUXNUTYPE] = { 12., 15., 18. };
+  for(int k = 0; k < NFLUXNUTYPE; k++){
+    m_param[k][kMEANENERGY] = SKSNSimPiecewiseLinear( meanene[k] );
+    m_param[k][kALPHA] = SKSNSimPiecewiseLinear( 3. );
+    m_param[k][kLUMINOSITY] = SKSNSimPiecewiseLinear( 5.e51 );
+  }
+  invalidateEnvelope();
+}
+
+bool SKSNSimSNFluxParametric::SetParameters(const std::string &s){
+  // format: "nueb:E=12@0/15@1/14@10,alpha=2.5,L=5e52@0/1e52@10"
+  const static std::map<std::string, PARAMETER> names { { "E", kMEANENERGY }, { "alpha", kALPHA }, { "L", kLUMINOSITY } };
+  const static std::map<std::string, std::vector<FLUXNUTYPE>> flavors {
+    { "nue", { FLUXNUE } }, { "nueb", { FLUXNUEB } }, { "nux", { FLUXNUX } }, { "all", { FLUXNUE, FLUXNUEB, FLUXNUX } }
+  };
+  const auto colon = s.find(':');
+  auto flavor = flavors.find( s.substr(0, colon) );
+  if( colon == std::string::npos || flavor == flavors.end() ){
+    std::cout << "ERR: wrong flavor in \"" << s << "\" (supporting nue, nueb, nux and all)" << std::endl;
+    return false;
+  }
+  // all items are checked before any of parameters is modified
+  std::vector<std::pair<PARAMETER, SKSNSimPiecewiseLinear>> items;
+  std::string::size_type begin = colon + 1;
+  while( begin <= s.size() ){
+    const auto end = std::min( s.find(',', begin), s.size() );
+    const std::string item = s.substr(begin, end - begin);
+    begin = end + 1;
+    const auto pos = item.find('=');
+    auto name = names.find( item.substr(0, pos) );
+    if( pos == std::string::npos || name == names.end() ){
+      std::cout << "ERR: wrong parameter \"" << item << "\" (supporting E, alpha and L)" << std::endl;
+      return false;
+    }
+    SKSNSimPiecewiseLinear f;
+    if( !SKSNSimPiecewiseLinear::Parse( item.substr(pos+1), f ) ) return false;
+    items.emplace_back( name->second, f );
+  }
+  for(auto it = flavor->second.begin(); it != flavor->second.end(); it++)
+    for(auto item = items.begin(); item != items.end(); item++) SetParameter(*it, item->first, item->second);
+  return true;
+}
+
+void SKSNSimSNFluxParametric::DumpParameters(std::ostream &out) const {
+  const char *flavors[NFLUXNUTYPE] = { "nue", "nueb", "nux" };
+  const char *names[kNPARAMETER] = { "E (MeV)", "alpha", "L (erg/s)" };
+  for(int k = 0; k < NFLUXNUTYPE; k++){
+    for(int p = 0; p < kNPARAMETER; p++){
+      const SKSNSimPiecewiseLinear &f = m_param[k][p];
+      out << flavors[k] << " " << names[p] << " =";
+      if( f.GetNKnots() == 1 ) out << " " << f.GetKnotValue(0);
+      else for(size_t i = 0; i < f.GetNKnots(); i++) out << " " << f.GetKnotValue(i) << "@" << f.GetKnotTime(i);
+      out << std::endl;
+    }
+  }
+}
+
+void SKSNSimSNFluxParametric::getShape(const double t, const FLUXNUTYPE type, double *lognorm, double *alpha, double *slope) const {
+  const double meanene = m_param[type][kMEANENERGY](t);
+  const double a = m_param[type][kALPHA](t);
+  const double lum = m_param[type][kLUMINOSITY](t);
+  *alpha = a;
+  if( !( meanene > 0. ) || !( a > -1. ) || !( lum > 0. ) ){
+    *lognorm = -INFINITY;
+    *slope = 0.;
+    return;
+  }
+  // number luminosity (/s) x normalization of the spectrum
+  *lognorm = std::log( lum * ERG2MEV / meanene ) + (a + 1.) * std::log( (a + 1.) / meanene ) - std::lgamma(a + 1.);
+  *slope = (a + 1.) / meanene;
+}
+
+double SKSNSimSNFluxParametric::GetFlux(const double e, const double t, const FLUXNUTYPE type) const {
+  double flux = 0.;
+  GetFluxSpectrum(t, type, 1, &e, &flux);
+  return flux;
+}
+
+void SKSNSimSNFluxParametric::GetFluxSpectrum(const double t, const FLUXNUTYPE type, const size_t n, const double *e, double *flux) const {
+  // out of time range, same as SKSNSimSNFluxCustom
+  if( !( t >= m_tmin && t <= m_tmax ) ){
+    std::fill(flux, flux + n, 0.);
+    return;
+  }
+  double lognorm, alpha, slope;
+  getShape(t, type, &lognorm, &alpha, &slope);
+  // the log is taken at 1 for non-positive energies, whose flux is zero
+  for(size_t i = 0; i < n; i++){
+    const double x = ( e[i] > 0. ? e[i] : 1. );
+    const double f = std::exp( lognorm + alpha * std::log(x) - slope * x );
+    flux[i] = ( e[i] > 0. ? f : 0. );
+  }
+}
+
+SKSNSimFluxTransform::SKSNSimFluxTransform(std::shared_ptr<const SKSNSimFluxModel> base): m_base(base), m_norm(1.), m_escale(1.), m_shift(0.), m_dilation(1.) {
+  if( m_base == nullptr ){
+    std::cerr << "SKSNSimFluxTransform: no base flux model" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  // folded into one transform of the innermost model
+  if( auto t = std::dynamic_pointer_cast<const SKSNSimFluxTransform>(m_base) ){
+    m_base = t->m_base;
+    m_norm = t->m_norm;
+    m_escale = t->m_escale;
+    m_shift = t->m_shift;
+    m_dilation = t->m_dilation;
+  }
+}
+
+SKSNSimFluxTransform &SKSNSimFluxTransform::ScaleFlux(const double f){
+  if( !( f >= 0. ) ){
+    std::cerr << "SKSNSimFluxTransform: wrong flux scale " << f << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  m_norm *= f;
+  invalidateEnvelope();
+  return *this;
+}
+
+SKSNSimFluxTransform &SKSNSimFluxTransform::SetDistance(const double kpc, const double ref_kpc){
+  if( !( kpc > 0. ) || !( ref_kpc > 0. ) ){
+    std::cerr << "SKSNSimFluxTransform: wrong distance " << kpc << " kpc (reference " << ref_kpc << " kpc)" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  return ScaleFlux( ( ref_kpc / kpc ) * ( ref_kpc / kpc ) );
+}
+
+SKSNSimFluxTransform &SKSNSimFluxTransform::ShiftTime(const double dt){
+  m_shift += dt;
+  invalidateEnvelope();
+  return *this;
+}
+
+SKSNSimFluxTransform &SKSNSimFluxTransform::DilateTime(const double f){
+  if( !( f > 0. ) ){
+    std::cerr << "SKSNSimFluxTransform: wrong time dilation " << f << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  m_shift *= f;
+  m_dilation *= f;
+  invalidateEnvelope();
+  return *this;
+}
+
+SKSNSimFluxTransform &SKSNSimFluxTransform::ScaleEnergy(const double f){
+  if( !( f > 0. ) ){
+    std::cerr << "SKSNSimFluxTransform: wrong energy scale " << f << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  m_escale *= f;
+  invalidateEnvelope();
+  return *this;
+}
+
+void SKSNSimFluxTransform::GetFluxSpectrum(const double t, const FLUXNUTYPE type, const size_t n, const double *e, double *flux) const {
+  if( m_escale == 1. ) m_base->GetFluxSpectrum(baseTime(t), type, n, e, flux);
+  else {
+    std::vector<double> ebase(n);
+    for(size_t i = 0; i < n; i++) ebase[i] = e[i] / m_escale;
+    m_base->GetFluxSpectrum(baseTime(t), type, n, ebase.data(), flux);
+  }
+  const double f = factor();
+  for(size_t i = 0; i < n; i++) flux[i] *= f;
+}
+
+void SKSNSimFluxTransform::GetFluxGrid(const size_t nt, const double *t, const FLUXNUTYPE type, const size_t ne, const double *e, double *flux) const {
+  std::vector<double> tbase(nt), ebase(ne);
+  for(size_t i = 0; i < nt; i++) tbase[i] = baseTime(t[i]);
+  for(size_t i = 0; i < ne; i++) ebase[i] = e[i] / m_escale;
+  m_base->GetFluxGrid(nt, tbase.data(), type, ne, ebase.data(), flux);
+  const double f = factor();
+  for(size_t i = 0; i < nt * ne; i++) flux[i] *= f;
+}
+
+void SKSNSimFluxTransform::GetFluenceSpectrum(const double t1, const double t2, const FLUXNUTYPE type, const size_t n, const double *e, double *fluence) const {
+  // dt = dilation x dt_base cancels the dilation in factor()
+  std::vector<double> ebase(n);
+  for(size_t i = 0; i < n; i++) ebase[i] = e[i] / m_escale;
+  m_base->GetFluenceSpectrum(baseTime(t1), baseTime(t2), type, n, ebase.data(), fluence);
+  const double f = m_norm / m_escale;
+  for(size_t i = 0; i < n; i++) fluence[i] *= f;
+}
+
+void SKSNSimFluxTransform::GetEnergyNodes(const double t, const FLUXNUTYPE type, std::vector<double> &nodes) const {
+  m_base->GetEnergyNodes(baseTime(t), type, nodes);
+  for(double &e : nodes) e *= m_escale;
+}
+
+void SKSNSimFluxTransform::FillEnvelope(const FLUXNUTYPE type, SKSNSimFluxEnvelope &env) const {
+  // equal slices are mapped to equal slices of the base energy range
+  const size_t nslice = env.GetNSlices();
+  SKSNSimFluxEnvelope base(env.GetSliceEdge(0) / m_escale, env.GetSliceEdge(nslice) / m_escale, nslice, baseTime(GetTimeLimitMin()));
+  m_base->FillEnvelope(type, base);
+  const double f = factor();
+  for(size_t s = 0; s < nslice; s++) env.FillSlice(s, m_shift + m_dilation * base.GetSliceMaxFluxTime(s), f * base.GetSliceMaxFlux(s));
 }
 
 void SKSNSimDSNBFluxMonthlyCustom::AddMonthlyFlux( const int elapsday, std::unique_ptr<SKSNSimDSNBFluxCustom> flux_ptr) {
-  custommonthlyflux.push_back( std::make_pair( elapsday, std::move(flux_ptr) ));
-  sortByTime();
+  // kept sorted by inserting after the elements of the same or earlier begin-day; the index is rebuilt at the next lookup
+  auto pos = std::upper_bound( custommonthlyflux.begin(), custommonthlyflux.end(), elapsday,
+      [](const int d, const std::pair<int, std::unique_ptr<SKSNSimDSNBFluxCustom>> &a) { return d < a.first; });
+  custommonthlyflux.insert( pos, std::make_pair( elapsday, std::move(flux_ptr) ));
+  dayindexValid = false;
+  invalidateEnvelope();
 }
 
-void SKSNSimDSNBFluxMonthlyCustom::sortByTime() {
-  std::sort( custommonthlyflux.begin(), custommonthlyflux.end(),
-      [](std::pair<int, std::unique_ptr<SKSNSimDSNBFluxCustom>> &a,
-        std::pair<int, std::unique_ptr<SKSNSimDSNBFluxCustom>> &b) { return a.first < b.first;});
+void SKSNSimDSNBFluxMonthlyCustom::FillEnvelope(const FLUXNUTYPE /* type */, SKSNSimFluxEnvelope &env) const {
+  for(auto it = custommonthlyflux.begin(); it != custommonthlyflux.end(); it++) it->second->FillEnvelopeAt(it->first, env);
 }
 
-SKSNSimDSNBFluxCustom &SKSNSimDSNBFluxMonthlyCustom::findFluxByTime(const int elapsed_day) const {
-  for(auto it = custommonthlyflux.begin(); it != custommonthlyflux.end(); it++){
-    if ( elapsed_day < it->first ) continue;
-    else {
-      if( it + 1 == custommonthlyflux.end() || elapsed_day < (it+1)->first)
-        return *(it->second);
-    }
+void SKSNSimDSNBFluxMonthlyCustom::buildIndex() const {
+  dayindex.clear();
+  dayindexValid = true;
+  if( custommonthlyflux.empty() ) return;
+
+  // day -> element: element n covers [begin_n, begin_{n+1})
+  const int day_begin = custommonthlyflux.front().first;
+  const int day_end   = custommonthlyflux.back().first;
+  dayindex.resize( day_end - day_begin + 1, custommonthlyflux.size() - 1 );
+  for(size_t n = 0; n + 1 < custommonthlyflux.size(); n++){
+    for(int d = custommonthlyflux[n].first; d < custommonthlyflux[n+1].first; d++)
+      dayindex[d - day_begin] = n;
   }
-  throw std::out_of_range("elapsed_day is out of range");
+}
+
+SKSNSimDSNBFluxCustom &SKSNSimDSNBFluxMonthlyCustom::findFluxByTime(const int elapsed_day) const {
+  const int i = findIndexByTime(elapsed_day);
+  if( i < 0 ) throw std::out_of_range("elapsed_day is out of range");
+  return *(custommonthlyflux[i].second);
 }
 
 double SKSNSimDSNBFluxMonthlyCustom::GetFlux(const double e, const double elapsed_day, const FLUXNUTYPE type) const {
-  try {
-    return findFluxByTime(elapsed_day).GetFlux(e,0,type);
-  } catch (const std::exception& e){
-    return -1.0;
-  }
+  const SKSNSimDSNBFluxCustom *f = findFluxPtrByTime(elapsed_day);
+  if( f == nullptr ) return -1.0;
+  return f->GetFlux(e,0,type);
 }
 
-double SKSNSimDSNBFluxMonthlyCustom::FindMaxFluxTime() const {
-  std::vector<std::pair<int, double>> calculated_integrated_flux;
-  for(auto it = custommonthlyflux.begin(); it != custommonthlyflux.end(); it ++)
-    calculated_integrated_flux.push_back(std::make_pair( it->first, it->second->CalcIntegratedFlux()));
-  std::sort ( calculated_integrated_flux.begin(), calculated_integrated_flux.end(), 
-      [](std::pair<int,double> &a, std::pair<int,double>&b){ return a.second < b.second ; });
-  return calculated_integrated_flux.back().first;
+void SKSNSimDSNBFluxMonthlyCustom::GetFluxSpectrum(const double elapsed_day, const FLUXNUTYPE type, const size_t n, const double *e, double *flux) const {
+  const SKSNSimDSNBFluxCustom *f = findFluxPtrByTime(elapsed_day);
+  if( f == nullptr ){
+    std::fill(flux, flux + n, -1.0);
+    return;
+  }
+  f->GetFluxSpectrum(0, type, n, e, flux);
 }
 
+void SKSNSimDSNBFluxMonthlyCustom::GetEnergyNodes(const double elapsed_day, const FLUXNUTYPE type, std::vector<double> &nodes) const {
+  const SKSNSimDSNBFluxCustom *f = findFluxPtrByTime(elapsed_day);
+  if( f == nullptr ) nodes.clear();
+  else f->GetEnergyNodes(0, type, nodes);
+}
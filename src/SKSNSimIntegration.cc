@@ -0,0 +1,139 @@
+/**************************************
+ * File: SKSNSimIntegration.cc
+ *************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include "SKSNSimIntegration.hh"
+#include "SKSNSimConstant.hh"
+
+namespace SKSNSimIntegration {
+  const GAUSSLEGENDRE &GetGaussLegendre(const size_t n){
+    static std::map<size_t, GAUSSLEGENDRE> table;
+    auto it = table.find(n);
+    if( it != table.end() ) return it->second;
+
+    if( n == 0 ){
+      std::cerr << "GetGaussLegendre: order should be positive" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+
+    // roots of Legendre polynomial P_n by Newton's method
+    GAUSSLEGENDRE gl;
+    gl.x.resize(n);
+    gl.w.resize(n);
+    for(size_t i = 0; i < (n + 1) / 2; i++){
+      double x = std::cos( M_PI * ( (double)i + 0.75 ) / ( (double)n + 0.5 ) );
+      double dp = 0.;
+      for(int iter = 0; iter < 100; iter++){
+        double p0 = 1.0, p1 = 0.0;
+        for(size_t j = 1; j <= n; j++){
+          const double p2 = p1;
+          p1 = p0;
+          p0 = ( (2.0 * j - 1.0) * x * p1 - (j - 1.0) * p2 ) / (double)j;
+        }
+        dp = (double)n * ( x * p0 - p1 ) / ( x * x - 1.0 );
+        const double dx = p0 / dp;
+        x -= dx;
+        if( std::fabs(dx) < 1.e-15 ) break;
+      }
+      gl.x[i] = -x;
+      gl.x[n - 1 - i] = x;
+      gl.w[i] = gl.w[n - 1 - i] = 2.0 / ( ( 1.0 - x * x ) * dp * dp );
+    }
+    return table.emplace(n, gl).first->second;
+  }
+}
+
+SKSNSimFluxXSecIntegrator::SKSNSimFluxXSecIntegrator(const size_t order, const size_t nintervals_min, const double width_max):
+  m_order(order),
+  m_nintervals_min(nintervals_min),
+  m_interval_width_max(width_max)
+{
+  if( m_order < 3 ){
+    std::cerr << "SKSNSimFluxXSecIntegrator: order should be >= 3 for error estimation (" << m_order << ")" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if( m_nintervals_min == 0 ) m_nintervals_min = 1;
+}
+
+std::vector<double> SKSNSimFluxXSecIntegrator::makeEdges(const SKSNSimFluxModel &flux, const double emin, const double emax,
+    const double time, const SKSNSimFluxModel::FLUXNUTYPE type) const {
+  // nodes of the flux in (emin, emax) are the edges of the bins, each of which is divided into equal intervals
+  std::vector<double> nodes;
+  flux.GetEnergyNodes(time, type, nodes);
+  std::vector<double> knots(1, emin);
+  for(const double e : nodes) if( e > knots.back() && e < emax ) knots.push_back(e);
+  knots.push_back(emax);
+
+  const double width = std::min( m_interval_width_max, (emax - emin) / (double)m_nintervals_min );
+  std::vector<double> edges(1, emin);
+  for(size_t b = 0; b + 1 < knots.size(); b++){
+    const double lo = knots[b], hi = knots[b+1];
+    const size_t n = std::max( (size_t)std::ceil( (hi - lo) / width ), (size_t)1 );
+    for(size_t i = 1; i < n; i++) edges.push_back( lo + (hi - lo) * (double)i / (double)n );
+    edges.push_back(hi);
+  }
+  return edges;
+}
+
+const std::vector<double> &SKSNSimFluxXSecIntegrator::getXSecTable(const SKSNSimCrosssectionModel &xsec, const std::vector<double> &edges){
+  XSECKEY key = std::make_pair(&xsec, edges);
+  auto it = xsectable.find(key);
+  if( it != xsectable.end() ) return it->second;
+
+  const auto &glh = SKSNSimIntegration::GetGaussLegendre(m_order);
+  const auto &gll = SKSNSimIntegration::GetGaussLegendre(m_order - 2);
+  std::vector<double> table;
+  table.reserve( (edges.size() - 1) * (glh.x.size() + gll.x.size()) );
+  for(size_t i = 0; i + 1 < edges.size(); i++){
+    const double center = 0.5 * ( edges[i] + edges[i+1] ), half = 0.5 * ( edges[i+1] - edges[i] );
+    for(size_t k = 0; k < glh.x.size(); k++) table.push_back( xsec.GetCrosssection( center + half * glh.x[k] ) );
+    for(size_t k = 0; k < gll.x.size(); k++) table.push_back( xsec.GetCrosssection( center + half * gll.x[k] ) );
+  }
+  return xsectable.emplace(std::move(key), std::move(table)).first->second;
+}
+
+SKSNSimFluxXSecIntegrator::RESULT SKSNSimFluxXSecIntegrator::Integrate(const SKSNSimFluxModel &flux, const SKSNSimCrosssectionModel &xsec,
+    const double emin, const double emax, const double time, const SKSNSimFluxModel::FLUXNUTYPE type){
+  if( emax <= emin ) return std::make_pair(0., 0.);
+
+  const RESULTKEY key = std::make_tuple(&flux, &xsec, time, (int)type, emin, emax);
+  auto it = resultcache.find(key);
+  if( it != resultcache.end() ) return it->second;
+
+  const std::vector<double> edges = makeEdges(flux, emin, emax, time, type);
+  const size_t n = edges.size() - 1;
+  const std::vector<double> &xsecnodes = getXSecTable(xsec, edges);
+  const auto &glh = SKSNSimIntegration::GetGaussLegendre(m_order);
+  const auto &gll = SKSNSimIntegration::GetGaussLegendre(m_order - 2);
+
+  // flux on all nodes at once, in the same order as xsecnodes
+  std::vector<double> enodes, fluxnodes(xsecnodes.size());
+  enodes.reserve( xsecnodes.size() );
+  for(size_t i = 0; i < n; i++){
+    const double center = 0.5 * ( edges[i] + edges[i+1] ), half = 0.5 * ( edges[i+1] - edges[i] );
+    for(size_t k = 0; k < glh.x.size(); k++) enodes.push_back( center + half * glh.x[k] );
+    for(size_t k = 0; k < gll.x.size(); k++) enodes.push_back( center + half * gll.x[k] );
+  }
+  flux.GetFluxSpectrum(time, type, enodes.size(), enodes.data(), fluxnodes.data());
+  // negative flux is an error code of flux models (e.g. out of range), handled as zero
+  for(double &f : fluxnodes) if( !( f > 0. ) ) f = 0.;
+
+  double sum = 0., err = 0.;
+  size_t inode = 0;
+  for(size_t i = 0; i < n; i++){
+    const double half = 0.5 * ( edges[i+1] - edges[i] );
+    double sh = 0., sl = 0.;
+    for(size_t k = 0; k < glh.x.size(); k++, inode++) sh += glh.w[k] * fluxnodes[inode] * xsecnodes[inode];
+    for(size_t k = 0; k < gll.x.size(); k++, inode++) sl += gll.w[k] * fluxnodes[inode] * xsecnodes[inode];
+    sum += half * sh;
+    err += half * std::fabs( sh - sl );
+  }
+
+  const RESULT result = std::make_pair(sum, err);
+  resultcache.emplace(key, result);
+  return result;
+}
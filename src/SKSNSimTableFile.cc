@@ -0,0 +1,305 @@
+/**************************************
+ * File: SKSNSimTableFile.cc
+ *************************************/
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "SKSNSimTableFile.hh"
+#include "SKSNSimConstant.hh"
+
+namespace {
+  constexpr char TABLEFILEMAGIC[8] = "SKSNTBL";
+  size_t alignUp(const size_t n, const size_t a) { return ( n + a - 1 ) / a * a; }
+  std::string makeTempFile(const std::string &fname){
+    // unique in the same directory, so that jobs writing the same file at once do not share the temporary file
+    std::vector<char> name(fname.begin(), fname.end());
+    const char suffix[] = ".tmpXXXXXX";
+    name.insert(name.end(), suffix, suffix + sizeof(suffix));
+    const int fd = mkstemp(name.data());
+    if( fd < 0 ) return std::string();
+    const mode_t mask = umask(0);
+    umask(mask);
+    fchmod(fd, 0666 & ~mask); // mkstemp makes it private
+    ::close(fd);
+    return std::string(name.data());
+  }
+}
+
+SKSNSimTableFile::SKSNSimTableFile(): m_addr(nullptr), m_length(0), m_nmapped(0) {}
+
+const SKSNSimTableFile &SKSNSimTableFile::GetInstance(){
+  static SKSNSimTableFile instance;
+  static bool initialized = false;
+  if( !initialized ){
+    initialized = true;
+    if( !enabled() ) return instance;
+    size_t nbaked = 0;
+    for(const auto &b : baked()){
+      for(size_t i = 0; i < b.second; i++) instance.m_entries[b.first[i].name] = ENTRYREF{ b.first[i].data, b.first[i].size, 0, 1 };
+      nbaked += b.second;
+    }
+    if( nbaked > 0 ) std::cout << "[SKSNSimTableFile] " << nbaked << " tables are compiled into the library" << std::endl;
+    const std::string fname = GetDefaultFileName();
+    if( !fname.empty() && instance.open(fname, " (please run main_tablecompile again)") )
+      std::cout << "[SKSNSimTableFile] precompiled tables are mapped from " << fname << " ( " << instance.m_nmapped << " tables )" << std::endl;
+    if( !fname.empty() && ( nbaked > 0 || instance.IsOpen() ) ) instance.checkSources( fname.substr(0, fname.find_last_of('/') + 1) );
+  }
+  return instance;
+}
+
+std::shared_ptr<const SKSNSimTableFile> SKSNSimTableFile::Open(const std::string &fname){
+  std::shared_ptr<SKSNSimTableFile> f(new SKSNSimTableFile());
+  if( !f->open(fname, "") ) return nullptr;
+  return f;
+}
+
+bool SKSNSimTableFile::RegisterBakedTables(const BAKEDENTRY *entries, const size_t n){
+  baked().emplace_back(entries, n);
+  return true;
+}
+
+std::string SKSNSimTableFile::GetDefaultFileName(){
+  const char * env_p = std::getenv(INSTALLDIRVARIABLENAME);
+  if( env_p == nullptr ) return std::string();
+  return std::string(env_p) + "/table/sksnsim_tables.bin";
+}
+
+uint64_t SKSNSimTableFile::CalcChecksum(const unsigned char *p, const size_t n){
+  uint64_t h = 14695981039346656037ULL;
+  for(size_t i = 0; i < n; i++){
+    h ^= (uint64_t)p[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+bool SKSNSimTableFile::open(const std::string &fname, const std::string &hint){
+  // Missing file is not an error: original tables are used instead
+  const int fd = ::open(fname.c_str(), O_RDONLY);
+  if( fd < 0 ) return false;
+  struct stat st;
+  if( fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TABLEFILEHEADER) ){
+    ::close(fd);
+    std::cout << "[SKSNSimTableFile] " << fname << " is too short, ignored" << std::endl;
+    return false;
+  }
+  const size_t length = (size_t)st.st_size;
+  void *addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if( addr == MAP_FAILED ){
+    std::cout << "[SKSNSimTableFile] failed to map " << fname << ", ignored" << std::endl;
+    return false;
+  }
+
+  const unsigned char *top = static_cast<const unsigned char *>(addr);
+  const TABLEFILEHEADER *h = reinterpret_cast<const TABLEFILEHEADER *>(top);
+  std::string err;
+  if( std::memcmp(h->magic, TABLEFILEMAGIC, sizeof(TABLEFILEMAGIC)) != 0 ) err = "not a table file";
+  else if( h->version != VERSION ) err = "version mismatch ( " + std::to_string(h->version) + " != " + std::to_string(VERSION) + " )";
+  else if( h->filesize != length ) err = "truncated";
+  else if( sizeof(TABLEFILEHEADER) + (size_t)h->nentries * sizeof(TABLEFILEENTRY) > length ) err = "broken entry list";
+  else if( CalcChecksum(top + sizeof(TABLEFILEHEADER), (size_t)h->nentries * sizeof(TABLEFILEENTRY)) != h->checksum ) err = "checksum mismatch";
+
+  // data of each entry are verified at its first Get()
+  std::map<std::string, ENTRYREF> entries;
+  if( err.empty() ){
+    const TABLEFILEENTRY *e = reinterpret_cast<const TABLEFILEENTRY *>(top + sizeof(TABLEFILEHEADER));
+    for(uint32_t i = 0; i < h->nentries; i++){
+      if( e[i].name[NAMELENGTH - 1] != '\0' || e[i].offset % ALIGNMENT != 0 || e[i].offset + e[i].size * sizeof(double) > length ){
+        err = "broken entry";
+        break;
+      }
+      entries[e[i].name] = ENTRYREF{ reinterpret_cast<const double *>(top + e[i].offset), (size_t)e[i].size, e[i].checksum, 0 };
+    }
+  }
+  if( !err.empty() ){
+    munmap(addr, length);
+    std::cout << "[SKSNSimTableFile] " << fname << ": " << err << ", ignored" << hint << std::endl;
+    return false;
+  }
+
+  m_addr = addr;
+  m_length = length;
+  m_fname = fname;
+  m_nmapped = entries.size();
+  for(const auto &e : entries) m_entries[e.first] = e.second;
+  return true;
+}
+
+void SKSNSimTableFile::close(){
+  if( m_addr != nullptr ) munmap(m_addr, m_length);
+  m_addr = nullptr;
+  m_length = 0;
+  m_nmapped = 0;
+  m_entries.clear();
+}
+
+bool SKSNSimTableFile::Get(const std::string &name, SKSNSimTableView &view) const {
+  auto it = m_entries.find(name);
+  if( it == m_entries.end() ) return false;
+  const ENTRYREF &e = it->second;
+  if( e.verified == 0 ){
+    e.verified = ( CalcChecksum(reinterpret_cast<const unsigned char *>(e.data), e.size * sizeof(double)) == e.checksum ? 1 : -1 );
+    if( e.verified < 0 ) std::cout << "[SKSNSimTableFile] " << m_fname << ": checksum mismatch of " << name << ", ignored" << std::endl;
+  }
+  if( e.verified < 0 ) return false;
+  view.Map(e.data, e.size);
+  return true;
+}
+
+void SKSNSimTableFile::checkSources(const std::string &dir) const {
+  // warning only: the tables are still used
+  const std::string prefix(SOURCEPREFIX);
+  for(auto it = m_entries.lower_bound(prefix); it != m_entries.end() && it->first.compare(0, prefix.size(), prefix) == 0; it++){
+    const std::string fname = dir + it->first.substr(prefix.size());
+    SKSNSimTableView def;
+    struct stat st;
+    if( !Get(it->first, def) || def.size() != 3 ) continue;
+    if( stat(fname.c_str(), &st) != 0 ) continue; // original tables need not be installed
+    if( def[0] != (double)st.st_size || def[1] != (double)st.st_mtim.tv_sec || def[2] != (double)st.st_mtim.tv_nsec )
+      std::cout << "[SKSNSimTableFile] WARNING: original table " << fname << " is modified after main_tablecompile (please run it again)" << std::endl;
+  }
+}
+
+SKSNSimFileLock::SKSNSimFileLock(const std::string &fname): m_fd(-1) {
+  if( fname.empty() ) return;
+  m_fd = ::open(fname.c_str(), O_RDWR | O_CREAT, 0666);
+  if( m_fd < 0 ) return;
+  if( flock(m_fd, LOCK_EX) != 0 ){
+    ::close(m_fd);
+    m_fd = -1;
+  }
+}
+
+SKSNSimFileLock::~SKSNSimFileLock(){
+  // the lock file is kept: removing it could let another job lock a new file while a third one holds the old one
+  if( m_fd < 0 ) return;
+  flock(m_fd, LOCK_UN);
+  ::close(m_fd);
+}
+
+void SKSNSimTableFileWriter::Add(const std::string &name, const double *data, const size_t n){
+  if( name.size() >= SKSNSimTableFile::NAMELENGTH ){
+    std::cerr << "SKSNSimTableFileWriter: too long table name " << name << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  m_entries.emplace_back(name, std::vector<double>(data, data + n));
+}
+
+bool SKSNSimTableFileWriter::AddSource(const std::string &fname){
+  const std::string name = SKSNSimTableFile::SOURCEPREFIX + fname.substr(fname.find_last_of('/') + 1);
+  struct stat st;
+  if( name.size() >= SKSNSimTableFile::NAMELENGTH || stat(fname.c_str(), &st) != 0 ) return false;
+  Add(name, std::vector<double>{ (double)st.st_size, (double)st.st_mtim.tv_sec, (double)st.st_mtim.tv_nsec });
+  return true;
+}
+
+bool SKSNSimTableFileWriter::Write(const std::string &fname) const {
+  typedef SKSNSimTableFile::TABLEFILEHEADER HEADER;
+  typedef SKSNSimTableFile::TABLEFILEENTRY ENTRY;
+  constexpr size_t ALIGNMENT = SKSNSimTableFile::ALIGNMENT;
+
+  // whole image is made in memory, and written at once
+  std::vector<ENTRY> entries(m_entries.size());
+  size_t offset = alignUp(sizeof(HEADER) + entries.size() * sizeof(ENTRY), ALIGNMENT);
+  for(size_t i = 0; i < m_entries.size(); i++){
+    std::memset(&entries[i], 0, sizeof(ENTRY));
+    std::strncpy(entries[i].name, m_entries[i].first.c_str(), SKSNSimTableFile::NAMELENGTH - 1);
+    entries[i].offset = offset;
+    entries[i].size = m_entries[i].second.size();
+    entries[i].checksum = SKSNSimTableFile::CalcChecksum(reinterpret_cast<const unsigned char *>(m_entries[i].second.data()), m_entries[i].second.size() * sizeof(double));
+    offset = alignUp(offset + m_entries[i].second.size() * sizeof(double), ALIGNMENT);
+  }
+  std::vector<unsigned char> image(offset, 0);
+  std::memcpy(image.data() + sizeof(HEADER), entries.data(), entries.size() * sizeof(ENTRY));
+  for(size_t i = 0; i < m_entries.size(); i++)
+    std::memcpy(image.data() + entries[i].offset, m_entries[i].second.data(), m_entries[i].second.size() * sizeof(double));
+
+  HEADER h;
+  std::memset(&h, 0, sizeof(h));
+  std::memcpy(h.magic, TABLEFILEMAGIC, sizeof(TABLEFILEMAGIC));
+  h.version = SKSNSimTableFile::VERSION;
+  h.nentries = (uint32_t)entries.size();
+  h.filesize = image.size();
+  h.checksum = SKSNSimTableFile::CalcChecksum(image.data() + sizeof(HEADER), entries.size() * sizeof(ENTRY));
+  std::memcpy(image.data(), &h, sizeof(h));
+
+  // written to temporary file and renamed, not to break the file mapped by running jobs
+  const std::string tmpname = makeTempFile(fname);
+  std::ofstream ofs;
+  if( !tmpname.empty() ) ofs.open(tmpname, std::ios::binary | std::ios::trunc);
+  if( !ofs.is_open() ){
+    std::cerr << "SKSNSimTableFileWriter: cannot make a temporary file for " << fname << std::endl;
+    if( !tmpname.empty() ) std::remove(tmpname.c_str());
+    return false;
+  }
+  ofs.write(reinterpret_cast<const char *>(image.data()), image.size());
+  ofs.close();
+  if( !ofs || std::rename(tmpname.c_str(), fname.c_str()) != 0 ){
+    std::cerr << "SKSNSimTableFileWriter: failed to write " << fname << std::endl;
+    std::remove(tmpname.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool SKSNSimTableFileWriter::WriteSource(const std::string &fname) const {
+  // hexadecimal floating literals keep every bit of the values
+  const std::string tmpname = makeTempFile(fname);
+  std::ofstream ofs;
+  if( !tmpname.empty() ) ofs.open(tmpname, std::ios::trunc);
+  if( !ofs.is_open() ){
+    std::cerr << "SKSNSimTableFileWriter: cannot make a temporary file for " << fname << std::endl;
+    if( !tmpname.empty() ) std::remove(tmpname.c_str());
+    return false;
+  }
+  ofs << "// Generated by main_tablecompile --source: do not edit\n"
+      << "#include <limits>\n"
+      << "#include \"SKSNSimTableFile.hh\"\n\n"
+      << "namespace {\n";
+  char buf[64];
+  for(size_t i = 0; i < m_entries.size(); i++){
+    const std::vector<double> &v = m_entries[i].second;
+    if( v.empty() ) continue;
+    ofs << "  // " << m_entries[i].first << "\n"
+        << "  alignas(" << SKSNSimTableFile::ALIGNMENT << ") constexpr double table" << i << "[" << v.size() << "] = {";
+    for(size_t j = 0; j < v.size(); j++){
+      ofs << ( j % 8 == 0 ? "\n    " : " " );
+      if( std::isnan(v[j]) ) ofs << "std::numeric_limits<double>::quiet_NaN()";
+      else if( std::isinf(v[j]) ) ofs << ( v[j] < 0. ? "-" : "" ) << "std::numeric_limits<double>::infinity()";
+      else {
+        std::snprintf(buf, sizeof(buf), "%a", v[j]);
+        ofs << buf;
+      }
+      if( j + 1 < v.size() ) ofs << ",";
+    }
+    ofs << "\n  };\n";
+  }
+  ofs << "  constexpr SKSNSimTableFile::BAKEDENTRY entries[] = {\n";
+  for(size_t i = 0; i < m_entries.size(); i++){
+    ofs << "    { \"" << m_entries[i].first << "\", ";
+    if( m_entries[i].second.empty() ) ofs << "nullptr";
+    else ofs << "table" << i;
+    ofs << ", " << m_entries[i].second.size() << " },\n";
+  }
+  if( m_entries.empty() ) ofs << "    { \"\", nullptr, 0 },\n";
+  ofs << "  };\n"
+      << "  const bool registered = SKSNSimTableFile::RegisterBakedTables(entries, " << m_entries.size() << ");\n"
+      << "}\n";
+  ofs.close();
+  if( !ofs || std::rename(tmpname.c_str(), fname.c_str()) != 0 ){
+    std::cerr << "SKSNSimTableFileWriter: failed to write " << fname << std::endl;
+    std::remove(tmpname.c_str());
+    return false;
+  }
+  return true;
+}
@@ -47,6 +47,48 @@ namespace SKSNSimTools {
   }
 }
 
+void SKSNSimAliasTable::Build(const std::vector<double> &w){
+  const size_t n = w.size();
+  m_prob.assign(n, 1.0);
+  m_alias.resize(n);
+  for(size_t i = 0; i < n; i++) m_alias[i] = i;
+  double sum = 0.;
+  for(auto it = w.begin(); it != w.end(); it++) sum += (*it > 0. ? *it : 0.);
+  if( n == 0 || sum <= 0. ) return;
+
+  // scaled probabilities: mean is 1.0
+  std::vector<double> scaled(n);
+  std::vector<size_t> small, large;
+  for(size_t i = 0; i < n; i++){
+    scaled[i] = (w[i] > 0. ? w[i] : 0.) * (double)n / sum;
+    if( scaled[i] < 1.0 ) small.push_back(i);
+    else large.push_back(i);
+  }
+  while( !small.empty() && !large.empty() ){
+    const size_t s = small.back(); small.pop_back();
+    const size_t l = large.back();
+    m_prob[s] = scaled[s];
+    m_alias[s] = l;
+    scaled[l] -= 1.0 - scaled[s];
+    if( scaled[l] < 1.0 ){
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+  // remaining entries are 1.0 within rounding error
+  for(auto it = small.begin(); it != small.end(); it++) m_prob[*it] = 1.0;
+  for(auto it = large.begin(); it != large.end(); it++) m_prob[*it] = 1.0;
+}
+
+size_t SKSNSimAliasTable::Sample(TRandom &rng) const {
+  const size_t n = m_prob.size();
+  if( n <= 1 ) return 0;
+  const double u = rng.Uniform( (double)n );
+  size_t i = (size_t)u;
+  if( i >= n ) i = n - 1;
+  return ( u - (double)i < m_prob[i] ? i : m_alias[i] );
+}
+
 namespace SKSNSimLiveTime {
   const static std::map<SKSNSIMENUM::SKPERIOD, std::string> FNAMEMAP = {
     { SKSNSIMENUM::SKPERIOD::SKV, "/home/sklowe/realtime_sk5_rep/solar_oct19/livetime/livetime5.r080539.r082086.txt" },
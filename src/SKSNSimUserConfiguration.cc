@@ -5,6 +5,7 @@
 #include <iostream>
 #include <getopt.h>
 #include <cstdlib>
+#include <algorithm>
 #include "SKSNSimUserConfiguration.hh"
 
 bool SKSNSimUserConfiguration::CheckFluxEnergyMin() const {
@@ -87,6 +88,7 @@ bool SKSNSimUserConfiguration::CheckRuntimeFactor() const {
 void SKSNSimUserConfiguration::ShowHelpDSNB(const char *argv0){
   std::cout << argv0
     << " [-c,--customflux {flux_filename}]"
+    << " [--addflux {flux_filename[:norm]}]"
     << " [--outputformat {\"skroot\" or \"nuance\"}]"
     << " [--energy_min {energy_MeV}]"
     << " [--energy_max {energy_MeV}]"
@@ -101,6 +103,7 @@ void SKSNSimUserConfiguration::ShowHelpDSNB(const char *argv0){
     << " [--outprefix {pref}]"
     << " [--outname_template {template.RUNNUM.root}]"
     << " [--flatposflux]"
+    << " [--xsecweights {list}]"
     << " [-h,--help]"
     << " [-s,--seed {unsigned}]"
     << " [outputdirectory]"
@@ -109,9 +112,13 @@ void SKSNSimUserConfiguration::ShowHelpDSNB(const char *argv0){
   std::cout << "Note: {} is essencial arguments, and [] is optional arguments" << std::endl << std::endl;
   std::cout << "Arguments: "  << std::endl
     << " -c,--customflux {flux_filename}: this option enforce to use specified flux file which should be formatted with \"energy(MeV) flux\" ( default = " << SKSNSimUserConfiguration::GetDefaultDSNBFluxModel() << " )" << std::endl
+    << " --addflux {flux_filename[:norm]}: add a flux component (same format as --customflux) with normalization factor (default norm = 1.0). Can be specified several times. " << std::endl
+    << "                                  Events are sampled from the mixture of all components, and the component index (0 = --customflux) is stored in \"fluxcomponent\" of weightTr" << std::endl
     << " --energy_min {energy_MeV}: lower energy limit to be generated in MeV ( default = " << SKSNSimUserConfiguration::GetDefaultFluxEnergyMin(SKSNSimUserConfiguration::MODEGENERATOR::kDSNB) << " MeV )" << std::endl
     << " --energy_max {energy_MeV}: uppwer energy limit to be generated in MeV ( default = " << SKSNSimUserConfiguration::GetDefaultFluxEnergyMax(SKSNSimUserConfiguration::MODEGENERATOR::kDSNB) << " MeV )" << std::endl
     << " --flatposflux: generate flat positron energy in range between --energy_min and --energy_max. " <<  std::endl
+    << " --xsecweights {list}: comma-separated cross-section variations stored as extra weights \"weight_<name>\" in weightTr (ratio to the nominal cross section), and expected number of events is shown for each. " << std::endl
+    << "                      ibd, ibd_vud, ibd_axial: +-1 sigma of IBD cross section (total, Vud and axial coupling, axial radii) by Ricciardi-Vignaroli-Vissani / {reaction}:{factor}: scale of reaction (ibd, elastic, oxygen_cc, oxygen_sub, oxygen_nc or all)" << std::endl
     << " --runtimefactor {float}: number of events per day for runtime normalization ( default = " << SKSNSimUserConfiguration::GetDefaultRuntimeNormFactor() << " evt/day )" << std::endl
     << " -n,--nevents {int}: number of events to be generated (exclusive with --runtime and --runtimefactor) ( default = " << SKSNSimUserConfiguration::GetDefaultNumEvents() << " )" << std::endl
     << " -o,--outdir {directory}: output directory. The generator fill events in the filename: {outdir}/{outprefix}_000000.root... ( default = " << SKSNSimUserConfiguration::GetDefaultOutputDirectory() << " )"  << std::endl
@@ -138,6 +145,8 @@ void SKSNSimUserConfiguration::ShowHelpSN(const char *argv0){
     << " [-o,--outdir outputdirectory]"
     << " [--outputformat {\"skroot\" or \"nuance\"}]"
     << " [-m,--snmodel model_name]"
+    << " [--snparam parameters]"
+    << " [--snmodel_window nsteps]"
     << " [--nuosc 0(NONE)/1(NORMAL)/2(INVERTED)]"
     << " [-d,--distance distance_in_kpc]"
     << " [-g,--fillevent {0(no: just calculate expected num of evt)/1(yes: fill kinematics for detector sim.)}]"
@@ -151,7 +160,11 @@ void SKSNSimUserConfiguration::ShowHelpSN(const char *argv0){
     << " [--time_min time]"
     << " [--time_max time]"
     << " [--time_nbins nbins]"
+    << " [--time_windows list]"
     << " [--outprefix prefix]"
+    << " [--elastic_ethr energy_MeV]"
+    << " [--reactions list]"
+    << " [--xsecweights list]"
     << " {outputdirectory}"
     << std::endl
     << std::endl;
@@ -169,6 +182,9 @@ void SKSNSimUserConfiguration::ShowHelpSN(const char *argv0){
     << " -h,--help: show this help" << std::endl
     << " -o,--outdir {outputdirectory}: output directory (default = " << SKSNSimUserConfiguration::GetDefaultOutputDirectory() << " )" << std::endl
     << " -m,--snmodel {model_name}: name of SN flux model (default = " << SKSNSimUserConfiguration::GetDefaultSNModelName() << " ) " << std::endl
+    << " --snparam {parameters}: analytic pinched Fermi-Dirac flux instead of --snmodel: \"{nue|nueb|nux|all}:{E|alpha|L}={function}[,...]\" with mean energy E (MeV), pinching alpha and luminosity L (erg/s)." << std::endl
+    << "                    {function} is a constant or \"{value}@{time}/{value}@{time}/...\" (linear in time, constant outside). Repeatable, later ones override (default = E 12/15/18 MeV for nue/nueb/nux, alpha 3, L 5e51 erg/s, constant in time)" << std::endl
+    << " --snmodel_window {nsteps}: read the model file on demand, keeping only {nsteps} time steps in memory, for models too large to be loaded at once (default = 0: whole model is loaded)" << std::endl
     << " --nuosc {int}: neutrino oscillation model: 0=NONE / 1=NORMAL / 2=INVERTED ( default = " << (int)SKSNSimUserConfiguration::GetDefaultNeutrinoOscType() << " )" << std::endl
     << " -d,--distance {distance_in_kpc}: distance from SN in unit of kpc ( default = " << SKSNSimUserConfiguration::GetDefaultSNDistanceKPC() << " kpc)" << std::endl
     << " -g,--fillevent [int]: if generate event kinematics for detector simulator: 0 = \"NO(just calculate expected num of evt) / 1 = YES (fill kinematics for detector sim.) (default = " << SKSNSimUserConfiguration::GetDefaultVectorGeneration() << " ). If you just specify \"-g\", turned ON" << std::endl
@@ -182,8 +198,13 @@ void SKSNSimUserConfiguration::ShowHelpSN(const char *argv0){
     << " --time_min {time_sec}: time lower limit in second (default = " << SKSNSimUserConfiguration::GetDefaultFluxTimeMin() << " sec )" << std::endl
     << " --time_max {time_sec}: time upper limit in second (default = " << SKSNSimUserConfiguration::GetDefaultFluxTimeMax() << " sec )" << std::endl
     << " --time_nbins {nbins}: number of bins for time (default = " << SKSNSimUserConfiguration::GetDefaultTimeNBins() << " )" << std::endl
+    << " --time_windows {list}: time-integrated generation: comma-separated edges of time windows in second, or \"full\" for one window of [time_min, time_max]. Fluence over each window is used instead of --time_nbins, and event times are uniform in the window (default = none)" << std::endl
     << " --outputformat {\"skroot\" or \"nuance\"}: output format. (default = " << (GetDefaultOFileMode() == MODEOFILE::kSKROOT ? "skroot" : "nuance") << ")" << std::endl
     << " --outprefix {prefix}: prefix of output file name (default = " << SKSNSimUserConfiguration::GetDefaultOutputPrefix() << " )" << std::endl
+    << " --elastic_ethr {energy_MeV}: threshold of electron total energy for cross section of elastic scattering in MeV, used without -g (default = " << SKSNSimUserConfiguration::GetDefaultElasticEnergyThreshold() << " MeV )" << std::endl
+    << " --reactions {list}: comma-separated reactions to be simulated, from ibd, elastic, oxygen_cc, oxygen_sub and oxygen_nc, or \"all\". Cross-section tables of other reactions are not loaded (default = all)" << std::endl
+    << " --xsecweights {list}: comma-separated cross-section variations stored as extra weights \"weight_<name>\" in weightTr (ratio to the nominal cross section), and expected number of events is shown for each. " << std::endl
+    << "                      ibd, ibd_vud, ibd_axial: +-1 sigma of IBD cross section (total, Vud and axial coupling, axial radii) by Ricciardi-Vignaroli-Vissani / {reaction}:{factor}: scale of reaction (ibd, elastic, oxygen_cc, oxygen_sub, oxygen_nc or all)" << std::endl
     << std::endl;
   std::cout << "Arguments for old format"  << std::endl
     << " {model_name}: name of SN flux model" << std::endl
@@ -219,6 +240,8 @@ void SKSNSimUserConfiguration::LoadFromArgsDSNB(int argc, char *argv[]){
       {"flatposflux",         no_argument, 0,   0},
       {"outname_template", required_argument, 0,0}, // 15
       {"outputformat",  required_argument, 0,   0}, // 16
+      {"addflux",       required_argument, 0,   0}, // 17
+      {"xsecweights",   required_argument, 0,   0}, // 18
       {0,                               0, 0,   0}
     };
 
@@ -251,6 +274,8 @@ void SKSNSimUserConfiguration::LoadFromArgsDSNB(int argc, char *argv[]){
           case 14: SetDSNBFlatFlux(true); break;
           case 15: SetOutputNameTemplate(optarg); break;
           case 16: SetOFileMode( std::string(optarg) ); break;
+          case 17: AddDSNBFluxModel( std::string(optarg), true ); break;
+          case 18: AddXSecVariations( std::string(optarg), true ); break;
           default:
             ShowHelpDSNB(argv[0]);
             exit(EXIT_FAILURE);
@@ -294,6 +319,12 @@ void SKSNSimUserConfiguration::LoadFromArgsSN(int argc, char *argv[]){
       {"runnum",        required_argument, 0,   0},
       {"subrunnum",     required_argument, 0,   0},
       {"outputformat",  required_argument, 0,   0}, // 17
+      {"elastic_ethr",  required_argument, 0,   0}, // 18
+      {"reactions",     required_argument, 0,   0}, // 19
+      {"xsecweights",   required_argument, 0,   0}, // 20
+      {"time_windows",  required_argument, 0,   0}, // 21
+      {"snparam",       required_argument, 0,   0}, // 22
+      {"snmodel_window",required_argument, 0,   0}, // 23
       {0,                               0, 0,   0}
     };
 
@@ -328,6 +359,12 @@ void SKSNSimUserConfiguration::LoadFromArgsSN(int argc, char *argv[]){
           case 15: SetRunnum(std::atoi(optarg)); break;
           case 16: SetSubRunnum(std::atoi(optarg)); break;
           case 17: SetOFileMode( std::string(optarg) ); break;
+          case 18: SetElasticEnergyThreshold(std::atof(optarg)); break;
+          case 19: SetSNReactions( std::string(optarg), true ); break;
+          case 20: AddXSecVariations( std::string(optarg), true ); break;
+          case 21: SetTimeWindows( std::string(optarg), true ); break;
+          case 22: AddSNBurstFluxParameters( std::string(optarg), true ); break;
+          case 23: SetSNBurstStreamWindow( std::string(optarg), true ); break;
           default:
             ShowHelpSN(argv[0]);
             exit(EXIT_FAILURE);
@@ -379,6 +416,12 @@ void SKSNSimUserConfiguration::Dump() const {
   std::cout << "FluxTimeMin (sec) = " << GetFluxTimeMin() << std::endl;
   std::cout << "FluxTimeMax (sec) = " << GetFluxTimeMax() << std::endl;
   std::cout << "TimeNBins = " << GetTimeNBins() << std::endl;
+  if( GetTimeMode() == SKSNSIMENUM::SNTIMEMODE::kINTEGRATED ){
+    std::cout << "TimeWindows (sec) =";
+    if( m_time_windows.empty() ) std::cout << " " << GetFluxTimeMin() << " " << GetFluxTimeMax();
+    for(auto it = m_time_windows.begin(); it != m_time_windows.end(); it++) std::cout << " " << *it;
+    std::cout << std::endl;
+  }
   std::cout << "OutputDirecotry = " << GetOutputDirectory() << std::endl;
   std::cout << "OutputPrefix = " << GetOutputPrefix() << std::endl;
   std::cout << "OutputNameTemplate = " << GetOutputNameTemplate() << std::endl;
@@ -395,10 +438,19 @@ void SKSNSimUserConfiguration::Dump() const {
   std::cout << "Runnum = " << GetRunnum() << std::endl;
   std::cout << "SubRunnum = " << GetSubRunnum() << std::endl;
   std::cout << "SNDistance ( kpc ) = " << GetSNDistanceKpc() << std::endl;
-  std::cout << "SNBurstFluxModel = " << GetSNBurstFluxModel() << std::endl;
+  std::cout << "ElasticEnergyThreshold ( MeV ) = " << GetElasticEnergyThreshold() << std::endl;
+  std::cout << "SNReactions = " << GetSNReactionsString() << std::endl;
+  std::cout << "SNBurstFluxModel = " << ( GetSNBurstParametricFlux() ? "parametric" : GetSNBurstFluxModel() ) << std::endl;
+  for(auto it = m_snburst_fluxparameters.begin(); it != m_snburst_fluxparameters.end(); it++)
+    std::cout << "SNBurstFluxParameters = " << *it << std::endl;
+  std::cout << "SNBurstStreamWindow = " << GetSNBurstStreamWindow() << std::endl;
   std::cout << "DSNBFluxModel = " << GetDSNBFluxModel() << std::endl;
+  for(auto it = m_dsnb_addfluxmodels.begin(); it != m_dsnb_addfluxmodels.end(); it++)
+    std::cout << "DSNBAdditionalFluxModel = " << it->first << " (norm = " << it->second << ")" << std::endl;
   std::cout << "DSNBFlatFlux = " << GetDSNBFlatFlux() << std::endl;
   std::cout << "NuOscType = " << (int)GetNuOscType() << std::endl;
+  for(auto it = m_xsec_variations.begin(); it != m_xsec_variations.end(); it++)
+    std::cout << "XSecVariation = " << it->GetName() << std::endl;
   std::cout << "RandomSeed = " << GetRandomSeed() << std::endl;
   std::cout << "====> Fine?  " << CheckHealth() << std::endl;
 
@@ -411,9 +463,14 @@ void SKSNSimUserConfiguration::Apply( SKSNSimVectorSNGenerator &gen ) const {
   gen.SetTimeMin( GetFluxTimeMin() );
   gen.SetTimeMax( GetFluxTimeMax() );
   gen.SetTimeNBins( GetTimeNBins() );
+  gen.SetTimeMode( GetTimeMode() );
+  gen.SetTimeWindows( GetTimeWindows() );
   gen.SetFlagFillEvent( GetEventVectorGeneration() );
   gen.SetGeneratorVolume( GetEventgenVolume() );
   gen.SetSNDistanceKpc( GetSNDistanceKpc() );
+  gen.SetElasticEnergyThreshold( GetElasticEnergyThreshold() );
+  gen.SetReactions( GetSNReactions() );
+  for(auto it = m_xsec_variations.begin(); it != m_xsec_variations.end(); it++) gen.AddXSecVariation( *it );
   gen.SetGeneratorNuOscType( GetNuOscType() );
   gen.SetRUNNUM( GetRunnum() );
   gen.SetSubRUNNUM( GetSubRunnum() );
@@ -421,6 +478,12 @@ void SKSNSimUserConfiguration::Apply( SKSNSimVectorSNGenerator &gen ) const {
   std::cout << "getTiemNBins= " << GetTimeNBins() << std::endl;
 }
 
+void SKSNSimUserConfiguration::Apply( SKSNSimSNFluxParametric &flux ) const {
+  flux.SetEnergyRange( GetFluxEnergyMin(), GetFluxEnergyMax() );
+  flux.SetTimeRange( GetFluxTimeMin(), GetFluxTimeMax() );
+  for(auto it = m_snburst_fluxparameters.begin(); it != m_snburst_fluxparameters.end(); it++) flux.SetParameters( *it );
+}
+
 void SKSNSimUserConfiguration::Apply( SKSNSimVectorGenerator &gen ) const {
   gen.SetEnergyMin( GetFluxEnergyMin() );
   gen.SetEnergyMax( GetFluxEnergyMax() );
@@ -431,6 +494,7 @@ void SKSNSimUserConfiguration::Apply( SKSNSimVectorGenerator &gen ) const {
   gen.SetRuntimeEnd( GetRuntimeRunEnd() );
   gen.SetRuntimePeriod( GetRuntimePeriod() );
   gen.SetFlatPositronFlux( GetDSNBFlatFlux() );
+  for(auto it = m_xsec_variations.begin(); it != m_xsec_variations.end(); it++) gen.AddXSecVariation( *it );
   gen.SetRUNNUM( GetRunnum() );
   gen.SetSubRUNNUM( GetSubRunnum() );
   gen.SetRandomSeed( GetRandomSeed() );
@@ -472,3 +536,183 @@ std::string SKSNSimUserConfiguration::convOFileModeString(MODEOFILE m) {
 std::string SKSNSimUserConfiguration::GetOFileModeString() const {
   return convOFileModeString( GetOFileMode() );
 }
+
+std::string SKSNSimUserConfiguration::convReactionString(XSECTYPE t) {
+  const static std::map<XSECTYPE, std::string> map_str {
+    { XSECTYPE::mXSECIBD, "ibd"},
+    { XSECTYPE::mXSECELASTIC, "elastic"},
+    { XSECTYPE::mXSECOXYGEN, "oxygen_cc"},
+    { XSECTYPE::mXSECOXYGENSUB, "oxygen_sub"},
+    { XSECTYPE::mXSECOXYGENNC, "oxygen_nc"},
+    { XSECTYPE::mNXSECTYPE, "undefined"}
+  };
+  return map_str.at( t );
+}
+
+std::string SKSNSimUserConfiguration::GetSNReactionsString() const {
+  std::string s;
+  for(auto it = m_sn_reactions.begin(); it != m_sn_reactions.end(); it++)
+    s += ( s.empty() ? "" : "," ) + convReactionString( *it );
+  return s;
+}
+
+SKSNSimUserConfiguration &SKSNSimUserConfiguration::SetSNReactions ( std::string s, bool exit_if_wrong ) {
+  // format: "ibd,elastic,..." or "all"
+  if( s == "all" ) return SetSNReactions( GetDefaultSNReactions() );
+  std::set<XSECTYPE> reactions;
+  std::string::size_type begin = 0;
+  while( begin <= s.size() ){
+    const auto end = std::min( s.find(',', begin), s.size() );
+    const std::string name = s.substr(begin, end - begin);
+    begin = end + 1;
+    bool found = false;
+    for(int t = 0; t < (int)XSECTYPE::mNXSECTYPE; t++){
+      if( name == convReactionString( (XSECTYPE)t ) ){
+        reactions.insert( (XSECTYPE)t );
+        found = true;
+      }
+    }
+    if( !found ){
+      std::cout << "ERR: unknown reaction \"" << name << "\" (supporting ibd, elastic, oxygen_cc, oxygen_sub, oxygen_nc and all)" << std::endl;
+      if( exit_if_wrong ) exit(EXIT_FAILURE);
+      return *this;
+    }
+  }
+  return SetSNReactions( reactions );
+}
+
+SKSNSimUserConfiguration &SKSNSimUserConfiguration::AddSNBurstFluxParameters ( std::string s, bool exit_if_wrong ) {
+  // format: "nueb:E=12@0/15@1/14@10,alpha=2.5", checked by applying to a temporary model
+  SKSNSimSNFluxParametric flux;
+  if( !flux.SetParameters( s ) ){
+    if( exit_if_wrong ) exit(EXIT_FAILURE);
+    return *this;
+  }
+  m_snburst_fluxparameters.push_back( s );
+  return *this;
+}
+
+SKSNSimUserConfiguration &SKSNSimUserConfiguration::SetSNBurstStreamWindow ( std::string s, bool exit_if_wrong ) {
+  // format: "1000", the whole model is loaded without this option
+  long n = 0;
+  size_t pos = 0;
+  try {
+    n = std::stol( s, &pos );
+  } catch ( const std::exception &e ) {
+    pos = 0;
+  }
+  if( pos == 0 || pos != s.size() || n <= 0 ){
+    std::cout << "ERR: number of time steps of the SN model window should be a positive integer: " << s << std::endl;
+    if( exit_if_wrong ) exit(EXIT_FAILURE);
+    return *this;
+  }
+  return SetSNBurstStreamWindow( (size_t)n );
+}
+
+SKSNSimUserConfiguration &SKSNSimUserConfiguration::SetTimeWindows ( std::string s, bool exit_if_wrong ) {
+  // format: "0,0.1,1,20" or "full"
+  SetTimeMode( SKSNSIMENUM::SNTIMEMODE::kINTEGRATED );
+  if( s == "full" ) return SetTimeWindows( std::vector<double>() );
+  std::vector<double> edges;
+  std::string::size_type begin = 0;
+  while( begin <= s.size() ){
+    const auto end = std::min( s.find(',', begin), s.size() );
+    const std::string item = s.substr(begin, end - begin);
+    begin = end + 1;
+    try {
+      edges.push_back( std::stod( item ) );
+    } catch ( const std::exception &e ) {
+      std::cout << "ERR: wrong edge of time window \"" << item << "\"" << std::endl;
+      if( exit_if_wrong ) exit(EXIT_FAILURE);
+      return *this;
+    }
+    if( edges.size() > 1 && !( edges.back() > edges[edges.size() - 2] ) ){
+      std::cout << "ERR: edges of time windows should be in ascending order: " << s << std::endl;
+      if( exit_if_wrong ) exit(EXIT_FAILURE);
+      return *this;
+    }
+  }
+  if( edges.size() < 2 ){
+    std::cout << "ERR: at least two edges are needed for time windows: " << s << std::endl;
+    if( exit_if_wrong ) exit(EXIT_FAILURE);
+    return *this;
+  }
+  return SetTimeWindows( edges );
+}
+
+SKSNSimUserConfiguration &SKSNSimUserConfiguration::AddXSecVariations ( std::string s, bool exit_if_wrong ) {
+  // format: "ibd,ibd_axial,oxygen_nc:1.2,..."
+  //   ibd, ibd_vud, ibd_axial: +1 sigma and -1 sigma of IBD cross section for each source of the error
+  //   {reaction}:{factor}: scale of the reaction
+  const static std::map<std::string, SKSNSimXSecIBDRVV::ERRORSOURCE> ibderrors {
+    { "ibd", SKSNSimXSecIBDRVV::kNERRORSOURCE },
+    { "ibd_vud", SKSNSimXSecIBDRVV::kERRVUDLAMBDA },
+    { "ibd_axial", SKSNSimXSecIBDRVV::kERRAXIALRADII }
+  };
+  std::string::size_type begin = 0;
+  while( begin <= s.size() ){
+    const auto end = std::min( s.find(',', begin), s.size() );
+    const std::string item = s.substr(begin, end - begin);
+    begin = end + 1;
+
+    auto ibderr = ibderrors.find(item);
+    if( ibderr != ibderrors.end() ){
+      AddXSecVariation( SKSNSimXSecVariation::MakeIBDError( item + "_p1sigma",  1.0, ibderr->second ) );
+      AddXSecVariation( SKSNSimXSecVariation::MakeIBDError( item + "_m1sigma", -1.0, ibderr->second ) );
+      continue;
+    }
+
+    const auto pos = item.find(':');
+    const std::string reaction = item.substr(0, pos);
+    XSECTYPE type = XSECTYPE::mNXSECTYPE;
+    bool found = ( reaction == "all" );
+    for(int t = 0; t < (int)XSECTYPE::mNXSECTYPE && !found; t++){
+      if( reaction == convReactionString( (XSECTYPE)t ) ){
+        type = (XSECTYPE)t;
+        found = true;
+      }
+    }
+    double factor = -1.0;
+    if( found && pos != std::string::npos ){
+      try {
+        factor = std::stod( item.substr(pos+1) );
+      } catch ( const std::exception &e ) {
+        factor = -1.0;
+      }
+    }
+    if( factor < 0.0 ){
+      std::cout << "ERR: wrong cross-section variation \"" << item << "\" (supporting ibd, ibd_vud, ibd_axial and {reaction}:{factor})" << std::endl;
+      if( exit_if_wrong ) exit(EXIT_FAILURE);
+      return *this;
+    }
+    std::string name = reaction + "_x" + item.substr(pos+1);
+    std::replace( name.begin(), name.end(), '.', 'p' ); // to be used in branch name
+    std::replace( name.begin(), name.end(), '-', 'm' );
+    std::replace( name.begin(), name.end(), '+', 'p' );
+    AddXSecVariation( SKSNSimXSecVariation::MakeScale( name, type, factor ) );
+  }
+  return *this;
+}
+
+SKSNSimUserConfiguration &SKSNSimUserConfiguration::AddDSNBFluxModel ( std::string s, bool exit_if_wrong ) {
+  // format: "filename" or "filename:norm"
+  double norm = 1.0;
+  std::string fname = s;
+  const auto pos = s.rfind(':');
+  if( pos != std::string::npos ){
+    fname = s.substr(0, pos);
+    try {
+      norm = std::stod( s.substr(pos+1) );
+    } catch ( const std::exception &e ) {
+      std::cout << "ERR: wrong normalization of additional flux: " << s << std::endl;
+      if( exit_if_wrong ) exit(EXIT_FAILURE);
+      return *this;
+    }
+  }
+  if( norm < 0.0 ){
+    std::cout << "ERR: negative normalization of additional flux: " << s << std::endl;
+    if( exit_if_wrong ) exit(EXIT_FAILURE);
+    return *this;
+  }
+  return AddDSNBFluxModel( fname, norm );
+}
@@ -10,13 +10,13 @@
 #include "SKSNSimCrosssection.hh"
 #include "SKSNSimTools.hh"
 #include <typeinfo>
-#include <Math/Integrator.h> // For flux x xsec integration via ROOT
 
 using namespace SKSNSimPhysConst;
 
 
 double SKSNSimVectorGenerator::FindMaxProb ( SKSNSimFluxModel &flux, SKSNSimCrosssectionModel &xsec, int elapseday){
-  const double time_max_flux = (elapseday==-1)?flux.FindMaxFluxTime(): elapseday;
+  // elapseday = -1: maximum over time in each energy slice, not only at the time of the peak
+  const SKSNSimFluxEnvelope *envelope = ( elapseday == -1 ? &flux.GetFluxEnvelope(SKSNSimFluxModel::FLUXNUEB) : nullptr );
   double maxP = 0.;
   const double ene_min = flux.GetEnergyLimitMin();
   const double ene_max = flux.GetEnergyLimitMax();
@@ -28,9 +28,10 @@ double SKSNSimVectorGenerator::FindMaxProb ( SKSNSimFluxModel &flux, SKSNSimCros
   constexpr double diff_cost = (cost_max - cost_min)/nbin_cost;
   for(size_t i = 0; i < nbin_ene; i++){
     const double ene =  ene_min +  diff_ene* double(i);
+    const double f = ( envelope != nullptr ? envelope->GetMaxFlux(ene) : flux.GetFlux(ene, elapseday, SKSNSimFluxModel::FLUXNUEB) );
     for(size_t j = 0; j < nbin_cost; j++){
-      const double cost =  cost_min +  diff_cost* double(i);
-      const double p = flux.GetFlux(ene, time_max_flux, SKSNSimFluxModel::FLUXNUEB) * xsec.GetDiffCrosssection(ene, cost).first;
+      const double cost =  cost_min +  diff_cost* double(j);
+      const double p = f * xsec.GetDiffCrosssection(ene, cost).first;
       if(maxP < p) maxP = p;
     }
   }
@@ -40,14 +41,60 @@ double SKSNSimVectorGenerator::FindMaxProb ( SKSNSimFluxModel &flux, SKSNSimCros
 
 double SKSNSimVectorGenerator::SetMaximumHitProbability(){
   // TODO fix to use appropriate combination of flux and xsec models
+  m_max_hit_probabilities.clear();
   if( fluxmodels.size() < 1 || xsecmodels.size() < 1 ){
     m_max_hit_probability = -1.0;
     return m_max_hit_probability;
   }
-  m_max_hit_probability = FindMaxProb(*fluxmodels[0], *xsecmodels[0]);
+  // each flux component has own maximum since hit-and-miss is done after selecting the component
+  for(auto it = fluxmodels.begin(); it != fluxmodels.end(); it++)
+    m_max_hit_probabilities.push_back( FindMaxProb(**it, *xsecmodels[0]) );
+  m_max_hit_probability = m_max_hit_probabilities[0];
   return m_max_hit_probability;
 }
 
+void SKSNSimVectorGenerator::UpdateFluxComponents(){
+  // Integral of (flux) x (xsec) for each flux component at elapseday of current run,
+  // then building the table to select flux component for each event
+  SKSNSimCrosssectionModel &xsec = *xsecmodels[0]; // TODO modify for user to select models
+  m_cached_runnum = m_runnum;
+  m_cached_elapseday = SKSNSimTools::elapseday(m_runnum);
+  const int elapseday = m_cached_elapseday;
+
+  m_component_integrals.clear();
+  m_flux_integral = 0.;
+  m_flux_integral_error = 0.;
+  for(size_t i = 0; i < fluxmodels.size(); i++){
+    SKSNSimFluxModel &flux = *fluxmodels[i];
+    const double max_prob_elapseday = FindMaxProb(flux,xsec, elapseday);
+
+    const SKSNSimFluxXSecIntegrator::RESULT result = m_integrator.Integrate(flux, xsec, GetEnergyMin(), GetEnergyMax(), elapseday, SKSNSimFluxModel::FLUXNUEB);
+    const double integral = fluxnorms[i] * result.first;
+    m_flux_integral_error += fluxnorms[i] * result.second;
+    m_component_integrals.push_back(integral);
+    m_flux_integral += integral;
+
+    std::cout << "[GenerateEventIBD()] runnum = " << m_runnum << " => elapseday = " << elapseday << " component " << i << " (norm " << fluxnorms[i] << ") maxP " << max_prob_elapseday << " integral(fluxXxsec) " << integral << " +- " << fluxnorms[i] * result.second << std::endl;
+  }
+  m_component_table.Build(m_component_integrals);
+
+  std::cout << "[GenerateEventIBD()] runnum = " << m_runnum << " => elapseday = " << elapseday << " integral(fluxXxsec) " << m_flux_integral << " m_runtime_factor " << m_runtime_factor << " weight " << m_flux_integral * SKSNSimTools::GetNTargetP(m_generator_volume) / m_runtime_factor  << std::endl;
+
+  // Expected number of events for each cross-section variation
+  if( m_varied_xsecs.size() != m_xsec_variations.size() || ( !m_varied_xsecs.empty() && &m_varied_xsecs[0]->GetBase() != &xsec ) ){
+    m_varied_xsecs.clear();
+    m_integrator.ClearCache(); // models are identified by address in the integrator
+    for(auto it = m_xsec_variations.begin(); it != m_xsec_variations.end(); it++)
+      m_varied_xsecs.push_back( std::make_unique<SKSNSimXSecVaried>(xsec, *it, XSECTYPE::mXSECIBD) );
+  }
+  m_variation_integrals.assign(m_xsec_variations.size(), 0.);
+  for(size_t v = 0; v < m_varied_xsecs.size(); v++){
+    for(size_t i = 0; i < fluxmodels.size(); i++)
+      m_variation_integrals[v] += fluxnorms[i] * m_integrator.Integrate(*fluxmodels[i], *m_varied_xsecs[v], GetEnergyMin(), GetEnergyMax(), elapseday, SKSNSimFluxModel::FLUXNUEB).first;
+    std::cout << "[GenerateEventIBD()] runnum = " << m_runnum << " => elapseday = " << elapseday << " xsec variation " << m_xsec_variations[v].GetName() << " integral(fluxXxsec) " << m_variation_integrals[v] << " ratio to nominal " << ( m_flux_integral > 0. ? m_variation_integrals[v] / m_flux_integral : 0. ) << std::endl;
+  }
+}
+
 SKSNSimSNEventVector SKSNSimVectorGenerator::GenerateEventIBD() {
   SKSNSimSNEventVector ev;
   ev.SetRandomSeed(GetRandomSeed());
@@ -57,42 +104,27 @@ SKSNSimSNEventVector SKSNSimVectorGenerator::GenerateEventIBD() {
 
   TRandom &rng = *randomgenerator;
   if(fluxmodels.size() == 0) return ev;
-  SKSNSimFluxModel &flux = *fluxmodels[0]; // TODO modify for user to select models
   if(xsecmodels.size() == 0) return ev;
   SKSNSimCrosssectionModel &xsec = *xsecmodels[0]; // TODO modify for user to select models
 
-
-
-  static int static_runnum = -1;
-  static int elapseday = -1;
-  static double max_prob_elapseday = -1.;
-  static double flux_integral = -1.;
-  if( static_runnum != m_runnum ){
-    static_runnum = m_runnum;
-    elapseday = SKSNSimTools::elapseday(m_runnum);
-    max_prob_elapseday = FindMaxProb(flux,xsec, elapseday);
-
-    ROOT::Math::IntegratorOneDimOptions::SetDefaultAbsTolerance(1.e-6);
-    ROOT::Math::IntegratorOneDimOptions::SetDefaultRelTolerance(1.e-6);
-    auto func = std::bind([](const SKSNSimFluxModel &f, const SKSNSimCrosssectionModel &s, double e, int &eladay) {
-      return f.GetFlux(e, eladay, SKSNSimFluxModel::FLUXNUEB) * s.GetCrosssection(e);
-    }, std::ref(flux), std::ref(xsec), std::placeholders::_1, elapseday);
-    ROOT::Math::Integrator ig;
-    ig.SetFunction(func);
-    flux_integral = ig.Integral(GetEnergyMin(), GetEnergyMax());
-
-    std::cout << "[GenerateEventIBD()] runnum = " << m_runnum << " => elapseday = " << elapseday << " maxP " << max_prob_elapseday << " integral(fluxXxsec) " << flux_integral << " m_runtime_factor " << m_runtime_factor << " weight " << flux_integral * SKSNSimTools::GetNTargetP(m_generator_volume) / m_runtime_factor  << std::endl;
-  }
+  if( m_cached_runnum != m_runnum ) UpdateFluxComponents();
+  const int elapseday = m_cached_elapseday;
 #ifdef DEBUG
   std::cout << "[GenerateEventIBD()] runnum = " << m_runnum << " => elapseday = " << elapseday << std::endl;
 #endif
-  ev.SetWeight( flux_integral * SKSNSimTools::GetNTargetP(m_generator_volume) / m_runtime_factor);
+  ev.SetWeight( m_flux_integral * SKSNSimTools::GetNTargetP(m_generator_volume) / m_runtime_factor);
+
+  // select flux component in proportion to (norm) x integral of (flux) x (xsec)
+  const size_t icomp = ( fluxmodels.size() > 1 ? m_component_table.Sample(rng) : 0 );
+  SKSNSimFluxModel &flux = *fluxmodels[icomp];
+  const double max_hit_probability = m_max_hit_probabilities[icomp];
+  ev.SetFluxComponent(icomp);
 
 
   auto SQ = [](double a){ return a*a;};
 
   // determine neutrino and positron energy, and its direction
-  ev.SetWeightMaxProb(m_max_hit_probability);
+  ev.SetWeightMaxProb(max_hit_probability);
   while( 1 ){
     nuEne = rng.Uniform( GetEnergyMin(), GetEnergyMax());
     ev.AddNRandomThrow(1);
@@ -105,7 +137,7 @@ SKSNSimSNEventVector SKSNSimVectorGenerator::GenerateEventIBD() {
     const double sigm = xsecpair.first;
 
     double p = nuFlux * sigm;
-    double x = rng.Uniform( 0., m_max_hit_probability);
+    double x = rng.Uniform( 0., max_hit_probability);
     if( x < p ) break;
   }
 #ifdef DEBUG
@@ -225,6 +257,7 @@ SKSNSimSNEventVector SKSNSimVectorGenerator::GenerateEventIBD() {
   const double rvtx[3] = {xyz.x, xyz.y, xyz.z };
   const double rdir[3] = {-nuDir.x, -nuDir.y, -nuDir.z };
   ev.SetSNEvtInfo( 0 /* IBD */, 0.0, - PDG_ELECTRON_NEUTRINO, nuEne, rdir, rvtx );
+  if( !m_xsec_variations.empty() ) ev.SetXSecWeights( SKSNSimXSecVariation::GetFactors(m_xsec_variations, nuEne, XSECTYPE::mXSECIBD) );
 
   return ev;
 }
@@ -360,11 +393,172 @@ SKSNSimSNEventVector SKSNSimVectorGenerator::GenerateEventIBDFlat() {
   const double rvtx[3] = {xyz.x, xyz.y, xyz.z };
   const double rdir[3] = {-nuDir.x, -nuDir.y, -nuDir.z };
   ev.SetSNEvtInfo( 0 /* IBD */, 0.0, - PDG_ELECTRON_NEUTRINO, nuEne, rdir, rvtx );
+  if( !m_xsec_variations.empty() ) ev.SetXSecWeights( SKSNSimXSecVariation::GetFactors(m_xsec_variations, nuEne, XSECTYPE::mXSECIBD) );
+
+  return ev;
+}
+
+void SKSNSimVectorGenerator::IBDFLATBATCH::Resize(const size_t n){
+  eEne.resize(n); cost.resize(n); nuEne.resize(n);
+  vtx_x.resize(n); vtx_y.resize(n); vtx_z.resize(n);
+  nuDir_x.resize(n); nuDir_y.resize(n); nuDir_z.resize(n);
+  eDir_x.resize(n); eDir_y.resize(n); eDir_z.resize(n);
+}
+
+void SKSNSimVectorGenerator::FillBatchIBDFlat(IBDFLATBATCH &b, const size_t n){
+  // Same kinematics as GenerateEventIBDFlat(), but all uniform random numbers of n events are thrown at once
+  // and each quantity is calculated in a simple loop over the arrays.
+  // Random numbers: [0] eEne, [1] cost, [2] nu cosTheta, [3] nu phi, [4] e+ phi, [5] vertex r^2, [6] vertex phi, [7] vertex z
+  constexpr size_t NRANDOM = 8;
+  b.Resize(n);
+  b.rnd.resize(NRANDOM * n);
+  randomgenerator->RndmArray((int)(NRANDOM * n), b.rnd.data());
+  const double *u_eene  = b.rnd.data();
+  const double *u_cost  = u_eene  + n;
+  const double *u_nucos = u_cost  + n;
+  const double *u_nuphi = u_nucos + n;
+  const double *u_ephi  = u_nuphi + n;
+  const double *u_r2    = u_ephi  + n;
+  const double *u_vphi  = u_r2    + n;
+  const double *u_z     = u_vphi  + n;
+
+  // positron energy and angle, then neutrino energy
+  const double ene_min = GetEnergyMin();
+  const double ene_width = GetEnergyMax() - GetEnergyMin();
+  for(size_t i = 0; i < n; i++){
+    b.eEne[i] = ene_min + ene_width * u_eene[i];
+    b.cost[i] = -1. + 2. * u_cost[i];
+  }
+  for(size_t i = 0; i < n; i++) b.nuEne[i] = SKSNSimCrosssection::CalcIBDEnuFromEpos( b.eEne[i], b.cost[i] );
+
+  // interaction point
+  double rPositionRange = RINTK;
+  double hPositionRange = ZPINTK;
+  switch (m_generator_volume)
+  {
+    case SKSNSIMENUM::TANKVOLUME::kIDFV: //Fiducial volume
+      rPositionRange = RINTK - FVCUT;
+      hPositionRange = ZPINTK - FVCUT;
+      break;
+    case SKSNSIMENUM::TANKVOLUME::kTANKFULL: //entire detector volume (including OD)
+      rPositionRange = RTKTK;
+      hPositionRange = ZPTKTK;
+      break;
+    default: //entire ID volume
+      rPositionRange = RINTK;
+      hPositionRange = ZPINTK;
+  }
+  for(size_t i = 0; i < n; i++){
+    const double r = rPositionRange * std::sqrt( u_r2[i] );
+    const double phi = 2. * M_PI * u_vphi[i];
+    b.vtx_x[i] = r * std::cos( phi );
+    b.vtx_y[i] = r * std::sin( phi );
+    b.vtx_z[i] = -hPositionRange + 2. * hPositionRange * u_z[i];
+  }
+
+  // neutrino direction (isotropic) and positron direction rotated along the neutrino direction,
+  // equivalent to Rmat * UtilVector3(eTheta, ePhi) in GenerateEventIBDFlat() without acos()
+  for(size_t i = 0; i < n; i++){
+    const double cost_nu = -1. + 2. * u_nucos[i];
+    const double sint_nu = std::sqrt( std::max( 0., 1. - cost_nu * cost_nu) );
+    const double phi_nu = 2. * M_PI * u_nuphi[i];
+    const double cosp_nu = std::cos( phi_nu );
+    const double sinp_nu = std::sin( phi_nu );
+    b.nuDir_x[i] = sint_nu * cosp_nu;
+    b.nuDir_y[i] = sint_nu * sinp_nu;
+    b.nuDir_z[i] = cost_nu;
+
+    const double sint_e = std::sqrt( std::max( 0., 1. - b.cost[i] * b.cost[i]) );
+    const double phi_e = M_PI * ( 2. * u_ephi[i] - 1. );
+    const double ox = sint_e * std::cos( phi_e );
+    const double oy = sint_e * std::sin( phi_e );
+    const double oz = b.cost[i];
+    b.eDir_x[i] = cost_nu * cosp_nu * ox - sinp_nu * oy + sint_nu * cosp_nu * oz;
+    b.eDir_y[i] = cost_nu * sinp_nu * ox + cosp_nu * oy + sint_nu * sinp_nu * oz;
+    b.eDir_z[i] =           -sint_nu * ox                +           cost_nu * oz;
+  }
+}
+
+SKSNSimSNEventVector SKSNSimVectorGenerator::ConvertBatchIBDFlat(const IBDFLATBATCH &b, const size_t i) const {
+  // Fill i-th event of the batch in the same format as GenerateEventIBDFlat()
+  SKSNSimSNEventVector ev;
+  ev.SetRandomSeed(GetRandomSeed());
+
+  const double eEne = b.eEne[i];
+  const double nuEne = b.nuEne[i];
+
+  // MCVERTEX (see $SKOFL_ROOT/inc/vcvrtx.h )
+  ev.AddVertex(b.vtx_x[i], b.vtx_y[i], b.vtx_z[i],
+      1, 0, 0.);
+
+  // Original neutrino
+  const double nuMomentum[3] = { nuEne * b.nuDir_x[i], nuEne * b.nuDir_y[i], nuEne * b.nuDir_z[i] };
+  ev.AddTrack(
+      -PDG_ELECTRON_NEUTRINO, nuEne,
+      nuMomentum[0], nuMomentum[1], nuMomentum[2],
+      0, 0, 1, -1, 0
+      );
+
+  // Original proton
+  ev.AddTrack(
+      PDG_PROTON, Mp,
+      0., 0., 0.,
+      0, 0, 1, -1, 0
+      );
+
+  // Positron
+  const double amom = std::sqrt( eEne*eEne - Me*Me );
+  const double positronMomentum[3] = { amom * b.eDir_x[i], amom * b.eDir_y[i], amom * b.eDir_z[i] };
+  ev.AddTrack(
+      -PDG_ELECTRON, eEne,
+      positronMomentum[0], positronMomentum[1], positronMomentum[2],
+      1, 1, 1, 0, 1
+      );
+
+  // Neutron
+  const double neutronMomentum[3] = { nuMomentum[0] - positronMomentum[0], nuMomentum[1] - positronMomentum[1], nuMomentum[2] - positronMomentum[2] };
+  ev.AddTrack(
+      PDG_NEUTRON,
+      std::sqrt( neutronMomentum[0]*neutronMomentum[0] + neutronMomentum[1]*neutronMomentum[1] + neutronMomentum[2]*neutronMomentum[2] + Mn*Mn),
+      neutronMomentum[0], neutronMomentum[1], neutronMomentum[2],
+      1, 1, 1, 0, 1
+      );
+
+  ev.SetRunnum(m_runnum);
+  ev.SetSubRunnum(m_subrunnum);
+  const double rvtx[3] = { b.vtx_x[i], b.vtx_y[i], b.vtx_z[i] };
+  const double rdir[3] = { -b.nuDir_x[i], -b.nuDir_y[i], -b.nuDir_z[i] };
+  ev.SetSNEvtInfo( 0 /* IBD */, 0.0, - PDG_ELECTRON_NEUTRINO, nuEne, rdir, rvtx );
+  if( !m_xsec_variations.empty() ) ev.SetXSecWeights( SKSNSimXSecVariation::GetFactors(m_xsec_variations, nuEne, XSECTYPE::mXSECIBD) );
 
   return ev;
 }
 
+size_t SKSNSimVectorGenerator::GenerateEventsIBDFlat(const size_t n, std::function<void(const std::vector<SKSNSimSNEventVector> &)> writer, const size_t nchunk){
+  // Batch version of GenerateEventIBDFlat() for high statistics samples (e.g. detector response maps).
+  // Events are generated nchunk at a time and handed to writer, so that memory usage does not depend on n.
+  if( nchunk == 0 ){
+    std::cout << "[GenerateEventsIBDFlat()] ERR: chunk size should be positive" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  IBDFLATBATCH batch;
+  std::vector<SKSNSimSNEventVector> evt_buffer;
+  evt_buffer.reserve( std::min(n, nchunk) );
+  size_t ngen = 0;
+  while( ngen < n ){
+    const size_t nbatch = std::min( nchunk, n - ngen );
+    FillBatchIBDFlat(batch, nbatch);
+    evt_buffer.clear();
+    for(size_t i = 0; i < nbatch; i++) evt_buffer.push_back( ConvertBatchIBDFlat(batch, i) );
+    writer(evt_buffer);
+    ngen += nbatch;
+  }
+  return ngen;
+}
+
 SKSNSimVectorSNGenerator::SKSNSimVectorSNGenerator():
+  m_reactions{ XSECTYPE::mXSECIBD, XSECTYPE::mXSECELASTIC, XSECTYPE::mXSECOXYGEN, XSECTYPE::mXSECOXYGENSUB, XSECTYPE::mXSECOXYGENNC },
+  m_elastic_ethr( SKSNSimXSecNuElastic::GetDefaultElectronEnergyThreshold() ),
   m_runnum((int)SKSNSIMENUM::SKPERIODRUN::SKMC ),
   m_subrunnum(0),
   m_generator_energy_min(0.0),
@@ -373,6 +567,7 @@ SKSNSimVectorSNGenerator::SKSNSimVectorSNGenerator():
   m_generator_time_min (0.0),
   m_generator_time_max (20.0),
   m_time_nbins(20000),
+  m_time_mode( SKSNSIMENUM::SNTIMEMODE::kBINNED ),
   m_fill_event(true),
   m_generator_volume( SKSNSIMENUM::TANKVOLUME::kIDFULL ),
   m_nuosc_type( SKSNSIMENUM::NEUTRINOOSCILLATION::kNONE ),
@@ -384,28 +579,39 @@ SKSNSimVectorSNGenerator::SKSNSimVectorSNGenerator():
   m_sn_time[0] = 0;
   m_sn_time[1] = 0;
   m_sn_time[2] = 0;
+}
 
-  xsecmodels[XSECTYPE::mXSECIBD]       = std::make_unique<SKSNSimXSecIBDSV>();
-  xsecmodels[XSECTYPE::mXSECELASTIC]   = std::make_unique<SKSNSimXSecNuElastic>();
-  xsecmodels[XSECTYPE::mXSECOXYGEN]    = std::make_unique<SKSNSimXSecNuOxygen>();
-  xsecmodels[XSECTYPE::mXSECOXYGENSUB] = std::make_unique<SKSNSimXSecNuOxygenSub>();
-  xsecmodels[XSECTYPE::mXSECOXYGENNC]  = std::make_unique<SKSNSimXSecNuOxygenNC>();
+void SKSNSimVectorSNGenerator::LoadXSecModels(){
+  // Construct models of the selected reactions only, since loading tables of all models takes a while.
+  // Angles of sub-channel events of nu-oxygen CC are determined by the CC model (determineAngleNueO), so it is also needed for oxygensub.
+  const bool needOxygen = IsReactionEnabled(XSECTYPE::mXSECOXYGEN) || IsReactionEnabled(XSECTYPE::mXSECOXYGENSUB);
+  if( IsReactionEnabled(XSECTYPE::mXSECIBD)       && !xsecmodels.count(XSECTYPE::mXSECIBD) )       xsecmodels[XSECTYPE::mXSECIBD]       = std::make_unique<SKSNSimXSecIBDSV>();
+  if( IsReactionEnabled(XSECTYPE::mXSECELASTIC)   && !xsecmodels.count(XSECTYPE::mXSECELASTIC) )   xsecmodels[XSECTYPE::mXSECELASTIC]   = std::make_unique<SKSNSimXSecNuElastic>(m_elastic_ethr);
+  if( needOxygen                                  && !xsecmodels.count(XSECTYPE::mXSECOXYGEN) )    xsecmodels[XSECTYPE::mXSECOXYGEN]    = std::make_unique<SKSNSimXSecNuOxygen>();
+  if( IsReactionEnabled(XSECTYPE::mXSECOXYGENSUB) && !xsecmodels.count(XSECTYPE::mXSECOXYGENSUB) ) xsecmodels[XSECTYPE::mXSECOXYGENSUB] = std::make_unique<SKSNSimXSecNuOxygenSub>();
+  if( IsReactionEnabled(XSECTYPE::mXSECOXYGENNC)  && !xsecmodels.count(XSECTYPE::mXSECOXYGENNC) )  xsecmodels[XSECTYPE::mXSECOXYGENNC]  = std::make_unique<SKSNSimXSecNuOxygenNC>();
 }
 
-std::vector<SKSNSimSNEventVector> SKSNSimVectorSNGenerator::GenerateEvents(){
-  std::vector<SKSNSimSNEventVector> evt_buffer;
-  SKSNSimBinnedFluxModel &flux = dynamic_cast<SKSNSimBinnedFluxModel&>(*fluxmodels[0]); // TODO selectable flux
-  if(&flux == NULL) {
-    std::cerr << "In GenerateEvents() no appropriate flux model (binned flux)" << std::endl;
-    evt_buffer.clear();
-    return evt_buffer;
+size_t SKSNSimVectorSNGenerator::GenerateEvents(SKSNSimEventSink sink){
+  std::vector<SKSNSimSNEventVector> evt_buffer; // events in the current time bin
+  if( fluxmodels.empty() ) {
+    std::cerr << "In GenerateEvents() no flux model" << std::endl;
+    return 0;
   }
-
-  SKSNSimXSecIBDSV       &xsecibd         = dynamic_cast<SKSNSimXSecIBDSV&>(      *xsecmodels[XSECTYPE::mXSECIBD]);
-  SKSNSimXSecNuElastic   &xsecnuela       = dynamic_cast<SKSNSimXSecNuElastic&>(  *xsecmodels[XSECTYPE::mXSECELASTIC]);
-  SKSNSimXSecNuOxygen    &xsecnuoxygen    = dynamic_cast<SKSNSimXSecNuOxygen&>(   *xsecmodels[XSECTYPE::mXSECOXYGEN]);
-  SKSNSimXSecNuOxygenSub &xsecnuoxygensub = dynamic_cast<SKSNSimXSecNuOxygenSub&>(*xsecmodels[XSECTYPE::mXSECOXYGENSUB]);
-  SKSNSimXSecNuOxygenNC  &xsecnuoxygennc  = dynamic_cast<SKSNSimXSecNuOxygenNC&>( *xsecmodels[XSECTYPE::mXSECOXYGENNC]);
+  const SKSNSimFluxModel &flux = *fluxmodels[0]; // TODO selectable flux; spectra are evaluated on the energy grid, any model is available
+
+  // Unselected reactions have no model: their tables are left empty and their channels are skipped in the loop
+  LoadXSecModels();
+  const bool useIBD       = IsReactionEnabled(XSECTYPE::mXSECIBD);
+  const bool useElastic   = IsReactionEnabled(XSECTYPE::mXSECELASTIC);
+  const bool useOxygen    = IsReactionEnabled(XSECTYPE::mXSECOXYGEN);
+  const bool useOxygenSub = IsReactionEnabled(XSECTYPE::mXSECOXYGENSUB);
+  const bool useOxygenNC  = IsReactionEnabled(XSECTYPE::mXSECOXYGENNC);
+  SKSNSimXSecIBDSV       *xsecibd         = useIBD       ? dynamic_cast<SKSNSimXSecIBDSV*>(      xsecmodels.at(XSECTYPE::mXSECIBD).get())       : nullptr;
+  SKSNSimXSecNuElastic   *xsecnuela       = useElastic   ? dynamic_cast<SKSNSimXSecNuElastic*>(  xsecmodels.at(XSECTYPE::mXSECELASTIC).get())   : nullptr;
+  SKSNSimXSecNuOxygen    *xsecnuoxygen    = useOxygen    ? dynamic_cast<SKSNSimXSecNuOxygen*>(   xsecmodels.at(XSECTYPE::mXSECOXYGEN).get())    : nullptr;
+  SKSNSimXSecNuOxygenSub *xsecnuoxygensub = useOxygenSub ? dynamic_cast<SKSNSimXSecNuOxygenSub*>(xsecmodels.at(XSECTYPE::mXSECOXYGENSUB).get()) : nullptr;
+  SKSNSimXSecNuOxygenNC  *xsecnuoxygennc  = useOxygenNC  ? dynamic_cast<SKSNSimXSecNuOxygenNC*>( xsecmodels.at(XSECTYPE::mXSECOXYGENNC).get())  : nullptr;
 
 	std::cout << "Prcess of sn_burst side" << std::endl;//nakanisi
 	/*---- Fill total cross section into array to avoid repeating calculation ----*/
@@ -413,8 +619,17 @@ std::vector<SKSNSimSNEventVector> SKSNSimVectorSNGenerator::GenerateEvents(){
 	const double nuEne_max    = GetEnergyMax();
   const int nuEneNBins      = GetEnergyNBins();
   const double nuEneBinSize = GetEnergyBinWidth();
-  const int tNBins          = GetTimeNBins();
-  const double tBinSize     = GetTimeBinWidth();
+  // time-integrated mode: each time window is one bin, with the flux averaged over the window
+  const bool timeIntegrated = ( GetTimeMode() == SKSNSIMENUM::SNTIMEMODE::kINTEGRATED );
+  const std::vector<double> tWindows = GetTimeWindows();
+  const int tNBins          = ( timeIntegrated ? (int)tWindows.size() - 1 : (int)GetTimeNBins() );
+  double tBinSize           = GetTimeBinWidth();
+  for(size_t i = 1; timeIntegrated && i < tWindows.size(); i++){
+    if( !( tWindows[i] > tWindows[i-1] ) ){
+      std::cerr << "In GenerateEvents() time windows should be in ascending order: " << tWindows[i-1] << ", " << tWindows[i] << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
   const double tStart       = GetTimeMin();
   const double tEnd         = GetTimeMax();
   std::vector<double> totcrsIBD(nuEneNBins, 0.); // nu_energy -> total-xsec
@@ -459,90 +674,94 @@ std::vector<SKSNSimSNEventVector> SKSNSimVectorSNGenerator::GenerateEvents(){
 #endif
     /*----- inverse beta decay -----*/
     constexpr double eEneThr = 5.0;
-    if(nu_energy > eEneThr + DeltaM) totcrsIBD[i_nu_ene] = xsecibd.GetCrosssection(nu_energy);
+    if(useIBD && nu_energy > eEneThr + DeltaM) totcrsIBD[i_nu_ene] = xsecibd->GetCrosssection(nu_energy);
     //SKSNSimTools::DumpDebugMessage(Form("IBD XSEC %.5g MeV -> %.5g cm2", nu_energy, totcrsIBD[i_nu_ene]));
 
     /*----- electron elastic -----*/
 
-    totcrsNue[i_nu_ene]  = xsecnuela.GetCrosssection(nu_energy,   PDG_ELECTRON_NEUTRINO, flag_elastic_thr);
-    totcrsNueb[i_nu_ene] = xsecnuela.GetCrosssection(nu_energy, - PDG_ELECTRON_NEUTRINO, flag_elastic_thr);
-    totcrsNux[i_nu_ene]  = xsecnuela.GetCrosssection(nu_energy,   PDG_MUON_NEUTRINO,     flag_elastic_thr); // Nux (here choosing MuNu but this handles as nu_x
-    totcrsNuxb[i_nu_ene] = xsecnuela.GetCrosssection(nu_energy, - PDG_MUON_NEUTRINO,     flag_elastic_thr);
+    if( useElastic ){
+      totcrsNue[i_nu_ene]  = xsecnuela->GetCrosssection(nu_energy,   PDG_ELECTRON_NEUTRINO, flag_elastic_thr);
+      totcrsNueb[i_nu_ene] = xsecnuela->GetCrosssection(nu_energy, - PDG_ELECTRON_NEUTRINO, flag_elastic_thr);
+      totcrsNux[i_nu_ene]  = xsecnuela->GetCrosssection(nu_energy,   PDG_MUON_NEUTRINO,     flag_elastic_thr); // Nux (here choosing MuNu but this handles as nu_x
+      totcrsNuxb[i_nu_ene] = xsecnuela->GetCrosssection(nu_energy, - PDG_MUON_NEUTRINO,     flag_elastic_thr);
+    }
 
 		//std::cout << "start calculate cc reaction crosssection" << std::endl; //nakanisi
     /*----- charged current with oxygen -----*/
     // rcn (reaction): nubar or nu
-    for(int rcn=0;rcn<2;rcn++){
-      for(int state=0;state<5;state++){
-        if(state==0){
-          for(int ex_state=0;ex_state<3;ex_state++){
-            for(int ch=0;ch<7;ch++){
-              if(rcn==0){
-                //electron neutrino
-                crsOx = xsecnuoxygen.GetCrosssection(nu_energy, {rcn, state, ex_state, ch});
-                Ocrse0[ex_state][ch].push_back(crsOx);
-              }
-              else if(rcn==1){
-                //anti electron neutrino
-                crsOx = xsecnuoxygen.GetCrosssection(nu_energy, {rcn, state, ex_state, ch});
-                Ocrsp0[ex_state][ch].push_back(crsOx);
+    if( useOxygen ){
+      for(int rcn=0;rcn<2;rcn++){
+        for(int state=0;state<5;state++){
+          if(state==0){
+            for(int ex_state=0;ex_state<3;ex_state++){
+              for(int ch=0;ch<7;ch++){
+                if(rcn==0){
+                  //electron neutrino
+                  crsOx = xsecnuoxygen->GetCrosssection(nu_energy, {rcn, state, ex_state, ch});
+                  Ocrse0[ex_state][ch].push_back(crsOx);
+                }
+                else if(rcn==1){
+                  //anti electron neutrino
+                  crsOx = xsecnuoxygen->GetCrosssection(nu_energy, {rcn, state, ex_state, ch});
+                  Ocrsp0[ex_state][ch].push_back(crsOx);
+                }
               }
             }
           }
-        }
-        else if(state==1){
-          for(int ex_state=0;ex_state<15;ex_state++){
-            for(int ch=0;ch<7;ch++){
-              if(rcn==0){
-                crsOx = xsecnuoxygen.GetCrosssection(nu_energy, {rcn, state, ex_state, ch});
-                Ocrse1[ex_state][ch].push_back(crsOx);
-              }
-              else if(rcn==1){
-                crsOx = xsecnuoxygen.GetCrosssection(nu_energy, {rcn, state, ex_state, ch});
-                Ocrsp1[ex_state][ch].push_back(crsOx);
+          else if(state==1){
+            for(int ex_state=0;ex_state<15;ex_state++){
+              for(int ch=0;ch<7;ch++){
+                if(rcn==0){
+                  crsOx = xsecnuoxygen->GetCrosssection(nu_energy, {rcn, state, ex_state, ch});
+                  Ocrse1[ex_state][ch].push_back(crsOx);
+                }
+                else if(rcn==1){
+                  crsOx = xsecnuoxygen->GetCrosssection(nu_energy, {rcn, state, ex_state, ch});
+                  Ocrsp1[ex_state][ch].push_back(crsOx);
+                }
               }
             }
           }
-        }
-        else if(state==2){
-          for(int ex_state=0;ex_state<8;ex_state++){
-            for(int ch=0;ch<7;ch++){
-              if(rcn==0){
-                crsOx = xsecnuoxygen.GetCrosssection(nu_energy, {rcn, state, ex_state, ch});
-                Ocrse2[ex_state][ch].push_back(crsOx);
-              }
-              else if(rcn==1){
-                crsOx = xsecnuoxygen.GetCrosssection(nu_energy, {rcn, state, ex_state, ch});
-                Ocrsp2[ex_state][ch].push_back(crsOx);
+          else if(state==2){
+            for(int ex_state=0;ex_state<8;ex_state++){
+              for(int ch=0;ch<7;ch++){
+                if(rcn==0){
+                  crsOx = xsecnuoxygen->GetCrosssection(nu_energy, {rcn, state, ex_state, ch});
+                  Ocrse2[ex_state][ch].push_back(crsOx);
+                }
+                else if(rcn==1){
+                  crsOx = xsecnuoxygen->GetCrosssection(nu_energy, {rcn, state, ex_state, ch});
+                  Ocrsp2[ex_state][ch].push_back(crsOx);
+                }
               }
             }
           }
-        }
-        else if(state==3){
-          for(int ex_state=0;ex_state<1;ex_state++){
-            for(int ch=0;ch<7;ch++){
-              if(rcn==0){
-                crsOx = xsecnuoxygen.GetCrosssection(nu_energy, {rcn, state, ex_state, ch});
-                Ocrse3[ex_state][ch].push_back(crsOx);
-                //if(ch==0)std::cout << nu_energy << " " << state << " " << ex_state << " " << crsOx << " " << std::endl; //nakanisi
-              }
-              else if(rcn==1){
-                crsOx = xsecnuoxygen.GetCrosssection(nu_energy, {rcn, state, ex_state, ch});
-                Ocrsp3[ex_state][ch].push_back(crsOx);
+          else if(state==3){
+            for(int ex_state=0;ex_state<1;ex_state++){
+              for(int ch=0;ch<7;ch++){
+                if(rcn==0){
+                  crsOx = xsecnuoxygen->GetCrosssection(nu_energy, {rcn, state, ex_state, ch});
+                  Ocrse3[ex_state][ch].push_back(crsOx);
+                  //if(ch==0)std::cout << nu_energy << " " << state << " " << ex_state << " " << crsOx << " " << std::endl; //nakanisi
+                }
+                else if(rcn==1){
+                  crsOx = xsecnuoxygen->GetCrosssection(nu_energy, {rcn, state, ex_state, ch});
+                  Ocrsp3[ex_state][ch].push_back(crsOx);
+                }
               }
             }
           }
-        }
-        else if(state==4){
-          for(int ex_state=0;ex_state<16;ex_state++){
-            for(int ch=0;ch<7;ch++){
-              if(rcn==0){
-                crsOx = xsecnuoxygen.GetCrosssection(nu_energy, {rcn, state, ex_state, ch});
-                Ocrse4[ex_state][ch].push_back(crsOx);
-              }
-              else if(rcn==1){
-                crsOx = xsecnuoxygen.GetCrosssection(nu_energy, {rcn, state, ex_state, ch});
-                Ocrsp4[ex_state][ch].push_back(crsOx);
+          else if(state==4){
+            for(int ex_state=0;ex_state<16;ex_state++){
+              for(int ch=0;ch<7;ch++){
+                if(rcn==0){
+                  crsOx = xsecnuoxygen->GetCrosssection(nu_energy, {rcn, state, ex_state, ch});
+                  Ocrse4[ex_state][ch].push_back(crsOx);
+                }
+                else if(rcn==1){
+                  crsOx = xsecnuoxygen->GetCrosssection(nu_energy, {rcn, state, ex_state, ch});
+                  Ocrsp4[ex_state][ch].push_back(crsOx);
+                }
               }
             }
           }
@@ -550,38 +769,42 @@ std::vector<SKSNSimSNEventVector> SKSNSimVectorSNGenerator::GenerateEvents(){
       }
     }
     //calculate cross section of sub channel and excited state
-    for(int rcn=0;rcn<2;rcn++){
-      for(int state=0;state<5;state++){
-        for(int ch=0;ch<32;ch++){
-          if(rcn==0){
-            crsOx = xsecnuoxygensub.GetCrosssection(nu_energy, {rcn, state, ch});
-            OcrseSub[state][ch].push_back(crsOx);
-            //std::cout << rcn << " " << state << " " << ch << " " << nu_energy << " " << crsOx << std::endl; //nakanisi
-          }
-          if(rcn==1){
-            crsOx = xsecnuoxygensub.GetCrosssection(nu_energy, {rcn, state, ch});
-            OcrspSub[state][ch].push_back(crsOx);
+    if( useOxygenSub ){
+      for(int rcn=0;rcn<2;rcn++){
+        for(int state=0;state<5;state++){
+          for(int ch=0;ch<32;ch++){
+            if(rcn==0){
+              crsOx = xsecnuoxygensub->GetCrosssection(nu_energy, {rcn, state, ch});
+              OcrseSub[state][ch].push_back(crsOx);
+              //std::cout << rcn << " " << state << " " << ch << " " << nu_energy << " " << crsOx << std::endl; //nakanisi
+            }
+            if(rcn==1){
+              crsOx = xsecnuoxygensub->GetCrosssection(nu_energy, {rcn, state, ch});
+              OcrspSub[state][ch].push_back(crsOx);
+            }
           }
         }
       }
     }
     //calculate cross section of nc reaction
-    for(int rcn=0;rcn<2;rcn++){
-      switch(rcn){
-        case 0: //for p + 15N
-          for(int ex_state=0;ex_state<xsecnuoxygennc.GetNumEx(rcn);ex_state++){
-            crsOx = xsecnuoxygennc.GetCrosssection(nu_energy, {rcn, ex_state});
-            OcrsNC[rcn][ex_state].push_back(crsOx);
-          }
-          break;
+    if( useOxygenNC ){
+      for(int rcn=0;rcn<2;rcn++){
+        switch(rcn){
+          case 0: //for p + 15N
+            for(int ex_state=0;ex_state<xsecnuoxygennc->GetNumEx(rcn);ex_state++){
+              crsOx = xsecnuoxygennc->GetCrosssection(nu_energy, {rcn, ex_state});
+              OcrsNC[rcn][ex_state].push_back(crsOx);
+            }
+            break;
 
-        case 1: // for n + 15O
-          for(int ex_state=0;ex_state<xsecnuoxygennc.GetNumEx(rcn);ex_state++){
-            crsOx = xsecnuoxygennc.GetCrosssection(nu_energy, {rcn, ex_state});
-            //crsOx_nc = ocrs_nc -> CsNuOxyNCNue(rcn, nu_energy);
-            OcrsNC[rcn][ex_state].push_back(crsOx);
-          }
-          break;
+          case 1: // for n + 15O
+            for(int ex_state=0;ex_state<xsecnuoxygennc->GetNumEx(rcn);ex_state++){
+              crsOx = xsecnuoxygennc->GetCrosssection(nu_energy, {rcn, ex_state});
+              //crsOx_nc = ocrs_nc -> CsNuOxyNCNue(rcn, nu_energy);
+              OcrsNC[rcn][ex_state].push_back(crsOx);
+            }
+            break;
+        }
       }
     }
   }
@@ -616,222 +839,283 @@ std::vector<SKSNSimSNEventVector> SKSNSimVectorSNGenerator::GenerateEvents(){
   std::vector<double> totNcNuxnCh(4,0.);
   std::vector<double> totNcNuxbarnCh(4,0.);
 
+  // cross-section variations: factor on the energy grid, and expected number of events for each reaction type
+  constexpr int NXSECTYPE = (int)XSECTYPE::mNXSECTYPE;
+  const size_t nVar = m_xsec_variations.size();
+  std::vector<double> varFactor(nVar * NXSECTYPE * nuEneNBins); // [(variation * NXSECTYPE + type) * nuEneNBins + i_nu_ene]
+  for(size_t v = 0; v < nVar; v++)
+    for(int t = 0; t < NXSECTYPE; t++)
+      for(int i_nu_ene = 0; i_nu_ene < nuEneNBins; i_nu_ene++)
+        varFactor[(v * NXSECTYPE + t) * nuEneNBins + i_nu_ene] = m_xsec_variations[v].GetFactor(nuEne_min + ( double(i_nu_ene) + 0.5 ) * nuEneBinSize, (XSECTYPE)t);
+  std::vector<double> totXSec(NXSECTYPE, 0.); // nominal
+  std::vector<double> totVar(nVar * NXSECTYPE, 0.);
+
+  // flux spectra on the energy grid, evaluated once for each time bin
+  std::vector<double> nuEneGrid(nuEneNBins);
+  for(int i_nu_ene = 0; i_nu_ene < nuEneNBins; i_nu_ene++) nuEneGrid[i_nu_ene] = nuEne_min + ( double(i_nu_ene) + 0.5 ) * nuEneBinSize;
+  std::vector<double> spcNue(nuEneNBins), spcNueb(nuEneNBins), spcNux(nuEneNBins);
+
+  // generated events
+  size_t n_filled = 0;
+  GENCOUNTER gencounter;
+  double nPrevWindows = 0.; // expected number of events in the previous time windows
+
 	/*---- loop ----*/
   std::cout << "start loop in Process" << std::endl; //nakanisi
   double time;
   double nuEne;
   for(Int_t i_time =0; i_time < tNBins; i_time++) {
 
-    time = tStart + (double(i_time)+0.5)*tBinSize; //center value of each bin[s]
-    int itime_sn = int(time);
+    if( timeIntegrated ){
+      tBinSize = tWindows[i_time+1] - tWindows[i_time];
+      time = 0.5 * ( tWindows[i_time] + tWindows[i_time+1] );
+      flux.GetFluenceSpectrum(tWindows[i_time], tWindows[i_time+1], SKSNSimFluxModel::FLUXNUE, nuEneNBins, nuEneGrid.data(), spcNue.data());
+      flux.GetFluenceSpectrum(tWindows[i_time], tWindows[i_time+1], SKSNSimFluxModel::FLUXNUEB, nuEneNBins, nuEneGrid.data(), spcNueb.data());
+      flux.GetFluenceSpectrum(tWindows[i_time], tWindows[i_time+1], SKSNSimFluxModel::FLUXNUX, nuEneNBins, nuEneGrid.data(), spcNux.data());
+      for(int i_nu_ene = 0; i_nu_ene < nuEneNBins; i_nu_ene++){
+        spcNue[i_nu_ene]  /= tBinSize;
+        spcNueb[i_nu_ene] /= tBinSize;
+        spcNux[i_nu_ene]  /= tBinSize;
+      }
+    }
+    else {
+      time = tStart + (double(i_time)+0.5)*tBinSize; //center value of each bin[s]
+      int itime_sn = int(time);
+
+      if(itime_sn > (int)(tEnd * 1000.)){
+        exit(0);
+      }
 
-    if(itime_sn > (int)(tEnd * 1000.)){
-      exit(0);
+      flux.GetFluxSpectrum(time, SKSNSimFluxModel::FLUXNUE, nuEneNBins, nuEneGrid.data(), spcNue.data());
+      flux.GetFluxSpectrum(time, SKSNSimFluxModel::FLUXNUEB, nuEneNBins, nuEneGrid.data(), spcNueb.data());
+      flux.GetFluxSpectrum(time, SKSNSimFluxModel::FLUXNUX, nuEneNBins, nuEneGrid.data(), spcNux.data());
     }
 
     for(int i_nu_ene =0; i_nu_ene < nuEneNBins; i_nu_ene++) {
 
       const double nu_energy = nuEne_min + ( double(i_nu_ene) + 0.5 ) * nuEneBinSize;
 
-      const double nspcne  = flux.GetFlux(nu_energy, time, SKSNSimFluxModel::FLUXNUE); //Nue
-      const double nspcneb = flux.GetFlux(nu_energy, time, SKSNSimFluxModel::FLUXNUEB); //Nuebar
-      const double nspcnx  = flux.GetFlux(nu_energy, time, SKSNSimFluxModel::FLUXNUX); //Nux or Nuexbar
+      const double nspcne  = spcNue[i_nu_ene]; //Nue
+      const double nspcneb = spcNueb[i_nu_ene]; //Nuebar
+      const double nspcnx  = spcNux[i_nu_ene]; //Nux or Nuexbar
+      double rateXSec[NXSECTYPE] = {0.}; // expected number of events in this bin for each reaction type
 
       /*----- inverse beta decay -----*/
 
-      rate = Const_p * (oscneb1*nspcneb + oscneb2*nspcnx) * totcrsIBD[i_nu_ene] * nuEneBinSize * tBinSize * RatioTo10kpc;
-			//SKSNSimTools::DumpDebugMessage(Form("IBD rate is: time %.2g Enu %.5g TotCRSIBD %.5g Nspcneb x oscneb1 %.5g Nspcnx x oscneb2 %.5g nuEneBinSize %.2g tBinSize %.2g RatioTo10kpc %.2g -> rate %.5g", time, nu_energy, totcrsIBD[i_nu_ene], oscneb1*nspcneb, oscneb2*nspcnx, nuEneBinSize, tBinSize, RatioTo10kpc, rate));
-      totNuebarp += rate;
-      if(flag_event == 1) {
-        auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, 0 /*nReact*/, - PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
-        evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+      if( useIBD ){
+        rate = Const_p * (oscneb1*nspcneb + oscneb2*nspcnx) * totcrsIBD[i_nu_ene] * nuEneBinSize * tBinSize * RatioTo10kpc;
+  			//SKSNSimTools::DumpDebugMessage(Form("IBD rate is: time %.2g Enu %.5g TotCRSIBD %.5g Nspcneb x oscneb1 %.5g Nspcnx x oscneb2 %.5g nuEneBinSize %.2g tBinSize %.2g RatioTo10kpc %.2g -> rate %.5g", time, nu_energy, totcrsIBD[i_nu_ene], oscneb1*nspcneb, oscneb2*nspcnx, nuEneBinSize, tBinSize, RatioTo10kpc, rate));
+        totNuebarp += rate;
+        rateXSec[(int)XSECTYPE::mXSECIBD] += rate;
+        if(flag_event == 1) {
+          auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, 0 /*nReact*/, - PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
+          evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+        }
       }
 
 
       /*----- electron elastic -----*/
 
-      rate = Const_e * (oscnue1*nspcne + oscnue2*nspcnx) * totcrsNue[i_nu_ene] * nuEneBinSize * tBinSize * RatioTo10kpc;
-      totNueElastic += rate;
-      if(flag_event == 1) {
-        auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, 1 /*nReact*/, PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
-        evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
-      }
+      if( useElastic ){
+        rate = Const_e * (oscnue1*nspcne + oscnue2*nspcnx) * totcrsNue[i_nu_ene] * nuEneBinSize * tBinSize * RatioTo10kpc;
+        totNueElastic += rate;
+        rateXSec[(int)XSECTYPE::mXSECELASTIC] += rate;
+        if(flag_event == 1) {
+          auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, 1 /*nReact*/, PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
+          evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+        }
 
-      rate = Const_e * (oscneb1*nspcneb + oscneb2*nspcnx) * totcrsNueb[i_nu_ene] * nuEneBinSize * tBinSize * RatioTo10kpc;
-      totNuebarElastic += rate;
-      if(flag_event == 1) {
-        auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, 2 /*nReact*/, - PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
-        evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
-      }
+        rate = Const_e * (oscneb1*nspcneb + oscneb2*nspcnx) * totcrsNueb[i_nu_ene] * nuEneBinSize * tBinSize * RatioTo10kpc;
+        totNuebarElastic += rate;
+        rateXSec[(int)XSECTYPE::mXSECELASTIC] += rate;
+        if(flag_event == 1) {
+          auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, 2 /*nReact*/, - PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
+          evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+        }
 
-      rate = Const_e * (oscnux1*nspcnx + oscnux2*nspcne) * totcrsNux[i_nu_ene] * nuEneBinSize * tBinSize * RatioTo10kpc;
-      totNuxElastic += rate;
-      if(flag_event == 1) {
-        auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, 3 /*nReact*/, PDG_MUON_NEUTRINO /*nuType*/, rate);
-        evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
-      }
+        rate = Const_e * (oscnux1*nspcnx + oscnux2*nspcne) * totcrsNux[i_nu_ene] * nuEneBinSize * tBinSize * RatioTo10kpc;
+        totNuxElastic += rate;
+        rateXSec[(int)XSECTYPE::mXSECELASTIC] += rate;
+        if(flag_event == 1) {
+          auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, 3 /*nReact*/, PDG_MUON_NEUTRINO /*nuType*/, rate);
+          evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+        }
 
-      rate = Const_e * (oscnxb1*nspcnx + oscnxb2*nspcneb) * totcrsNuxb[i_nu_ene] * nuEneBinSize * tBinSize * RatioTo10kpc;
-      totNuxbarElastic += rate;
-      if(flag_event == 1) {
-        auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, 4 /*nReact*/, - PDG_MUON_NEUTRINO /*nuType*/, rate);
-        evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+        rate = Const_e * (oscnxb1*nspcnx + oscnxb2*nspcneb) * totcrsNuxb[i_nu_ene] * nuEneBinSize * tBinSize * RatioTo10kpc;
+        totNuxbarElastic += rate;
+        rateXSec[(int)XSECTYPE::mXSECELASTIC] += rate;
+        if(flag_event == 1) {
+          auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, 4 /*nReact*/, - PDG_MUON_NEUTRINO /*nuType*/, rate);
+          evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+        }
       }
 
       /*----- charged current with oxygen -----*/
-      for(int ex_energy=0;ex_energy<5;ex_energy++){
-        int rcn = 0;
-        if(ex_energy==0){
-          for(int ex_state=0;ex_state<3;ex_state++){
-            for(int ch=0;ch<7;ch++){
-              double crsOx = Ocrse0[ex_state][ch].at(i_nu_ene);
-              rate = Const_o * (oscnue1*nspcne + oscnue2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
-              //std::cout << time << " " << nu_energy << " " << ex_state << " " << ch << " " << rate << std::endl; //nakanisi
-              totNueO += rate;
-              if(flag_event == 1){
-                //sReact = to_string(rcn) + to_string(ex_energy) + to_string(ex_state) + to_string(ch);
-                const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 + (ex_state+1)*10 + (ch+1);
-                //if(ex_state==2 && ch==6)std::cout << "nReact" << " " << nReact << " " << rcn << " " << ex_energy << " " << ex_state << " " << ch << std::endl; //nakanisi
-                auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, PDG_ELECTRON_NEUTRINO /* nuType */, rate);
-                evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+      if( useOxygen ){
+        for(int ex_energy=0;ex_energy<5;ex_energy++){
+          int rcn = 0;
+          if(ex_energy==0){
+            for(int ex_state=0;ex_state<3;ex_state++){
+              for(int ch=0;ch<7;ch++){
+                double crsOx = Ocrse0[ex_state][ch].at(i_nu_ene);
+                rate = Const_o * (oscnue1*nspcne + oscnue2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
+                //std::cout << time << " " << nu_energy << " " << ex_state << " " << ch << " " << rate << std::endl; //nakanisi
+                totNueO += rate;
+                rateXSec[(int)XSECTYPE::mXSECOXYGEN] += rate;
+                if(flag_event == 1){
+                  //sReact = to_string(rcn) + to_string(ex_energy) + to_string(ex_state) + to_string(ch);
+                  const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 + (ex_state+1)*10 + (ch+1);
+                  //if(ex_state==2 && ch==6)std::cout << "nReact" << " " << nReact << " " << rcn << " " << ex_energy << " " << ex_state << " " << ch << std::endl; //nakanisi
+                  auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, PDG_ELECTRON_NEUTRINO /* nuType */, rate);
+                  evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+                }
               }
             }
           }
-        }
-        if(ex_energy==1){
-          //std::cout << "nue ex_energy=1" << std::endl; //nakanisi
-          for(int ex_state=0;ex_state<15;ex_state++){
-            for(int ch=0;ch<7;ch++){
-              double crsOx = Ocrse1[ex_state][ch].at(i_nu_ene);
-              rate = Const_o * (oscnue1*nspcne + oscnue2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
-              totNueO += rate;
-              if(flag_event == 1){
-                const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 + (ex_state+1)*10 + (ch+1);
-                auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
-                evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+          if(ex_energy==1){
+            //std::cout << "nue ex_energy=1" << std::endl; //nakanisi
+            for(int ex_state=0;ex_state<15;ex_state++){
+              for(int ch=0;ch<7;ch++){
+                double crsOx = Ocrse1[ex_state][ch].at(i_nu_ene);
+                rate = Const_o * (oscnue1*nspcne + oscnue2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
+                totNueO += rate;
+                rateXSec[(int)XSECTYPE::mXSECOXYGEN] += rate;
+                if(flag_event == 1){
+                  const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 + (ex_state+1)*10 + (ch+1);
+                  auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
+                  evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+                }
               }
             }
           }
-        }
-        if(ex_energy==2){
-          //std::cout << "nue ex_energy =2" << std::endl; //nakanisi
-          for(int ex_state=0;ex_state<8;ex_state++){
-            for(int ch=0;ch<7;ch++){
-              double crsOx = Ocrse2[ex_state][ch].at(i_nu_ene);
-              rate = Const_o * (oscnue1*nspcne + oscnue2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
-              totNueO += rate;
-              if(flag_event == 1){
-                const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 + (ex_state+1)*10 + (ch+1);
-                auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
-                evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+          if(ex_energy==2){
+            //std::cout << "nue ex_energy =2" << std::endl; //nakanisi
+            for(int ex_state=0;ex_state<8;ex_state++){
+              for(int ch=0;ch<7;ch++){
+                double crsOx = Ocrse2[ex_state][ch].at(i_nu_ene);
+                rate = Const_o * (oscnue1*nspcne + oscnue2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
+                totNueO += rate;
+                rateXSec[(int)XSECTYPE::mXSECOXYGEN] += rate;
+                if(flag_event == 1){
+                  const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 + (ex_state+1)*10 + (ch+1);
+                  auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
+                  evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+                }
               }
             }
           }
-        }
-        if(ex_energy==3){
-          //std::cout << "nue ex_energy = 3" << std::endl; //nakanisi
-          for(int ex_state=0;ex_state<1;ex_state++){
-            for(int ch=0;ch<7;ch++){
-              double crsOx = Ocrse3[ex_state][ch].at(i_nu_ene);
-              rate = Const_o * (oscnue1*nspcne + oscnue2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
-              totNueO += rate;
-              if(flag_event == 1){
-                const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 + (ex_state+1)*10 + (ch+1);
-                auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
-                evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+          if(ex_energy==3){
+            //std::cout << "nue ex_energy = 3" << std::endl; //nakanisi
+            for(int ex_state=0;ex_state<1;ex_state++){
+              for(int ch=0;ch<7;ch++){
+                double crsOx = Ocrse3[ex_state][ch].at(i_nu_ene);
+                rate = Const_o * (oscnue1*nspcne + oscnue2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
+                totNueO += rate;
+                rateXSec[(int)XSECTYPE::mXSECOXYGEN] += rate;
+                if(flag_event == 1){
+                  const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 + (ex_state+1)*10 + (ch+1);
+                  auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
+                  evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+                }
               }
             }
           }
-        }
-        if(ex_energy==4){
-          //std::cout << "nue ex_energy = 4" << std::endl; //nakanisi
-          for(int ex_state=0;ex_state<16;ex_state++){
-            for(int ch=0;ch<7;ch++){
-              double crsOx = Ocrse4[ex_state][ch].at(i_nu_ene);
-              rate = Const_o * (oscnue1*nspcne + oscnue2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
-              totNueO += rate;
-              if(flag_event == 1){
-                const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 + (ex_state+1)*10 + (ch+1);
-                auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
-                evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+          if(ex_energy==4){
+            //std::cout << "nue ex_energy = 4" << std::endl; //nakanisi
+            for(int ex_state=0;ex_state<16;ex_state++){
+              for(int ch=0;ch<7;ch++){
+                double crsOx = Ocrse4[ex_state][ch].at(i_nu_ene);
+                rate = Const_o * (oscnue1*nspcne + oscnue2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
+                totNueO += rate;
+                rateXSec[(int)XSECTYPE::mXSECOXYGEN] += rate;
+                if(flag_event == 1){
+                  const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 + (ex_state+1)*10 + (ch+1);
+                  auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
+                  evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+                }
               }
             }
           }
         }
-      }
-      //std::cout << time << " " << nu_energy << "ex_energy loop end" << std::endl; //nakanisi
-
-      for(int ex_energy=0;ex_energy<5;ex_energy++){
-        int rcn = 1;
-        if(ex_energy==0){
-          for(int ex_state=0;ex_state<3;ex_state++){
-            for(int ch=0;ch<7;ch++){
-              double crsOx = Ocrsp0[ex_state][ch].at(i_nu_ene);
-              rate = Const_o * (oscneb1+nspcneb + oscneb2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
-              //std::cout << time << " " << nu_energy << " " << ex_state << " " << ch << " " << rate << std::endl; //nakanisi
-              totNuebarO += rate;
-              if(flag_event == 1){
-                const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 + (ex_state+1)*10 + (ch+1);
-                //std::cout << "MakeEvent" << std::endl;
-                auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, - PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
-                evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
-                //std::cout << "end MakeEvent" << std::endl;
+        //std::cout << time << " " << nu_energy << "ex_energy loop end" << std::endl; //nakanisi
+
+        for(int ex_energy=0;ex_energy<5;ex_energy++){
+          int rcn = 1;
+          if(ex_energy==0){
+            for(int ex_state=0;ex_state<3;ex_state++){
+              for(int ch=0;ch<7;ch++){
+                double crsOx = Ocrsp0[ex_state][ch].at(i_nu_ene);
+                rate = Const_o * (oscneb1+nspcneb + oscneb2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
+                //std::cout << time << " " << nu_energy << " " << ex_state << " " << ch << " " << rate << std::endl; //nakanisi
+                totNuebarO += rate;
+                rateXSec[(int)XSECTYPE::mXSECOXYGEN] += rate;
+                if(flag_event == 1){
+                  const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 + (ex_state+1)*10 + (ch+1);
+                  //std::cout << "MakeEvent" << std::endl;
+                  auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, - PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
+                  evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+                  //std::cout << "end MakeEvent" << std::endl;
+                }
               }
             }
           }
-        }
-        if(ex_energy==1){
-          for(int ex_state=0;ex_state<15;ex_state++){
-            for(int ch=0;ch<7;ch++){
-              double crsOx = Ocrsp1[ex_state][ch].at(i_nu_ene);
-              rate = Const_o * (oscneb1*nspcneb + oscneb2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
-              totNuebarO += rate;
-              if(flag_event == 1){
-                const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 + (ex_state+1)*10 + (ch+1);
-                auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, - PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
-                evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+          if(ex_energy==1){
+            for(int ex_state=0;ex_state<15;ex_state++){
+              for(int ch=0;ch<7;ch++){
+                double crsOx = Ocrsp1[ex_state][ch].at(i_nu_ene);
+                rate = Const_o * (oscneb1*nspcneb + oscneb2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
+                totNuebarO += rate;
+                rateXSec[(int)XSECTYPE::mXSECOXYGEN] += rate;
+                if(flag_event == 1){
+                  const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 + (ex_state+1)*10 + (ch+1);
+                  auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, - PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
+                  evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+                }
               }
             }
           }
-        }
-        if(ex_energy==2){
-          for(int ex_state=0;ex_state<8;ex_state++){
-            for(int ch=0;ch<7;ch++){
-              double crsOx = Ocrsp2[ex_state][ch].at(i_nu_ene);
-              rate = Const_o * (oscneb1*nspcneb + oscneb2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
-              totNuebarO += rate;
-              if(flag_event == 1){
-                const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 + (ex_state+1)*10 + (ch+1);
-                auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, - PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
-                evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+          if(ex_energy==2){
+            for(int ex_state=0;ex_state<8;ex_state++){
+              for(int ch=0;ch<7;ch++){
+                double crsOx = Ocrsp2[ex_state][ch].at(i_nu_ene);
+                rate = Const_o * (oscneb1*nspcneb + oscneb2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
+                totNuebarO += rate;
+                rateXSec[(int)XSECTYPE::mXSECOXYGEN] += rate;
+                if(flag_event == 1){
+                  const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 + (ex_state+1)*10 + (ch+1);
+                  auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, - PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
+                  evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+                }
               }
             }
           }
-        }
-        if(ex_energy==3){
-          for(int ex_state=0;ex_state<1;ex_state++){
-            for(int ch=0;ch<7;ch++){
-              double crsOx = Ocrsp3[ex_state][ch].at(i_nu_ene);
-              rate = Const_o * (oscneb1*nspcneb + oscneb2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
-              totNuebarO += rate;
-              if(flag_event == 1){
-                const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 + (ex_state+1)*10 + (ch+1);
-                auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, - PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
-                evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+          if(ex_energy==3){
+            for(int ex_state=0;ex_state<1;ex_state++){
+              for(int ch=0;ch<7;ch++){
+                double crsOx = Ocrsp3[ex_state][ch].at(i_nu_ene);
+                rate = Const_o * (oscneb1*nspcneb + oscneb2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
+                totNuebarO += rate;
+                rateXSec[(int)XSECTYPE::mXSECOXYGEN] += rate;
+                if(flag_event == 1){
+                  const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 + (ex_state+1)*10 + (ch+1);
+                  auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, - PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
+                  evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+                }
               }
             }
           }
-        }
-        if(ex_energy==4){
-          for(int ex_state=0;ex_state<16;ex_state++){
-            for(int ch=0;ch<7;ch++){
-              double crsOx = Ocrsp4[ex_state][ch].at(i_nu_ene);
-              rate = Const_o * (oscneb1*nspcneb + oscneb2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
-              totNuebarO += rate;
-              if(flag_event == 1){
-                const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 + (ex_state+1)*10 + (ch+1);
-                auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, - PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
-                evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+          if(ex_energy==4){
+            for(int ex_state=0;ex_state<16;ex_state++){
+              for(int ch=0;ch<7;ch++){
+                double crsOx = Ocrsp4[ex_state][ch].at(i_nu_ene);
+                rate = Const_o * (oscneb1*nspcneb + oscneb2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
+                totNuebarO += rate;
+                rateXSec[(int)XSECTYPE::mXSECOXYGEN] += rate;
+                if(flag_event == 1){
+                  const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 + (ex_state+1)*10 + (ch+1);
+                  auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, - PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
+                  evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+                }
               }
             }
           }
@@ -840,131 +1124,164 @@ std::vector<SKSNSimSNEventVector> SKSNSimVectorSNGenerator::GenerateEvents(){
 
       //std::cout << "start sub reaction culculation" << std::endl; //nakanisi
       //nue + O sub reaction
-      for(int ex_energy=0;ex_energy<5;ex_energy++){
-        int rcn = 0;
-        for(int ch=0;ch<32;ch++){
-          //std::cout << "OcrseSub" << " " << ex_energy << " " << ch << std::endl; //nakanisi
-          double crsOx = OcrseSub[ex_energy][ch].at(i_nu_ene);
-          //std::cout << "end OcrseSub" << std::endl; //nakanisi
-          rate = Const_o * (oscnue1*nspcne + oscnue2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
-          //std::cout << "sub" << " " << time << " " << nu_energy << " " << crsOx << " " << rate << std::endl; //nakanisi
-          totNueOsub += rate;
-          //if(crsOx != 0.) SKSNSimTools::DumpDebugMessage(Form("NuOxy rate is: time %.2g Enu %.5g Ocrs %.5g Nspcne x oscne1 %.5g Nspcnx x oscne2 %.5g nuEneBinSize %.2g tBinSize %.2g RatioTo10kpc %.2g -> rate %.5g totNueOsub %.5g", time, nu_energy, crsOx, oscnue1*nspcne, oscnue2*nspcnx, nuEneBinSize, tBinSize, RatioTo10kpc, rate, totNueOsub));
-          if(flag_event == 1){
-            const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 + 3*100 + 9;
-            //std::cout << "MakeEvent" << std::endl; //nakanisi
-            if(nu_energy > 15.4){
-              auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
-              evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+      if( useOxygenSub ){
+        for(int ex_energy=0;ex_energy<5;ex_energy++){
+          int rcn = 0;
+          for(int ch=0;ch<32;ch++){
+            //std::cout << "OcrseSub" << " " << ex_energy << " " << ch << std::endl; //nakanisi
+            double crsOx = OcrseSub[ex_energy][ch].at(i_nu_ene);
+            //std::cout << "end OcrseSub" << std::endl; //nakanisi
+            rate = Const_o * (oscnue1*nspcne + oscnue2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
+            //std::cout << "sub" << " " << time << " " << nu_energy << " " << crsOx << " " << rate << std::endl; //nakanisi
+            totNueOsub += rate;
+            rateXSec[(int)XSECTYPE::mXSECOXYGENSUB] += rate;
+            //if(crsOx != 0.) SKSNSimTools::DumpDebugMessage(Form("NuOxy rate is: time %.2g Enu %.5g Ocrs %.5g Nspcne x oscne1 %.5g Nspcnx x oscne2 %.5g nuEneBinSize %.2g tBinSize %.2g RatioTo10kpc %.2g -> rate %.5g totNueOsub %.5g", time, nu_energy, crsOx, oscnue1*nspcne, oscnue2*nspcnx, nuEneBinSize, tBinSize, RatioTo10kpc, rate, totNueOsub));
+            if(flag_event == 1){
+              const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 + 3*100 + 9;
+              //std::cout << "MakeEvent" << std::endl; //nakanisi
+              if(nu_energy > 15.4){
+                auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
+                evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+              }
+              //std::cout << "end MakeEvent" << std::endl; //nakanisi
             }
-            //std::cout << "end MakeEvent" << std::endl; //nakanisi
           }
         }
-      }
-      //nue_bar + O sub raction
-      for(int ex_energy=0;ex_energy<5;ex_energy++){
-        int rcn = 1;
-        for(int ch=0;ch<32;ch++){
-          double crsOx = OcrspSub[ex_energy][ch].at(i_nu_ene);
-          rate = Const_o * (oscneb1*nspcneb + oscneb2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
-          //std::cout << "sub" << " " << time << " " << nu_energy << " " << crsOx << " " << " " << Const_o << " " << oscneb1 << " " << nspcneb << " " << oscneb2 << " " << nspcnx << " " << nuEneBinSize << " " << tBinSize << " " << RatioTo10kpc << " " << rate << std::endl; //nakanisi
-          totNuebarOsub += rate;
-          if(flag_event == 1){
-            const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 +3*100 + 9;
-            //if(ch==0 && ex_energy==1)std::cout << "nReact" << " " << nReact << " " << rcn << " " << ex_energy << " " << ch << std::endl; //nakanisi
-            if(nu_energy > 11.4) {
-              auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, - PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
-              evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
-            }
+        //nue_bar + O sub raction
+        for(int ex_energy=0;ex_energy<5;ex_energy++){
+          int rcn = 1;
+          for(int ch=0;ch<32;ch++){
+            double crsOx = OcrspSub[ex_energy][ch].at(i_nu_ene);
+            rate = Const_o * (oscneb1*nspcneb + oscneb2*nspcnx) * crsOx * nuEneBinSize * tBinSize * RatioTo10kpc;
+            //std::cout << "sub" << " " << time << " " << nu_energy << " " << crsOx << " " << " " << Const_o << " " << oscneb1 << " " << nspcneb << " " << oscneb2 << " " << nspcnx << " " << nuEneBinSize << " " << tBinSize << " " << RatioTo10kpc << " " << rate << std::endl; //nakanisi
+            totNuebarOsub += rate;
+            rateXSec[(int)XSECTYPE::mXSECOXYGENSUB] += rate;
+            if(flag_event == 1){
+              const int nReact = (rcn+1)*10e4 + (ex_energy+1)*10e3 +3*100 + 9;
+              //if(ch==0 && ex_energy==1)std::cout << "nReact" << " " << nReact << " " << rcn << " " << ex_energy << " " << ch << std::endl; //nakanisi
+              if(nu_energy > 11.4) {
+                auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, - PDG_ELECTRON_NEUTRINO /*nuType*/, rate);
+                evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+              }
 
+            }
           }
         }
       }
 
       // NC reaction
-      auto getNeutrinoType = [](int rcn){
-        const static int neutrinoType[4] = { PDG_ELECTRON_NEUTRINO, - PDG_ELECTRON_NEUTRINO, PDG_MUON_NEUTRINO, - PDG_MUON_NEUTRINO};
-        return neutrinoType[rcn];
-      };
-
-      for(int rcn=0;rcn<4;rcn++){
-        for(int excit=0;excit<2;excit++){
-          if(excit==0){ //p + 15N reaction
-            for(int ex_energy=0;ex_energy<8;ex_energy++){
-              double crsOx_nc = OcrsNC[0][ex_energy].at(i_nu_ene);
-              //double crsOx_nc = OcrsNC[0].at(i_nu_ene);
-              if(rcn==0){
-                rate = Const_o * (oscnue1*nspcne + oscnue2*nspcnx) * crsOx_nc * nuEneBinSize * tBinSize * RatioTo10kpc;
-                totNcNuep += rate;
-                totNcNuepCh[ex_energy] += rate;
-              }
-              else if(rcn==1){
-                rate = Const_o * (oscneb1*nspcneb + oscneb2*nspcnx) * crsOx_nc * nuEneBinSize * tBinSize * RatioTo10kpc;
-                totNcNuebarp += rate;
-                totNcNuebarpCh[ex_energy] += rate;
-              }
-              else if(rcn==2){
-                rate = Const_o * (oscnux1*nspcnx + oscnux2*nspcne) * crsOx_nc * nuEneBinSize * tBinSize * RatioTo10kpc;
-                totNcNuxp += rate;
-                totNcNuxpCh[ex_energy] += rate;
-              }
-              else if(rcn==3){
-                rate = Const_o * (oscnxb1*nspcnx + oscnxb2*nspcneb) * crsOx_nc * nuEneBinSize * tBinSize * RatioTo10kpc;
-                totNcNuxbarp += rate;
-                totNcNuxbarpCh[ex_energy] += rate;
-              }
-              //std::cout << "NC rate: " << time << " " << nu_energy << " " << rcn << " " << excit << " " << crsOx_nc << " " << rate << std::endl; // nakanisi
-              //totNcNup += rate;
-              if(flag_event == 1){
-                const int nReact = 3000 + (rcn+1)*100 + (excit+1)*10 + (ex_energy+1);
-                //std::cout << "NC event " << nReact << " " << 3000 << " " << rcn << " " << excit << " " << ex_energy << std::endl;
-                const int nuType = getNeutrinoType(rcn);
-                auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, nuType, rate);
-
-                evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+      if( useOxygenNC ){
+        auto getNeutrinoType = [](int rcn){
+          const static int neutrinoType[4] = { PDG_ELECTRON_NEUTRINO, - PDG_ELECTRON_NEUTRINO, PDG_MUON_NEUTRINO, - PDG_MUON_NEUTRINO};
+          return neutrinoType[rcn];
+        };
+
+        for(int rcn=0;rcn<4;rcn++){
+          for(int excit=0;excit<2;excit++){
+            if(excit==0){ //p + 15N reaction
+              for(int ex_energy=0;ex_energy<8;ex_energy++){
+                double crsOx_nc = OcrsNC[0][ex_energy].at(i_nu_ene);
+                //double crsOx_nc = OcrsNC[0].at(i_nu_ene);
+                if(rcn==0){
+                  rate = Const_o * (oscnue1*nspcne + oscnue2*nspcnx) * crsOx_nc * nuEneBinSize * tBinSize * RatioTo10kpc;
+                  totNcNuep += rate;
+                  rateXSec[(int)XSECTYPE::mXSECOXYGENNC] += rate;
+                  totNcNuepCh[ex_energy] += rate;
+                }
+                else if(rcn==1){
+                  rate = Const_o * (oscneb1*nspcneb + oscneb2*nspcnx) * crsOx_nc * nuEneBinSize * tBinSize * RatioTo10kpc;
+                  totNcNuebarp += rate;
+                  rateXSec[(int)XSECTYPE::mXSECOXYGENNC] += rate;
+                  totNcNuebarpCh[ex_energy] += rate;
+                }
+                else if(rcn==2){
+                  rate = Const_o * (oscnux1*nspcnx + oscnux2*nspcne) * crsOx_nc * nuEneBinSize * tBinSize * RatioTo10kpc;
+                  totNcNuxp += rate;
+                  rateXSec[(int)XSECTYPE::mXSECOXYGENNC] += rate;
+                  totNcNuxpCh[ex_energy] += rate;
+                }
+                else if(rcn==3){
+                  rate = Const_o * (oscnxb1*nspcnx + oscnxb2*nspcneb) * crsOx_nc * nuEneBinSize * tBinSize * RatioTo10kpc;
+                  totNcNuxbarp += rate;
+                  rateXSec[(int)XSECTYPE::mXSECOXYGENNC] += rate;
+                  totNcNuxbarpCh[ex_energy] += rate;
+                }
+                //std::cout << "NC rate: " << time << " " << nu_energy << " " << rcn << " " << excit << " " << crsOx_nc << " " << rate << std::endl; // nakanisi
+                //totNcNup += rate;
+                if(flag_event == 1){
+                  const int nReact = 3000 + (rcn+1)*100 + (excit+1)*10 + (ex_energy+1);
+                  //std::cout << "NC event " << nReact << " " << 3000 << " " << rcn << " " << excit << " " << ex_energy << std::endl;
+                  const int nuType = getNeutrinoType(rcn);
+                  auto buf = MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, nuType, rate);
+
+                  evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+                }
               }
             }
-          }
-          if(excit==1){ //n + 15O reaction
-            for(int ex_energy=0;ex_energy<4;ex_energy++){
-              double crsOx_nc = OcrsNC[1][ex_energy].at(i_nu_ene);
-              //double crsOx_nc = OcrsNC[1].at(i_nu_ene);
-              if(rcn==0){
-                rate = Const_o * (oscnue1*nspcne + oscnue2*nspcnx) * crsOx_nc * nuEneBinSize * tBinSize * RatioTo10kpc;
-                totNcNuen += rate;
-                totNcNuenCh[ex_energy] += rate;
-              }
-              else if(rcn==1){
-                rate = Const_o * (oscneb1*nspcneb + oscneb2*nspcnx) * crsOx_nc * nuEneBinSize * tBinSize * RatioTo10kpc;
-                totNcNuebarn += rate;
-                totNcNuebarnCh[ex_energy] += rate;
-              }
-              else if(rcn==2){
-                rate = Const_o * (oscnux1*nspcnx + oscnux2*nspcne) * crsOx_nc * nuEneBinSize * tBinSize * RatioTo10kpc;
-                totNcNuxn += rate;
-                totNcNuxnCh[ex_energy] += rate;
-              }
-              else if(rcn==3){
-                rate = Const_o * (oscnxb1*nspcnx + oscnxb2*nspcneb) * crsOx_nc * nuEneBinSize * tBinSize * RatioTo10kpc;
-                totNcNuxbarn += rate;
-                totNcNuxbarnCh[ex_energy] += rate;
-              }
-              //totNcNun += rate;
-              if(flag_event == 1){
-                const int nReact = 3000 + (rcn+1)*100 + (excit+1)*10 + (ex_energy+1);
-                //std::cout << nReact << " rcn " << rcn << " excit " << excit << " ex_energy " << ex_energy << std::endl;
-                const int nuType = getNeutrinoType(rcn);
-                auto buf =  MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, nuType, rate);
-                evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+            if(excit==1){ //n + 15O reaction
+              for(int ex_energy=0;ex_energy<4;ex_energy++){
+                double crsOx_nc = OcrsNC[1][ex_energy].at(i_nu_ene);
+                //double crsOx_nc = OcrsNC[1].at(i_nu_ene);
+                if(rcn==0){
+                  rate = Const_o * (oscnue1*nspcne + oscnue2*nspcnx) * crsOx_nc * nuEneBinSize * tBinSize * RatioTo10kpc;
+                  totNcNuen += rate;
+                  rateXSec[(int)XSECTYPE::mXSECOXYGENNC] += rate;
+                  totNcNuenCh[ex_energy] += rate;
+                }
+                else if(rcn==1){
+                  rate = Const_o * (oscneb1*nspcneb + oscneb2*nspcnx) * crsOx_nc * nuEneBinSize * tBinSize * RatioTo10kpc;
+                  totNcNuebarn += rate;
+                  rateXSec[(int)XSECTYPE::mXSECOXYGENNC] += rate;
+                  totNcNuebarnCh[ex_energy] += rate;
+                }
+                else if(rcn==2){
+                  rate = Const_o * (oscnux1*nspcnx + oscnux2*nspcne) * crsOx_nc * nuEneBinSize * tBinSize * RatioTo10kpc;
+                  totNcNuxn += rate;
+                  rateXSec[(int)XSECTYPE::mXSECOXYGENNC] += rate;
+                  totNcNuxnCh[ex_energy] += rate;
+                }
+                else if(rcn==3){
+                  rate = Const_o * (oscnxb1*nspcnx + oscnxb2*nspcneb) * crsOx_nc * nuEneBinSize * tBinSize * RatioTo10kpc;
+                  totNcNuxbarn += rate;
+                  rateXSec[(int)XSECTYPE::mXSECOXYGENNC] += rate;
+                  totNcNuxbarnCh[ex_energy] += rate;
+                }
+                //totNcNun += rate;
+                if(flag_event == 1){
+                  const int nReact = 3000 + (rcn+1)*100 + (excit+1)*10 + (ex_energy+1);
+                  //std::cout << nReact << " rcn " << rcn << " excit " << excit << " ex_energy " << ex_energy << std::endl;
+                  const int nuType = getNeutrinoType(rcn);
+                  auto buf =  MakeEvent(nuEneBinSize, tBinSize, time, nu_energy, nReact, nuType, rate);
+                  evt_buffer.insert(evt_buffer.end(), buf.begin(), buf.end());
+                }
               }
             }
           }
         }
       }
+
+      for(int t = 0; t < NXSECTYPE; t++){
+        totXSec[t] += rateXSec[t];
+        for(size_t v = 0; v < nVar; v++) totVar[v * NXSECTYPE + t] += varFactor[(v * NXSECTYPE + t) * nuEneNBins + i_nu_ene] * rateXSec[t];
+      }
     }
 
     //std::cout << time << " " << totNuebarp << " " << totNueElastic << std::endl;
+    if( timeIntegrated ){
+      double nWindow = 0.;
+      for(int t = 0; t < NXSECTYPE; t++) nWindow += totXSec[t];
+      fprintf( stdout, "expected number of events in [%g, %g] sec: %e\n", tWindows[i_time], tWindows[i_time+1], nWindow - nPrevWindows );
+      nPrevWindows = nWindow;
+    }
 
+    // Events in different time bins never overlap in time,
+    // so kinematics are filled and the events are passed to sink time-bin by time-bin
+    if(flag_event == 1 && evt_buffer.size() > 0){
+      FillEvent(evt_buffer, n_filled, gencounter);
+      for(auto it = evt_buffer.begin(); it != evt_buffer.end(); it++) sink(*it);
+      n_filled += evt_buffer.size();
+      evt_buffer.clear();
+    }
   }
   std::cout << "end loop process" << std::endl; //nakanisi
 
@@ -1002,14 +1319,25 @@ std::vector<SKSNSimSNEventVector> SKSNSimVectorSNGenerator::GenerateEvents(){
   fprintf( stdout, "   nuxbar + O (NC: n+15O) = %e\n", totNcNuxbarn);
   fprintf( stdout, "   (NC: n+15O) %e, %e, %e, %e\n", totNcNuxbarnCh[0], totNcNuxbarnCh[1], totNcNuxbarnCh[2], totNcNuxbarnCh[3] );
   fprintf( stdout, "------------------------------------\n" );
+  if( nVar > 0 ){
+    auto dumpVariation = [&](const char *name, const double *tot){
+      double sum = 0.;
+      for(int t = 0; t < NXSECTYPE; t++) sum += tot[t];
+      fprintf( stdout, "   %-24s %e ( %e, %e, %e, %e, %e )\n", name, sum, tot[0], tot[1], tot[2], tot[3], tot[4] );
+    };
+    fprintf( stdout, "expected number of events for cross-section variations\n" );
+    fprintf( stdout, "   %-24s total ( ibd, elastic, oxygen_cc, oxygen_sub, oxygen_nc )\n", "variation" );
+    dumpVariation( "nominal", totXSec.data() );
+    for(size_t v = 0; v < nVar; v++) dumpVariation( m_xsec_variations[v].GetName().c_str(), &totVar[v * NXSECTYPE] );
+    fprintf( stdout, "------------------------------------\n" );
+  }
 
   std::cout << "end calculation of each expected event number" << std::endl; //nakanisi
 
-  std::cout << "FillEvent start    ( " << evt_buffer.size()  << " evt)" << std::endl;
-  if(flag_event == 1) FillEvent(evt_buffer);
-  std::cout << "FillEvent finished ( " << evt_buffer.size()  << " evt)" << std::endl;
+  if(flag_event == 1) DumpGenCounter(gencounter);
+  std::cout << "FillEvent finished ( " << n_filled << " evt)" << std::endl;
 
-  return evt_buffer;
+  return n_filled;
 }
 
 
@@ -1077,6 +1405,7 @@ std::vector<SKSNSimSNEventVector> SKSNSimVectorSNGenerator::MakeEvent(const doub
 
       const double rvtx [3] = {xyz.x, xyz.y, xyz.z};
       evtInfo.SetSNEvtInfo(nReact, tReact, nuType, nuEne, m_sn_dir, rvtx);
+      if( !m_xsec_variations.empty() ) evtInfo.SetXSecWeights( SKSNSimXSecVariation::GetFactors(m_xsec_variations, nuEne, GetXSecType(nReact)) );
       evtInfo.SetRunnum(GetRUNNUM());
       evtInfo.SetSubRunnum(GetSubRUNNUM());
 
@@ -1089,30 +1418,23 @@ std::vector<SKSNSimSNEventVector> SKSNSimVectorSNGenerator::MakeEvent(const doub
   return buffer;
 }
 
-void SKSNSimVectorSNGenerator::FillEvent(std::vector<SKSNSimSNEventVector> &evt_buffer)
+XSECTYPE SKSNSimVectorSNGenerator::GetXSecType(const int nReact){
+  // see the rate loop in GenerateEvents() for nReact
+  if( nReact == 0 ) return XSECTYPE::mXSECIBD;
+  if( nReact >= 1 && nReact <= 4 ) return XSECTYPE::mXSECELASTIC;
+  if( nReact > 1000 && nReact < 10000 ) return XSECTYPE::mXSECOXYGENNC;
+  if( nReact >= 10000 ) return ( nReact % 10000 == 3*100 + 9 ? XSECTYPE::mXSECOXYGENSUB : XSECTYPE::mXSECOXYGEN );
+  return XSECTYPE::mNXSECTYPE;
+}
+
+void SKSNSimVectorSNGenerator::FillEvent(std::vector<SKSNSimSNEventVector> &evt_buffer, const size_t iEvtOffset, GENCOUNTER &c)
 {
 
 	/*---- Time sorting ----*/
-  std::cout << "start time sorting before loop of FillEvent" << std::endl;
   std::sort( evt_buffer.begin(), evt_buffer.end());
 
-  int totGenNuebarp=0;
-  int totGenNueElastic=0, totGenNuebarElastic=0, totGenNuxElastic=0, totGenNuxbarElastic=0;
-  int totGenNueO=0, totGenNuebarO=0;
-  int totGenNueOsub=0, totGenNuebarOsub=0;
-  int totGenNcNuep=0, totGenNcNuebarp=0, totGenNcNuxp=0, totGenNcNuxbarp=0, totGenNcNuen=0, totGenNcNuebarn=0, totGenNcNuxn=0, totGenNcNuxbarn=0;
-  std::vector<int> totGenNcNuepCh(8, 0);
-  std::vector<int> totGenNcNuebarpCh(8,0);
-  std::vector<int> totGenNcNuxpCh(8,0);
-  std::vector<int> totGenNcNuxbarpCh(8,0);
-  std::vector<int> totGenNcNuenCh(4,0);
-  std::vector<int> totGenNcNuebarnCh(4,0);
-  std::vector<int> totGenNcNuxnCh(4,0);
-  std::vector<int> totGenNcNuxbarnCh(4,0);
-
   int iSkip = 0;
 
-  std::cout << "start event loop in FillEvent" << std::endl; //nakanisi
   for( uint iEvt = 0; iEvt < evt_buffer.size(); iEvt++ ){
 
     iSkip = 0;
@@ -1121,7 +1443,7 @@ void SKSNSimVectorSNGenerator::FillEvent(std::vector<SKSNSimSNEventVector> &evt_
 
     // fill SNEvtInfo (see $SKOFL_ROOT/include/lowe/snevtinfo.h )
 
-    p.SetSNEvtInfoIEvt(iEvt);
+    p.SetSNEvtInfoIEvt(iEvtOffset + iEvt);
 
     // MCVERTEX (see $SKOFL_ROOT/inc/vcvrtx.h )
 
@@ -1143,11 +1465,11 @@ void SKSNSimVectorSNGenerator::FillEvent(std::vector<SKSNSimSNEventVector> &evt_
     const auto rType = p.GetSNEvtInfoRType();
     if(iSkip == 0) {
 
-      if(rType == 0) totGenNuebarp++;
-      else if(rType == 1) totGenNueElastic++;
-      else if(rType == 2) totGenNuebarElastic++;
-      else if(rType == 3) totGenNuxElastic++;
-      else if(rType == 4) totGenNuxbarElastic++;
+      if(rType == 0) c.totGenNuebarp++;
+      else if(rType == 1) c.totGenNueElastic++;
+      else if(rType == 2) c.totGenNuebarElastic++;
+      else if(rType == 3) c.totGenNuxElastic++;
+      else if(rType == 4) c.totGenNuxbarElastic++;
       else if(rType>1000 && rType<10000){ // nc reaction
         const int Reaction = rType/1000;
         const int Excit_pre = rType/100;
@@ -1156,14 +1478,14 @@ void SKSNSimVectorSNGenerator::FillEvent(std::vector<SKSNSimSNEventVector> &evt_
         const int channel = (rType - ch_pre*10) - 1;
         const int particle = ((rType - Excit_pre*100)/10) - 1;
         //std::cout << "NC reaction " << p.rType << " Reaction " << Reaction << " Excit " << Excit << " particle " << particle << " channel " << channel << std::endl; //nakanisi
-        if(Excit==0 && particle==0)totGenNcNuep++;
-        else if(Excit==1 && particle==0)totGenNcNuebarp++;
-        else if(Excit==2 && particle==0)totGenNcNuxp++;
-        else if(Excit==3 && particle==0)totGenNcNuxbarp++;
-        else if(Excit==0 && particle==1)totGenNcNuen++;
-        else if(Excit==1 && particle==1)totGenNcNuebarn++;
-        else if(Excit==2 && particle==1)totGenNcNuxn++;
-        else if(Excit==3 && particle==1)totGenNcNuxbarn++;
+        if(Excit==0 && particle==0)c.totGenNcNuep++;
+        else if(Excit==1 && particle==0)c.totGenNcNuebarp++;
+        else if(Excit==2 && particle==0)c.totGenNcNuxp++;
+        else if(Excit==3 && particle==0)c.totGenNcNuxbarp++;
+        else if(Excit==0 && particle==1)c.totGenNcNuen++;
+        else if(Excit==1 && particle==1)c.totGenNcNuebarn++;
+        else if(Excit==2 && particle==1)c.totGenNcNuxn++;
+        else if(Excit==3 && particle==1)c.totGenNcNuxbarn++;
       }
       else if(rType>=10000){ // cc reaction
                                //if(Ex_state==30)std::cout << p.rType << " " << "nReact" << " " << nReact << " " << "Reaction" << " " << Reaction << " " << "State_pre" << " " << State_pre << " " << "State" << " " << State << " " << "Ex_state_pre" << " " << Ex_state_pre << " " << "Ex_state" << " " << Ex_state << " " << "channel" << " " << channel << std::endl; //nakanisi
@@ -1173,43 +1495,46 @@ void SKSNSimVectorSNGenerator::FillEvent(std::vector<SKSNSimSNEventVector> &evt_
         const int State = ((rType - (Reaction+1)*10e4)/10e3) - 1;
         const int Ex_state = ((rType - State_pre*10e3)/10) - 1;
         const int channel = (rType - Ex_state_pre*10) - 1;
-        if(Reaction==0 && Ex_state!=29) totGenNueO++;
-        else if(Reaction==1 && Ex_state!=29) totGenNuebarO++;
-        else if(Reaction==0 && Ex_state==29) totGenNueOsub++;
-        else if(Reaction==1 && Ex_state==29) totGenNuebarOsub++; 
+        if(Reaction==0 && Ex_state!=29) c.totGenNueO++;
+        else if(Reaction==1 && Ex_state!=29) c.totGenNuebarO++;
+        else if(Reaction==0 && Ex_state==29) c.totGenNueOsub++;
+        else if(Reaction==1 && Ex_state==29) c.totGenNuebarOsub++; 
       }
     }
   }
+}
 
-  const int totalNumOfGenEvts = ( totGenNuebarp + totGenNueElastic
-      + totGenNuebarElastic + totGenNuxElastic + totGenNuxbarElastic
-      + totGenNueO + totGenNuebarO 
-      + totGenNueOsub + totGenNuebarOsub
-      + totGenNcNuep + totGenNcNuebarp + totGenNcNuxp + totGenNcNuxbarp + totGenNcNuen + totGenNcNuebarn + totGenNcNuxn + totGenNcNuxbarn
+void SKSNSimVectorSNGenerator::DumpGenCounter(const GENCOUNTER &c)
+{
+  const int totalNumOfGenEvts = ( c.totGenNuebarp + c.totGenNueElastic
+      + c.totGenNuebarElastic + c.totGenNuxElastic + c.totGenNuxbarElastic
+      + c.totGenNueO + c.totGenNuebarO 
+      + c.totGenNueOsub + c.totGenNuebarOsub
+      + c.totGenNcNuep + c.totGenNcNuebarp + c.totGenNcNuxp + c.totGenNcNuxbarp + c.totGenNcNuen + c.totGenNcNuebarn + c.totGenNcNuxn + c.totGenNcNuxbarn
       );
 
   fprintf( stdout, "------------------------------------\n" );
   fprintf( stdout, "total generated number of events %d\n", totalNumOfGenEvts );
-  fprintf( stdout, "   nuebar + p = %d\n", totGenNuebarp );
-  fprintf( stdout, "   nue + e = %d\n", totGenNueElastic );
-  fprintf( stdout, "   nuebar + e = %d\n", totGenNuebarElastic );
-  fprintf( stdout, "   nux + e = %d\n", totGenNuxElastic );
-  fprintf( stdout, "   nuxbar + e = %d\n", totGenNuxbarElastic );
-  fprintf( stdout, "   nue + o = %d\n", totGenNueO+totGenNueOsub );
-  fprintf( stdout, "   nuebar + o = %d\n", totGenNuebarO+totGenNuebarOsub );
-  fprintf( stdout, "   nue + o (NC:p+15N) = %d\n", totGenNcNuep );
-  fprintf( stdout, "   nuebar + o (NC:p+15N) = %d\n", totGenNcNuebarp );
-  fprintf( stdout, "   nux + o (NC:p+15N) = %d\n", totGenNcNuxp );
-  fprintf( stdout, "   nuxbar + o (NC:p+15N) = %d\n", totGenNcNuxbarp );
-  fprintf( stdout, "   nue + o (NC:n+15O) = %d\n", totGenNcNuen );
-  fprintf( stdout, "   nuebar + o (NC:n+15O) = %d\n", totGenNcNuebarn );
-  fprintf( stdout, "   nux + o (NC:n+15O) = %d\n", totGenNcNuxn );
-  fprintf( stdout, "   nuxbar + o (NC:n+15O) = %d\n", totGenNcNuxbarn );
+  fprintf( stdout, "   nuebar + p = %d\n", c.totGenNuebarp );
+  fprintf( stdout, "   nue + e = %d\n", c.totGenNueElastic );
+  fprintf( stdout, "   nuebar + e = %d\n", c.totGenNuebarElastic );
+  fprintf( stdout, "   nux + e = %d\n", c.totGenNuxElastic );
+  fprintf( stdout, "   nuxbar + e = %d\n", c.totGenNuxbarElastic );
+  fprintf( stdout, "   nue + o = %d\n", c.totGenNueO+c.totGenNueOsub );
+  fprintf( stdout, "   nuebar + o = %d\n", c.totGenNuebarO+c.totGenNuebarOsub );
+  fprintf( stdout, "   nue + o (NC:p+15N) = %d\n", c.totGenNcNuep );
+  fprintf( stdout, "   nuebar + o (NC:p+15N) = %d\n", c.totGenNcNuebarp );
+  fprintf( stdout, "   nux + o (NC:p+15N) = %d\n", c.totGenNcNuxp );
+  fprintf( stdout, "   nuxbar + o (NC:p+15N) = %d\n", c.totGenNcNuxbarp );
+  fprintf( stdout, "   nue + o (NC:n+15O) = %d\n", c.totGenNcNuen );
+  fprintf( stdout, "   nuebar + o (NC:n+15O) = %d\n", c.totGenNcNuebarn );
+  fprintf( stdout, "   nux + o (NC:n+15O) = %d\n", c.totGenNcNuxn );
+  fprintf( stdout, "   nuxbar + o (NC:n+15O) = %d\n", c.totGenNcNuxbarn );
   fprintf( stdout, "------------------------------------\n" );
 
 }
 
-void SKSNSimVectorSNGenerator::determineKinematics( std::map<XSECTYPE, std::shared_ptr<SKSNSimCrosssectionModel>> xsecmodels, TRandom &rng, SKSNSimSNEventVector &ev, const double snDir[])
+void SKSNSimVectorSNGenerator::determineKinematics( const std::map<XSECTYPE, std::shared_ptr<SKSNSimCrosssectionModel>> &xsecmodels, TRandom &rng, SKSNSimSNEventVector &ev, const double snDir[])
 {
   auto SQ = [](double x){return x*x;};
   const double nuEne = ev.GetSNEvtInfoNuEne();
@@ -1233,10 +1558,7 @@ void SKSNSimVectorSNGenerator::determineKinematics( std::map<XSECTYPE, std::shar
   const UtilVector3<double> snDir_vec(snDir);
   int iSkip = 0;
 
-  SKSNSimXSecIBDSV       &xsecibd         = dynamic_cast<SKSNSimXSecIBDSV&>(      *xsecmodels[XSECTYPE::mXSECIBD]);
-  SKSNSimXSecNuElastic   &xsecnuela       = dynamic_cast<SKSNSimXSecNuElastic&>(  *xsecmodels[XSECTYPE::mXSECELASTIC]);
-  SKSNSimXSecNuOxygen    &xsecnuoxygen    = dynamic_cast<SKSNSimXSecNuOxygen&>(   *xsecmodels[XSECTYPE::mXSECOXYGEN]);
-  SKSNSimXSecNuOxygenSub &xsecnuoxygensub = dynamic_cast<SKSNSimXSecNuOxygenSub&>(*xsecmodels[XSECTYPE::mXSECOXYGENSUB]);
+  // Only models of the selected reactions exist, so each one is looked up where it is needed
 
 	double sn_theta = acos( snDir[2] );
 	double sn_phi = atan2( snDir[1],  snDir[0] );
@@ -1247,7 +1569,7 @@ void SKSNSimVectorSNGenerator::determineKinematics( std::map<XSECTYPE, std::shar
   auto nReact = ev.GetSNEvtInfoRType();
   if( nReact == 0 ){ // nuebar + p -> e+ + n
     const auto nuMomentum = pvect;
-    determineKinematicsIBD( xsecibd, rng, ev, nuMomentum);
+    determineKinematicsIBD( dynamic_cast<const SKSNSimXSecIBDSV&>(*xsecmodels.at(XSECTYPE::mXSECIBD)), rng, ev, nuMomentum);
 
   } else if( nReact == 1 || nReact == 2 || nReact == 3 || nReact == 4 ){ //nu + e Elastic
                                                                          //mc->mcinfo[0] = 85007;
@@ -1270,7 +1592,7 @@ void SKSNSimVectorSNGenerator::determineKinematics( std::map<XSECTYPE, std::shar
 
     // Recoil electron
     double eEne, eTheta, ePhi;
-    determineAngleElastic( rng, xsecnuela, nReact, nuEne, eEne, eTheta, ePhi, iSkip);
+    determineAngleElastic( rng, dynamic_cast<const SKSNSimXSecNuElastic&>(*xsecmodels.at(XSECTYPE::mXSECELASTIC)), nReact, nuEne, eEne, eTheta, ePhi, iSkip);
     double amom = sqrt(SQ( eEne ) - SQ( Me ));
 
     const UtilVector3<double> eDir = Rmat * UtilVector3<double>(eTheta,ePhi); 
@@ -1393,7 +1715,7 @@ void SKSNSimVectorSNGenerator::determineKinematics( std::map<XSECTYPE, std::shar
     // Original neutrino
     //if(Ex_state==29)mc->nvc = 2;
     double eEne, eTheta, ePhi;
-    determineAngleNueO( rng, xsecnuoxygen, Reaction, State, Ex_state, channel, nuEne, eEne, eTheta, ePhi); // channel = 8 is sub reaction of NueO
+    determineAngleNueO( rng, dynamic_cast<SKSNSimXSecNuOxygen&>(*xsecmodels.at(XSECTYPE::mXSECOXYGEN)), Reaction, State, Ex_state, channel, nuEne, eEne, eTheta, ePhi); // channel = 8 is sub reaction of NueO
 
     int ipvc_tmp = 0;
     auto nuMom = nuEne * snDir_vec;